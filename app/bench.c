@@ -0,0 +1,95 @@
+/// \file
+/// Throughput comparison of the arithmetic coder and the ANS coders.
+///
+/// Usage: bench [megabytes]
+///
+/// Codes a skewed (geometric) u8 message with each coder and reports the
+/// coded size and encode/decode speed.
+#include "ac.h"
+#include "rans.h"
+#include "tans.h"
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+
+#define ENDL "\n"
+#define NSYM 64
+typedef unsigned long long u64;
+
+static double now(void)
+{ struct timespec t;
+  clock_gettime(CLOCK_MONOTONIC,&t);
+  return t.tv_sec+1e-9*t.tv_nsec;
+}
+
+/// Fills \a s with samples of a geometric distribution and \a cdf with its (truncated) CDF.
+static void make_message(u8 *s, size_t n, real *cdf)
+{ const double r = 0.75;
+  size_t i;
+  unsigned x=1;
+  cdf[0]=0.0f;
+  for(i=1;i<=NSYM;++i)
+    cdf[i]=(real)((1.0-pow(r,(double)i))/(1.0-pow(r,NSYM)));
+  cdf[NSYM]=1.0f;
+  for(i=0;i<n;++i)
+  { double u;
+    u8 k=0;
+    x = x*1103515245+12345;
+    u = (x>>8)/(double)(1<<24);
+    while(k<NSYM-1 && cdf[k+1]<=u) ++k;
+    s[i]=k;
+  }
+}
+
+static void report(const char *name, size_t n, size_t nbytes, double te, double td)
+{ printf("%-8s %10llu bytes (%6.3f bits/symbol)  encode %8.2f MB/s  decode %8.2f MB/s"ENDL,
+      name,(u64)nbytes,8.0*nbytes/n,n/te/1e6,n/td/1e6);
+}
+
+int main(int argc, char* argv[])
+{ size_t n = (argc>1?atoi(argv[1]):16)<<20;
+  real   cdf[NSYM+1];
+  u8    *s,*t=NULL;
+  void  *out=NULL;
+  size_t nout=0,nt=0;
+  double t0,t1,t2;
+
+  s = malloc(n);
+  make_message(s,n,cdf);
+
+  t0=now();
+  encode_u8_u8(&out,&nout,s,n,cdf,NSYM);
+  t1=now();
+  decode_u8_u8(&t,&nt,out,nout,cdf,NSYM);
+  t2=now();
+  if(nt!=n || memcmp(s,t,n)) printf("*** ac: round trip failed"ENDL);
+  report("ac",n,nout,t1-t0,t2-t1);
+
+  nout=nt=0;
+  free(out); out=NULL;
+  free(t);   t=NULL;
+  t0=now();
+  rans_encode_u8_u8(&out,&nout,s,n,cdf,NSYM);
+  t1=now();
+  rans_decode_u8_u8(&t,&nt,out,nout,cdf,NSYM);
+  t2=now();
+  if(nt!=n || memcmp(s,t,n)) printf("*** rans: round trip failed"ENDL);
+  report("rans",n,nout,t1-t0,t2-t1);
+
+  nout=nt=0;
+  free(out); out=NULL;
+  free(t);   t=NULL;
+  t0=now();
+  tans_encode_u8(&out,&nout,s,n,cdf,NSYM);
+  t1=now();
+  tans_decode_u8(&t,&nt,out,nout);
+  t2=now();
+  if(nt!=n || memcmp(s,t,n)) printf("*** tans: round trip failed"ENDL);
+  report("tans",n,nout,t1-t0,t2-t1);
+
+  free(out);
+  free(t);
+  free(s);
+  return 0;
+}
@@ -0,0 +1,585 @@
+/// \file
+/// Command line compressor.
+///
+/// \verbatim
+/// Usage: ac [options] <input> [-o <output>]
+///   -d                  decompress (default is compress)
+///   -o <file>           output file.  Default: <input>.ac, or <input> without
+///                       .ac when decompressing.
+///   --threads <n>       worker threads (default: number of cpus)
+///   --block-size <n>    bytes per independently coded block.  Accepts k,m
+///                       suffixes.  Default: 1m
+///   --width <w>         output digit: u1|u4|u8|u16 (and u32 where available),
+///                       or auto to pick the digit and model per block.
+///                       Default: u8
+///   --budget <r>        with --width auto, how much bigger (e.g. 0.01 for 1%)
+///                       a block may get for a faster configuration.
+///                       Default: 0.01
+///   --bench             compress and decompress <input> in memory, check the
+///                       round trip and report sizes and speeds.  Writes nothing.
+/// \endverbatim
+///
+/// The input is mapped with mmap.  The model is one static CDF over bytes,
+/// built from a histogram computed by the worker threads.  The input is cut
+/// into blocks that are coded independently: block i goes to worker i mod T.
+/// Each worker hands its coded blocks to the writer thread through its own
+/// single-producer/single-consumer ring, so the writer can take blocks in
+/// order without locks.  The writer frames the blocks and writes them out in
+/// large sequential writes.
+///
+/// Decompression decodes the blocks in parallel straight into the output
+/// buffer with the heap-free decode_*_ws() functions.
+///
+/// With --width auto there is no global model.  Each block is coded by
+/// ac_block_encode() as one block, with its own model, digit and precision.
+///
+/// \section Format
+/// \verbatim
+///   "ACZ" 1        4 bytes magic and version
+///   width          u8, index into the table of output digit types, or 255 (auto)
+///   block size     varint
+///   length         varint, decoded size in bytes
+///   nsym           varint, 0 for auto
+///   cdf            nsym+1 float32, little endian.  Absent for auto.
+///   blocks         for each block: varint coded size, then the coded bytes
+/// \endverbatim
+#define _GNU_SOURCE
+#include "ac.h"
+#include "stream.h"
+#include <stdio.h>
+#include <string.h>
+#include <stdatomic.h>
+#include <pthread.h>
+#include <sched.h>
+#include <time.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#define ENDL "\n"
+#define TRY(e) \
+  do{ if(!(e)) {\
+    fprintf(stderr,"%s(%d):"ENDL "\t%s"ENDL "\tExpression evaluated as false."ENDL, \
+        __FILE__,__LINE__,#e); \
+    goto Error; \
+  }} while(0)
+
+typedef unsigned long long u64;
+
+#define MAGIC      "ACZ\x01"
+#define RING       16          ///< slots per worker ring
+#define FLUSH      (64<<20)    ///< writer flushes once it holds this many bytes
+#define MAXTHREADS 256
+#define AUTO       255         ///< width byte for per-block configuration
+
+//
+// Output digit types
+//
+
+typedef void (*encode_fn)(void **out, size_t *nout, uint8_t *in, size_t nin, real *cdf, size_t nsym);
+typedef int  (*decode_fn)(uint8_t *out, size_t *nout, void *in, size_t nin, real *cdf, size_t nsym, void *ws);
+
+typedef struct _width_t
+{ const char *name;
+  encode_fn   encode;
+  decode_fn   decode;
+  unsigned    bits;    ///< digit width, for ac_static_model_pmin()
+} width_t;
+
+static const width_t g_widths[] =
+{ {"u1" ,encode_u1_u8 ,decode_u8_u1_ws , 1},
+  {"u4" ,encode_u4_u8 ,decode_u8_u4_ws , 4},
+  {"u8" ,encode_u8_u8 ,decode_u8_u8_ws , 8},
+  {"u16",encode_u16_u8,decode_u8_u16_ws,16},
+#ifdef AC_HAVE_U32_OUTPUT
+  {"u32",encode_u32_u8,decode_u8_u32_ws,32},
+#endif
+};
+#define NWIDTHS (sizeof(g_widths)/sizeof(*g_widths))
+
+//
+// Utilities
+//
+
+static double now(void)
+{ struct timespec t;
+  clock_gettime(CLOCK_MONOTONIC,&t);
+  return t.tv_sec+1e-9*t.tv_nsec;
+}
+
+/// Writes all \a n bytes, retrying on short writes.  \returns 0 on success.
+static int write_all(int fd, const void *d, size_t n)
+{ const uint8_t *p=(const uint8_t*)d;
+  while(n)
+  { ssize_t k=write(fd,p,n);
+    if(k<0) return -1;
+    p+=k;
+    n-=(size_t)k;
+  }
+  return 0;
+}
+
+/// Appends \a x as a little endian float32.
+static void push_f32le(stream_t *s, float x)
+{ uint32_t u;
+  int k;
+  memcpy(&u,&x,sizeof(u));
+  for(k=0;k<4;++k)
+    push_u8(s,(uint8_t)(u>>(8*k)));
+}
+
+/// Reads a little endian float32 at \a p.
+static float load_f32le(const uint8_t *p)
+{ const uint32_t u=p[0]|(uint32_t)p[1]<<8|(uint32_t)p[2]<<16|(uint32_t)p[3]<<24;
+  float x;
+  memcpy(&x,&u,sizeof(x));
+  return x;
+}
+
+/// Maps \a path read-only.  Empty files map to NULL with \a *n=0.  \returns 0 on success.
+static int map_file(const char *path, uint8_t **d, size_t *n)
+{ struct stat st;
+  int fd;
+  TRY((fd=open(path,O_RDONLY))>=0);
+  TRY(fstat(fd,&st)==0);
+  *n=(size_t)st.st_size;
+  *d=NULL;
+  if(*n)
+  { TRY((*d=(uint8_t*)mmap(NULL,*n,PROT_READ,MAP_PRIVATE,fd,0))!=MAP_FAILED);
+    madvise(*d,*n,MADV_SEQUENTIAL);
+  }
+  close(fd);
+  return 0;
+Error:
+  perror(path);
+  return -1;
+}
+
+//
+// SPSC ring
+//
+
+typedef struct _chunk_t
+{ void  *d;
+  size_t n;
+} chunk_t;
+
+/// Single producer, single consumer ring.  The indexes only grow.
+typedef struct _ring_t
+{ _Alignas(64) atomic_size_t head;  ///< next slot to fill.  Written by the producer.
+  _Alignas(64) atomic_size_t tail;  ///< next slot to drain.  Written by the consumer.
+  chunk_t slot[RING];
+} ring_t;
+
+static void ring_push(ring_t *r, chunk_t c)
+{ size_t h=atomic_load_explicit(&r->head,memory_order_relaxed);
+  while(h-atomic_load_explicit(&r->tail,memory_order_acquire)==RING)
+    sched_yield();
+  r->slot[h%RING]=c;
+  atomic_store_explicit(&r->head,h+1,memory_order_release);
+}
+
+static chunk_t ring_pop(ring_t *r)
+{ size_t t=atomic_load_explicit(&r->tail,memory_order_relaxed);
+  chunk_t c;
+  while(atomic_load_explicit(&r->head,memory_order_acquire)==t)
+    sched_yield();
+  c=r->slot[t%RING];
+  atomic_store_explicit(&r->tail,t+1,memory_order_release);
+  return c;
+}
+
+//
+// Jobs
+//
+
+typedef struct _job_t
+{ uint8_t       *in;       ///< whole input
+  size_t         nin;
+  size_t         bs;       ///< block size
+  size_t         nblocks;
+  unsigned       nthreads;
+  const width_t *width;    ///< NULL for auto
+  double         budget;   ///< see ac_block_encode()
+  real          *cdf;
+  size_t         nsym;
+  u64            hist[MAXTHREADS][256];
+  ring_t        *rings;    ///< one per worker (compress)
+  stream_t       out;      ///< framed output (compress).  Kept whole unless fd>=0.
+  int            fd;       ///< output file or -1
+  size_t         nwritten; ///< bytes flushed to fd
+  uint8_t      **blocks;   ///< coded block starts (decompress)
+  size_t        *nblock;   ///< coded block sizes (decompress)
+  uint8_t       *dec;      ///< decoded output (decompress)
+  atomic_int     err;      ///< set by any worker.  Read after they're joined.
+} job_t;
+
+typedef struct _worker_t
+{ job_t   *job;
+  unsigned id;
+  pthread_t th;
+} worker_t;
+
+static size_t block_len(job_t *j, size_t i)
+{ size_t o=i*j->bs;
+  return (j->nin-o<j->bs)?(j->nin-o):j->bs;
+}
+
+static void* histogram_worker(void *arg)
+{ worker_t *w=(worker_t*)arg;
+  job_t    *j=w->job;
+  size_t    a=j->nin*w->id/j->nthreads,
+            b=j->nin*(w->id+1)/j->nthreads;
+  u64      *h=j->hist[w->id];
+  memset(h,0,sizeof(j->hist[0]));
+  for(;a<b;++a)
+    h[j->in[a]]++;
+  return NULL;
+}
+
+static void* encode_worker(void *arg)
+{ worker_t *w=(worker_t*)arg;
+  job_t    *j=w->job;
+  size_t    i;
+  for(i=w->id;i<j->nblocks;i+=j->nthreads)
+  { chunk_t c;
+    size_t  n=block_len(j,i);
+    c.n = n/2+64;
+    TRY(c.d = malloc(c.n));
+    if(j->width)
+      j->width->encode(&c.d,&c.n,j->in+i*j->bs,n,j->cdf,j->nsym);
+    else
+      ac_block_encode(&c.d,&c.n,j->in+i*j->bs,n,n,j->budget);
+    ring_push(j->rings+w->id,c);
+  }
+  return NULL;
+Error:
+  abort();
+}
+
+/// Drains the worker rings in block order and frames the blocks.
+static void* writer(void *arg)
+{ job_t *j=(job_t*)arg;
+  size_t i;
+  for(i=0;i<j->nblocks;++i)
+  { chunk_t c=ring_pop(j->rings+i%j->nthreads);
+    push_varint(&j->out,c.n);
+    push_bytes(&j->out,c.d,c.n);
+    free(c.d);
+    if(j->fd>=0 && j->out.ibyte>=FLUSH)
+    { if(write_all(j->fd,j->out.d,j->out.ibyte))
+        atomic_store_explicit(&j->err,1,memory_order_relaxed);
+      j->nwritten+=j->out.ibyte;
+      j->out.ibyte=0;
+    }
+  }
+  return NULL;
+}
+
+static void* decode_worker(void *arg)
+{ worker_t *w=(worker_t*)arg;
+  job_t    *j=w->job;
+  void     *ws=NULL;
+  uint8_t  *tmp=NULL;
+  size_t    i,ntmp=0;
+  TRY(ws=malloc(ac_workspace_size(j->nsym)));
+  for(i=w->id;i<j->nblocks;i+=j->nthreads)
+  { size_t n=block_len(j,i);
+    if(!j->width)
+    { ac_block_decode(&tmp,&ntmp,j->blocks[i],j->nblock[i]); // sized by the stream, so not in place
+      if(ntmp==n)
+        memcpy(j->dec+i*j->bs,tmp,n);
+      n=ntmp;
+    } else if(j->width->decode(j->dec+i*j->bs,&n,j->blocks[i],j->nblock[i],j->cdf,j->nsym,ws))
+      atomic_store_explicit(&j->err,1,memory_order_relaxed);
+    if(n!=block_len(j,i))
+      atomic_store_explicit(&j->err,1,memory_order_relaxed);
+  }
+  free(ws);
+  free(tmp);
+  return NULL;
+Error:
+  abort();
+}
+
+/// Runs \a fn on \a j->nthreads workers and waits for them.
+static void run(job_t *j, void *(*fn)(void*))
+{ worker_t w[MAXTHREADS];
+  unsigned i;
+  for(i=0;i<j->nthreads;++i)
+  { w[i].job=j;
+    w[i].id=i;
+    TRY(pthread_create(&w[i].th,NULL,fn,w+i)==0);
+  }
+  for(i=0;i<j->nthreads;++i)
+    pthread_join(w[i].th,NULL);
+  return;
+Error:
+  abort();
+}
+
+//
+// Model
+//
+
+/// Builds the CDF from the workers' histograms.  Every byte that occurs gets
+/// at least the width's minimum probability.
+static void build_cdf(job_t *j)
+{ double p[256],sum=0.0;
+  size_t i,t;
+  j->nsym=1;
+  for(i=0;i<256;++i)
+  { u64 c=0;
+    for(t=0;t<j->nthreads;++t)
+      c+=j->hist[t][i];
+    p[i]=0.0;
+    if(c)
+    { const double pmin=ac_static_model_pmin(j->width->bits);
+      p[i]=(double)c/(double)j->nin;
+      if(p[i]<2.0*pmin)
+        p[i]=2.0*pmin;
+      sum+=p[i];
+      j->nsym=i+1;
+    }
+  }
+  TRY(j->cdf=malloc(sizeof(real)*(j->nsym+1)));
+  j->cdf[0]=0.0f;
+  { double acc=0.0;
+    for(i=0;i<j->nsym;++i)
+    { acc+=p[i];
+      j->cdf[i+1]=(real)(sum>0.0?acc/sum:1.0);
+    }
+  }
+  j->cdf[j->nsym]=1.0f;
+  return;
+Error:
+  abort();
+}
+
+//
+// Compress / Decompress
+//
+
+/// Compresses \a in.  Writes to \a fd, or keeps the whole output in \a j->out when \a fd<0.
+static int compress(job_t *j)
+{ pthread_t th;
+  size_t    i;
+  j->nblocks=(j->nin+j->bs-1)/j->bs;
+  if(j->width)
+  { run(j,histogram_worker);
+    build_cdf(j);
+  }
+
+  attach(&j->out,NULL,0);
+  push_bytes(&j->out,MAGIC,4);
+  push_u8(&j->out,j->width?(uint8_t)(j->width-g_widths):AUTO);
+  push_varint(&j->out,j->bs);
+  push_varint(&j->out,j->nin);
+  push_varint(&j->out,j->nsym);
+  for(i=0;j->nsym && i<=j->nsym;++i)
+    push_f32le(&j->out,j->cdf[i]);
+
+  TRY(j->rings=calloc(j->nthreads,sizeof(ring_t)));
+  TRY(pthread_create(&th,NULL,writer,j)==0);
+  run(j,encode_worker);
+  pthread_join(th,NULL);
+  if(j->fd>=0)
+  { TRY(write_all(j->fd,j->out.d,j->out.ibyte)==0);
+    j->nwritten+=j->out.ibyte;
+    j->out.ibyte=0;
+  }
+  free(j->rings);
+  j->rings=NULL;
+  return atomic_load(&j->err);
+Error:
+  return -1;
+}
+
+/// Parses the frame in \a in and decodes it into \a j->dec (allocated here).
+static int decompress(job_t *j, uint8_t *in, size_t nin)
+{ stream_t s={0};
+  size_t   i,w;
+  TRY(nin>=5 && memcmp(in,MAGIC,4)==0);
+  attach(&s,in,nin);
+  s.ibyte=4;
+  TRY((w=pop_u8(&s))<NWIDTHS || w==AUTO);
+  j->width  =(w==AUTO)?NULL:g_widths+w;
+  j->bs     =pop_varint(&s);
+  j->nin    =pop_varint(&s);
+  j->nsym   =pop_varint(&s);
+  TRY(j->bs>0 && j->nsym<=256 && (j->nsym>0)==(j->width!=NULL));
+  if(j->width)
+  { TRY(s.ibyte+(j->nsym+1)*4<=nin);
+    TRY(j->cdf=malloc(sizeof(real)*(j->nsym+1)));
+    for(i=0;i<=j->nsym;++i,s.ibyte+=4)
+      j->cdf[i]=load_f32le(in+s.ibyte);
+  }
+
+  j->nblocks=(j->nin+j->bs-1)/j->bs;
+  TRY(j->blocks=malloc(sizeof(*j->blocks)*(j->nblocks+1)));
+  TRY(j->nblock=malloc(sizeof(*j->nblock)*(j->nblocks+1)));
+  for(i=0;i<j->nblocks;++i)
+  { j->nblock[i]=pop_varint(&s);
+    TRY(s.ibyte+j->nblock[i]<=nin);
+    j->blocks[i]=in+s.ibyte;
+    s.ibyte+=j->nblock[i];
+  }
+  detach(&s,NULL,NULL);
+  TRY(j->dec=malloc(j->nin?j->nin:1));
+  run(j,decode_worker);
+  return atomic_load(&j->err);
+Error:
+  fprintf(stderr,"Not a valid ac stream."ENDL);
+  return -1;
+}
+
+static void job_free(job_t *j)
+{ void *d;
+  detach(&j->out,&d,NULL);
+  free(d);
+  free(j->cdf);
+  free(j->blocks);
+  free(j->nblock);
+  free(j->dec);
+}
+
+//
+// Main
+//
+
+static void usage(void)
+{ fprintf(stderr,
+    "Usage: ac [options] <input> [-o <output>]"ENDL
+    "  -d                 decompress"ENDL
+    "  -o <file>          output file (default: <input>.ac, or <input> without .ac)"ENDL
+    "  --threads <n>      worker threads (default: number of cpus)"ENDL
+    "  --block-size <n>   bytes per block, k and m suffixes allowed (default: 1m)"ENDL
+    "  --width <w>        output digit: u1|u4|u8|u16"
+#ifdef AC_HAVE_U32_OUTPUT
+    "|u32"
+#endif
+    "|auto (default: u8)"ENDL
+    "  --budget <r>       size allowance for --width auto (default: 0.01)"ENDL
+    "  --bench            round trip <input> in memory and report speed"ENDL);
+}
+
+static size_t parse_size(const char *s)
+{ char  *e;
+  size_t v=strtoull(s,&e,10);
+  if(*e=='k'||*e=='K') v<<=10;
+  if(*e=='m'||*e=='M') v<<=20;
+  return v;
+}
+
+static int bench(job_t *j)
+{ job_t  *d;
+  double  t0,t1,t2;
+  int     ok;
+  TRY(d=calloc(1,sizeof(*d)));
+  d->nthreads=j->nthreads;
+  t0=now();
+  TRY(compress(j)==0);
+  t1=now();
+  TRY(decompress(d,j->out.d,j->out.ibyte)==0);
+  t2=now();
+  ok = d->nin==j->nin && (!j->nin || memcmp(d->dec,j->in,j->nin)==0);
+  printf("%-4s %2u threads %8zu byte blocks  %12llu -> %12llu bytes (%6.3f bits/byte)  "
+         "compress %8.2f MB/s  decompress %8.2f MB/s  %s"ENDL,
+         j->width?j->width->name:"auto",j->nthreads,j->bs,(u64)j->nin,(u64)j->out.ibyte,
+         j->nin?8.0*j->out.ibyte/j->nin:0.0,
+         j->nin/(t1-t0)/1e6,j->nin/(t2-t1)/1e6,ok?"ok":"*** round trip failed");
+  job_free(d);
+  free(d);
+  return ok?0:-1;
+Error:
+  return -1;
+}
+
+int main(int argc, char* argv[])
+{ job_t      *j=NULL;
+  const char *input=NULL,*output=NULL;
+  char       *defout=NULL;
+  uint8_t    *in=NULL;
+  size_t      nin=0;
+  int         i,dflag=0,bflag=0,ret=1;
+  long        ncpu=sysconf(_SC_NPROCESSORS_ONLN);
+
+  TRY(j=calloc(1,sizeof(*j)));
+  j->fd=-1;
+  j->bs=1<<20;
+  j->width=g_widths+2; // u8
+  j->budget=0.01;
+  j->nthreads=(ncpu>0)?(unsigned)ncpu:1;
+  for(i=1;i<argc;++i)
+  { const char *a=argv[i];
+    if(!strcmp(a,"-d"))                       dflag=1;
+    else if(!strcmp(a,"--bench"))             bflag=1;
+    else if(!strcmp(a,"-o") && i+1<argc)      output=argv[++i];
+    else if(!strcmp(a,"--threads") && i+1<argc)    j->nthreads=(unsigned)atoi(argv[++i]);
+    else if(!strcmp(a,"--block-size") && i+1<argc) j->bs=parse_size(argv[++i]);
+    else if(!strcmp(a,"--budget") && i+1<argc)     j->budget=atof(argv[++i]);
+    else if(!strcmp(a,"--width") && i+1<argc)
+    { size_t k;
+      ++i;
+      for(k=0;k<NWIDTHS && strcmp(argv[i],g_widths[k].name);++k);
+      if(k==NWIDTHS && strcmp(argv[i],"auto")) { usage(); goto Finalize; }
+      j->width=(k<NWIDTHS)?g_widths+k:NULL;
+    }
+    else if(a[0]!='-' && !input)              input=a;
+    else { usage(); goto Finalize; }
+  }
+  if(!input || !j->bs || !j->nthreads || j->nthreads>MAXTHREADS)
+  { usage();
+    goto Finalize;
+  }
+  if(map_file(input,&in,&nin))
+    goto Finalize;
+
+  if(bflag)
+  { j->in=in;
+    j->nin=nin;
+    ret=bench(j)?1:0;
+    goto Finalize;
+  }
+
+  if(!output)
+  { size_t n=strlen(input);
+    TRY(defout=malloc(n+8));
+    strcpy(defout,input);
+    if(dflag)
+    { if(n>3 && !strcmp(input+n-3,".ac")) defout[n-3]='\0';
+      else                                strcat(defout,".out");
+    } else
+      strcat(defout,".ac");
+    output=defout;
+  }
+  if((j->fd=open(output,O_WRONLY|O_CREAT|O_TRUNC,0644))<0)
+  { perror(output);
+    goto Finalize;
+  }
+
+  if(dflag)
+  { if(decompress(j,in,nin)==0 && write_all(j->fd,j->dec,j->nin)==0)
+      ret=0;
+  } else
+  { j->in=in;
+    j->nin=nin;
+    if(compress(j)==0)
+      ret=0;
+  }
+  if(ret)
+    fprintf(stderr,"ac: failed"ENDL);
+
+Finalize:
+  if(j)
+  { if(j->fd>=0) close(j->fd);
+    job_free(j);
+    free(j);
+  }
+  if(in) munmap(in,nin);
+  free(defout);
+  return ret;
+Error:
+  return 1;
+}
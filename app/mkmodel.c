@@ -0,0 +1,188 @@
+/// \file
+/// Static model generator.
+///
+/// \verbatim
+/// Usage: mkmodel [options] <sample>...
+///   -o <file>           output header (default: stdout)
+///   --name <name>       prefix for the generated symbols (default: model)
+///   --nsym <n>          alphabet size, 1..256 (default: 256)
+///   --width <w>         output digit: u1|u4|u8|u16 (and u32 where available).
+///                       Repeat for more than one.  Default: u8
+/// \endverbatim
+///
+/// Trains a byte model on the sample files and writes a C header with the
+/// model's tables as static const data, so coders built against it do no
+/// set up at run time (see sencode_*() and sdecode_*() in ac.h).  For a
+/// name \c m and width \c u8 the header defines
+///
+/// \verbatim
+///   m_cdf            nsym+1 reals, for encode_*()/decode_*()
+///   m_u8_cdf         nsym+1 scaled cumulative counts
+///   m_u8_guide       AC_GUIDE_SIZE+1 entry decoder lookup table
+///   m_u8             the ac_static_model_t over those tables
+/// \endverbatim
+///
+/// Every symbol below nsym gets some probability, even ones that don't
+/// occur in the samples, so any message over the alphabet can be coded.
+/// The floor is ac_static_model_pmin() of the coarsest width asked for, as
+/// in the ac compressor.
+#include "ac.h"
+#include <stdio.h>
+#include <string.h>
+
+#define ENDL "\n"
+#define TRY(e) \
+  do{ if(!(e)) {\
+    fprintf(stderr,"%s(%d):"ENDL "\t%s"ENDL "\tExpression evaluated as false."ENDL, \
+        __FILE__,__LINE__,#e); \
+    goto Error; \
+  }} while(0)
+
+typedef unsigned long long u64;
+
+typedef struct _width_t
+{ const char *name;
+  unsigned    bits;
+} width_t;
+
+static const width_t g_widths[] =
+{ {"u1" , 1},
+  {"u4" , 4},
+  {"u8" , 8},
+  {"u16",16},
+#ifdef AC_HAVE_U32_OUTPUT
+  {"u32",32},
+#endif
+};
+#define NWIDTHS (sizeof(g_widths)/sizeof(*g_widths))
+
+static void usage(void)
+{ fprintf(stderr,
+    "Usage: mkmodel [options] <sample>..."ENDL
+    "  -o <file>          output header (default: stdout)"ENDL
+    "  --name <name>      prefix for the generated symbols (default: model)"ENDL
+    "  --nsym <n>         alphabet size, 1..256 (default: 256)"ENDL
+    "  --width <w>        output digit: u1|u4|u8|u16"
+#ifdef AC_HAVE_U32_OUTPUT
+    "|u32"
+#endif
+    ", may be repeated (default: u8)"ENDL);
+}
+
+/// Adds the bytes of \a path to the histogram \a h.  \returns 0 on success.
+static int count(u64 *h, const char *path)
+{ unsigned char buf[1<<16];
+  size_t n,i;
+  FILE *fp;
+  TRY(fp=fopen(path,"rb"));
+  while((n=fread(buf,1,sizeof(buf),fp))>0)
+    for(i=0;i<n;++i)
+      h[buf[i]]++;
+  fclose(fp);
+  return 0;
+Error:
+  perror(path);
+  return -1;
+}
+
+/// Builds the real cdf from the histogram, with every probability at least \a pmin.
+static void build_cdf(real *cdf, const u64 *h, size_t nsym, double pmin)
+{ double p[256],sum=0.0,acc=0.0,tot=0.0;
+  size_t i;
+  for(i=0;i<nsym;++i)
+    tot+=h[i];
+  for(i=0;i<nsym;++i)
+  { p[i]=tot>0.0?h[i]/tot:1.0/nsym;
+    if(p[i]<2.0*pmin)
+      p[i]=2.0*pmin;
+    sum+=p[i];
+  }
+  cdf[0]=0.0f;
+  for(i=0;i<nsym;++i)
+  { acc+=p[i];
+    cdf[i+1]=(real)(acc/sum);
+  }
+  cdf[nsym]=1.0f;
+}
+
+static void emit(FILE *fp, const char *name, const width_t *w, const ac_static_model_t *m)
+{ size_t i;
+  fprintf(fp,ENDL "static const uint64_t %s_%s_cdf[%zu] = {",name,w->name,m->nsym+1);
+  for(i=0;i<=m->nsym;++i)
+    fprintf(fp,"%s%lluULL,",(i%4)?" ":ENDL "  ",(u64)m->cdf[i]);
+  fprintf(fp,ENDL "};" ENDL);
+  fprintf(fp,ENDL "static const uint32_t %s_%s_guide[%d] = {",name,w->name,AC_GUIDE_SIZE+1);
+  for(i=0;i<=AC_GUIDE_SIZE;++i)
+    fprintf(fp,"%s%u,",(i%16)?" ":ENDL "  ",(unsigned)m->guide[i]);
+  fprintf(fp,ENDL "};" ENDL);
+  fprintf(fp,ENDL "static const ac_static_model_t %s_%s = {%u,%zu,%s_%s_cdf,%s_%s_guide};" ENDL,
+          name,w->name,w->bits,m->nsym,name,w->name,name,w->name);
+}
+
+int main(int argc, char* argv[])
+{ const width_t *widths[NWIDTHS];
+  const char *output=NULL,*name="model";
+  u64    h[256]={0};
+  real   cdf[257];
+  size_t nwidths=0,nsym=256,nfiles=0,k;
+  double pmin=0.0;
+  FILE  *fp=NULL;
+  int    i,ret=1;
+
+  for(i=1;i<argc;++i)
+  { const char *a=argv[i];
+    if(!strcmp(a,"-o") && i+1<argc)             output=argv[++i];
+    else if(!strcmp(a,"--name") && i+1<argc)    name=argv[++i];
+    else if(!strcmp(a,"--nsym") && i+1<argc)    nsym=(size_t)atoi(argv[++i]);
+    else if(!strcmp(a,"--width") && i+1<argc)
+    { ++i;
+      for(k=0;k<NWIDTHS && strcmp(argv[i],g_widths[k].name);++k);
+      if(k==NWIDTHS || nwidths==NWIDTHS) { usage(); goto Finalize; }
+      widths[nwidths++]=g_widths+k;
+    }
+    else if(a[0]!='-')
+    { if(count(h,a))
+        goto Finalize;
+      ++nfiles;
+    }
+    else { usage(); goto Finalize; }
+  }
+  if(!nfiles || nsym<1 || nsym>256)
+  { usage();
+    goto Finalize;
+  }
+  if(!nwidths)
+    widths[nwidths++]=g_widths+2; // u8
+  for(k=0;k<nwidths;++k)
+    if(ac_static_model_pmin(widths[k]->bits)>pmin)
+      pmin=ac_static_model_pmin(widths[k]->bits);
+  build_cdf(cdf,h,nsym,pmin);
+
+  if(!output)
+    fp=stdout;
+  else if(!(fp=fopen(output,"w")))
+  { perror(output);
+    goto Finalize;
+  }
+  fprintf(fp,"// Generated by mkmodel from %zu sample file(s).  Do not edit."ENDL
+             "#pragma once"ENDL
+             "#include \"ac.h\""ENDL,nfiles);
+  fprintf(fp,ENDL "static const real %s_cdf[%zu] = {",name,nsym+1);
+  for(k=0;k<=nsym;++k)
+    fprintf(fp,"%s%#.9gf,",(k%4)?" ":ENDL "  ",cdf[k]);
+  fprintf(fp,ENDL "};" ENDL);
+  for(k=0;k<nwidths;++k)
+  { ac_static_model_t m;
+    ac_static_model_build(&m,widths[k]->bits,cdf,nsym);
+    emit(fp,name,widths[k],&m);
+    ac_static_model_free(&m);
+  }
+  TRY(!ferror(fp));
+  ret=0;
+Finalize:
+  if(fp && fp!=stdout)
+    fclose(fp);
+  return ret;
+Error:
+  goto Finalize;
+}
@@ -25,13 +25,30 @@
      16         2                 2^-16
      32         1                 1
    \endverbatim
+
+   With 128-bit intermediates (where the compiler provides \c unsigned
+   \c __int128) the interval is widened to 64 bits, 2P*bitsof(D) = 128:
+
+   \verbatim
+     bitsof(D)  P                D^(1-P)
+     --------   --               -------
+     32         2                 2^-32
+   \endverbatim
+
+   So u32 output digits renormalize a quarter as often as u8 digits while
+   coding probabilities as small as the u1 coder.  Note the input CDF is
+   given as floats, so near cdf=1.0 the smallest representable probability
+   is about 2^-24; put rare symbols first.
    
    One can see there's a efficiency verses precision trade off here (higher D
    means less renormalizing and so better efficiency).
+
+   ac.hpp has a header-only C++ version of the same coder with these constants
+   fixed at compile time by the output digit type.  It produces the same
+   bitstream.
   
    \section Notes
    - Need to test more!
-     - u1,u4,u16 encoding/decoding not tested
      - random sequences etc...
      - empty stream?
      - streams that generte big carries
@@ -70,6 +87,21 @@
     - \ref CDFs
     - \ref Encoding
     - \ref Decoding
+    - \ref Batch
+    - \ref Workspace
+    - \ref Length
+    - \ref Stepwise
+    - \ref Adaptive
+    - \ref Integers
+    - \ref Predictive
+    - \ref RunLength
+    - \ref Records
+    - \ref Images
+    - \ref Parametric
+    - \ref Extension
+    - \ref Static
+    - \ref Blocks
+    - \ref Scan
 
     \section Example
     \code
@@ -100,7 +132,7 @@
       - Can encoded messages stored as signed or unsigned chars, shorts, longs or long longs.  Keep in mind, however, that the
         number of encodable symbols may be limiting.  You can't encode 2^64 different integers, sorry.
 
-      - Can encode to streams of variable symbol width; either 1,4,8, or 16 bits.  There is are two tradeoffs here.
+      - Can encode to streams of variable symbol width; either 1,4,8,16 or 32 bits.  There is are two tradeoffs here.
 
           - Smaller bit-width (e.g. 1) give better compression than larger bit-width (e.g. 16), but compression is slower (I think?).
 
@@ -166,6 +198,7 @@
     - encode_u1_u64()
     - encode_u4_u64()
     - encode_u8_u64()
+    - encode_u32_u8() ... encode_u32_u64() (64-bit interval, 128-bit products)
 
     Variable symbol encodings are a little different.  These functions take the number of output symbols, \a noutsym,
     as well.  They always encode to a 1-byte stream.  Their form is:
@@ -203,6 +236,7 @@
     - decode_u64_u1()
     - decode_u64_u4()
     - decode_u64_u8()
+    - decode_u8_u32() ... decode_u64_u32()
 
     Variable symbol decoding has the form:
     \code
@@ -214,19 +248,103 @@
     - vdecode_u32()
     - vdecode_u64() 
 
+    \section Batch Batch functions
+
+    Many short messages coded against the same CDF can be coded in one call.
+    The CDF is scaled and the stream is set up once per batch instead of once
+    per message:
+    \code
+    encode_batch_<TDst>_<TSrc>(void **out, size_t *nout, size_t *offsets, TSrc **in, size_t *nin, size_t nmsg, float *cdf, size_t nsym);
+    decode_batch_<TDst>_<TSrc>(TDst **out, size_t *nout, size_t *offsets, uint8_t *in, size_t *inoffsets, size_t nmsg, float *cdf, size_t nsym);
+    \endcode
+    The coded messages are written back to back into \a *out.  Message \a i
+    occupies bytes <tt>offsets[i]</tt> to <tt>offsets[i+1]</tt>, and each one
+    is identical to what encode_<TDst>_<TSrc>() would produce for it alone.
+    Decoding takes the encoder's offsets as \a inoffsets and fills \a offsets
+    with symbol offsets into \a *out.  Both offset arrays have \a nmsg+1
+    elements.
+
+    \section Workspace Heap-free functions
+
+    For short messages the mallocs in encode_*() and decode_*() can cost more
+    than the coding.  The \c _ws variants never touch the heap:
+    \code
+    int encode_<TDst>_<TSrc>_ws(void *out, size_t *nout, TSrc *in, size_t nin, float *cdf, size_t nsym, void *ws);
+    int decode_<TDst>_<TSrc>_ws(TDst *out, size_t *nout, uint8_t *in, size_t nin, float *cdf, size_t nsym, void *ws);
+    \endcode
+    The output goes to the caller's buffer, whose capacity is passed in \a *nout
+    (bytes for encode, symbols for decode).  The scaled CDF goes in \a ws, which
+    must hold ac_workspace_size(nsym) bytes.  For alphabets of at most
+    \c AC_WS_STACK_NSYM symbols \a ws may be NULL and the CDF is kept on the
+    stack.  They return 0 on success and \a *nout is set to the size written.
+    If the output doesn't fit they return -1 and the buffer contents are
+    undefined.
+
+    \section Length Length-prefixed functions
+
+    When the message length is known up front the END symbol is overhead: it
+    takes a slice of the interval on every symbol and codes one more symbol
+    at the end.  The length-prefixed coders store the symbol count as a
+    varint at the front of the stream instead, and give the whole interval
+    to the input alphabet:
+    \code
+    lencode_<TDst>_<TSrc>(void **out, size_t *nout, TSrc *in, size_t nin, float *cdf, size_t nsym);
+    ldecode_<TDst>_<TSrc>(TDst **out, size_t *nout, uint8_t *in, size_t nin, float *cdf, size_t nsym);
+    \endcode
+    The decoder allocates its output once and doesn't test for END.  The
+    streams are not compatible with encode_*() and decode_*().
+
+    \section Stepwise Stepwise coding and bypass bits
+
+    The stepwise coder codes one symbol at a time, so a record can mix
+    modeled symbols with raw bits in a single stream:
+    \code
+    ac_encoder_t *e = ac_encoder_open(AC_u8,cdf,nsym);
+    ac_encode_symbol(e,tag);
+    ac_encode_bits(e,hash,32);        // bypass: 32 equiprobable bits
+    ac_encoder_close(e,&out,&nout);
+
+    ac_decoder_t *d = ac_decoder_open(AC_u8,cdf,nsym,out,nout);
+    tag  = ac_decode_symbol(d);
+    hash = ac_decode_bits(d,32);
+    ac_decoder_close(d);
+    \endcode
+    Bypass bits halve the interval with a shift instead of scaling it by a
+    model, so they cost no multiply and no search.  ac_encode_uniform() and
+    ac_decode_uniform() code a digit in 0..m-1 with every value equally
+    likely.  The split is computed from \a m: no table, and decoding takes
+    one division.  The stream has no END
+    symbol; the decoder must know what comes next.
+
     \author Nathan Clack <https://github.com/nclack>
 */
 
 #include <stdio.h>
 #include <string.h>
+#include "ac.h"
 #include "stream.h"
+#include "bits.h"
+#include "stats.h"
+#include "fenwick.h"
+#include "predict.h"
+#include "param.h"
+#include "normalize.h"
+#include <math.h>
+#ifdef AC_THREADS
+#include <pthread.h>
+#endif
 
 typedef uint8_t   u8;
-typedef uint8_t   u16;
+typedef uint16_t  u16;
 typedef uint32_t  u32;
 typedef uint64_t  u64;
 typedef float     real;
 
+#if defined(__SIZEOF_INT128__)
+#define AC_WIDE                   ///< u32 output streams with 128-bit intermediates are available
+typedef unsigned __int128 u128;
+#endif
+
 #define ENDL "\n"
 #define TRY(e) \
   do{ if(!(e)) {\
@@ -259,22 +377,49 @@ typedef struct _state_t
            mask,    ///< Masks the live bits (can't remember exactly?)
            lowl;    ///< The minimum length of an encodable interval.
   u64     *cdf;     ///< The cdf associated with the input alphabet.  Must be an array of N+1 symbols.
+  ac_stats_t *stats;///< Optional counters.  NULL unless one of the *_stats entry points was used.
 } state_t;
 
-/// A helper function that initializes the parts of the \ref state_t structure that do not depend on stream type.
-static void init_common(state_t *state,u8 *buf,size_t nbuf,real *cdf,size_t nsym)
+/**
+  A helper function that initializes the parts of the \ref state_t structure that do not depend on stream type.
+
+  If \a ws is not NULL, the scaled cdf is stored there instead of on the heap
+  (see ac_workspace_size()).  Don't call free_internal() in that case.
+*/
+static void init_common(state_t *state,u8 *buf,size_t nbuf,real *cdf,size_t nsym,u64 *ws)
 { 
   
-  state->l = (1ULL<<state->shift)-1; // e.g. 2^32-1 for u64
+  state->l = (state->shift<64)?((1ULL<<state->shift)-1):~0ULL; // e.g. 2^32-1 for u64
   state->mask = state->l;            // for modding a u64 to u32 with &
 
   nsym++; // add end symbol
-  TRY( state->cdf=malloc(nsym*sizeof(*state->cdf)) );
+  if(ws)
+    state->cdf=ws;
+  else
+    TRY( state->cdf=malloc(nsym*sizeof(*state->cdf)) );
+#ifdef AC_WIDE
+  if(state->shift==64)            // float can't hold the wide scale; use double
+  { size_t i;
+    u64    top = state->l-state->D;
+    double s   = (double)top;     // rounds up to 2^64-2^32, still representable as u64
+    for(i=0;i<(nsym-1);++i)
+    { u64 c = s*cdf[i];
+      state->cdf[i] = (c<top)?c:top;
+    }
+    state->cdf[i] = top;
+    state->nsym = nsym;
+  } else
+#endif
   { size_t i;
-    real s = state->l-state->D; // scale to D^P range and adjust for end symbol
+    real s = state->l-state->D;   // scale to D^P range and adjust for end symbol
+    u64  top = s;                 // rounded value is what existing u8 streams were coded with,
+    if(top>=state->l)             // but for small D (u1,u4) it rounds up past the end of the
+      top = state->l-state->D;    // interval and leaves no room for the end symbol.
     for(i=0;i<(nsym-1);++i)
-      state->cdf[i] = s*cdf[i];
-    state->cdf[i] = s;
+    { u64 c = s*cdf[i];
+      state->cdf[i] = (c<top)?c:top;
+    }
+    state->cdf[i] = top;
     state->nsym = nsym;
 #if 0
     for(i=0;i<nsym;++i)
@@ -287,37 +432,47 @@ Error:
   abort();
 }
 /// Initialize the state_t structure for \c u1 streams.
-static void init_u1(state_t *state,u8 *buf,size_t nbuf,real *cdf,size_t nsym)
+static void init_u1(state_t *state,u8 *buf,size_t nbuf,real *cdf,size_t nsym,u64 *ws)
 { memset(state,0,sizeof(*state));
   state->D     = 2;
   state->shift = 32; // log2(D^P) - need 2P to fit in a register for multiplies
   state->lowl  = 1ULL<<31; // 2^(shift - log2(D))
-  init_common(state,buf,nbuf,cdf,nsym);
+  init_common(state,buf,nbuf,cdf,nsym,ws);
 }
 /// Initialize the state_t structure for \c u4 streams.
-static void init_u4(state_t *state,u8 *buf,size_t nbuf,real *cdf,size_t nsym)
+static void init_u4(state_t *state,u8 *buf,size_t nbuf,real *cdf,size_t nsym,u64 *ws)
 { memset(state,0,sizeof(*state));
   state->D     = 1ULL<<4;
   state->shift = 32; // log2(D^P) - need 2P to fit in a register for multiplies
   state->lowl  = 1ULL<<28; // 2^(shift - log2(D))
-  init_common(state,buf,nbuf,cdf,nsym);
+  init_common(state,buf,nbuf,cdf,nsym,ws);
 }
 /// Initialize the state_t structure for \c u8 streams.
-static void init_u8(state_t *state,u8 *buf,size_t nbuf,real *cdf,size_t nsym)
+static void init_u8(state_t *state,u8 *buf,size_t nbuf,real *cdf,size_t nsym,u64 *ws)
 { memset(state,0,sizeof(*state));
   state->D     = 1ULL<<8;
   state->shift = 32; // log2(D^P) - need 2P to fit in a register for multiplies
   state->lowl  = 1ULL<<24; // 2^(shift - log2(D))
-  init_common(state,buf,nbuf,cdf,nsym);
+  init_common(state,buf,nbuf,cdf,nsym,ws);
 }
 /// Initialize the state_t structure for \c u16 streams.
-static void init_u16(state_t *state,u8 *buf,size_t nbuf,real *cdf,size_t nsym)
+static void init_u16(state_t *state,u8 *buf,size_t nbuf,real *cdf,size_t nsym,u64 *ws)
 { memset(state,0,sizeof(*state));
   state->D     = 1ULL<<16;
   state->shift = 32;       // log2(D^P) - need 2P to fit in a register for multiplies
   state->lowl  = 1ULL<<16; // 2^(shift - log2(D))
-  init_common(state,buf,nbuf*2,cdf,nsym);
+  init_common(state,buf,nbuf,cdf,nsym,ws);
+}
+#ifdef AC_WIDE
+/// Initialize the state_t structure for \c u32 streams.  64-bit interval with 128-bit products.
+static void init_u32(state_t *state,u8 *buf,size_t nbuf,real *cdf,size_t nsym,u64 *ws)
+{ memset(state,0,sizeof(*state));
+  state->D     = 1ULL<<32;
+  state->shift = 64;       // log2(D^P) - 2P digits need a 128-bit product
+  state->lowl  = 1ULL<<32; // 2^(shift - log2(D))
+  init_common(state,buf,nbuf,cdf,nsym,ws);
 }
+#endif
 /// Releases resources held by the state_t structure.
 static  void free_internal(state_t *state)
 { void *d;
@@ -326,6 +481,53 @@ static  void free_internal(state_t *state)
 //SAFE_FREE(d);
 }
 
+/**
+  Connects \a stats to the coder state and the attached stream.
+
+  Call after init_*().  \a stats may be NULL.  It is always zeroed; the
+  counters are only filled in when compiled with \c AC_STATS.
+*/
+static void attach_stats(state_t *state, ac_stats_t *stats, real *cdf, size_t nsym)
+{ if(!stats) return;
+  memset(stats,0,sizeof(*stats));
+#ifdef AC_STATS
+  state->stats = state->d.stats = stats;
+  { size_t i;
+    for(i=0;i<nsym;++i)
+    { double p = cdf[i+1]-cdf[i];
+      if(p>0.0)
+        stats->entropy -= p*log2(p);
+    }
+  }
+#else
+  (void)state; (void)cdf; (void)nsym;
+#endif
+}
+
+/// Scales \a cdf to [0,top] into \a c, with no END symbol.  See rescale_noend().
+static void scale_noend(u64 *c, u64 top, real *cdf, size_t nsym)
+{ const double s = (double)top;  // for 64-bit intervals this rounds up to 2^64
+  size_t i;
+  for(i=0;i<nsym;++i)
+  { double x = s*cdf[i];
+    c[i] = (x>=s)?top:(u64)x;
+  }
+}
+
+/**
+  Rescales the cdf over the whole interval, leaving no room for the END
+  symbol.  Call after init_*().  Used by the length-prefixed coders.  The
+  scale is the full interval, not the current one, so it can also be called
+  partway through a stream.
+
+  The last input symbol then ends at the end of the interval (see update_*()
+  and dselect_*()).
+*/
+static void rescale_noend(state_t *state, real *cdf, size_t nsym)
+{ scale_noend(state->cdf,state->mask,cdf,nsym);
+  state->nsym = nsym;
+}
+
 //
 // Build CDF
 // 
@@ -394,10 +596,35 @@ Error:
 #define STREAM    (&(state->d))
 #define DATA      (state->d.d)
 #define OFLOW     (STREAM->overflow)
-#define bitsofD   (8)
-#define D         (1ULL<<bitsofD)
+#define bitsof_u1   (1)  ///< log2(D) by output stream type
+#define bitsof_u4   (4)
+#define bitsof_u8   (8)
+#define bitsof_u16  (16)
+#define bitsof_u32  (32)
+#define bitsof_null (8)  ///< erenorm_null() mirrors a u8 stream
+#define bytesof_u1  (1)  ///< push granularity in bytes by output stream type
+#define bytesof_u4  (1)
+#define bytesof_u8  (1)
+#define bytesof_u16 (2)
+#define bytesof_u32 (4)
+
+/// (a*b)>>SHIFT by output stream type.  Only u32 streams need the 128-bit product.
+#define MULSHIFT(a,b)      (((a)*(b))>>SHIFT)
+#define mulshift_u1        MULSHIFT
+#define mulshift_u4        MULSHIFT
+#define mulshift_u8        MULSHIFT
+#define mulshift_u16       MULSHIFT
+#define mulshift_null      MULSHIFT
+#ifdef AC_WIDE
+#define mulshift_u32(a,b)  ((u64)(((u128)(a)*(b))>>64))
+#endif
 #define LOWL      (state->lowl)
 
+#define BIN_BITS  (12)           ///< Precision of adaptive binary probabilities
+#define BIN_ONE   (1<<BIN_BITS)
+#define BIN_RATE  (5)            ///< Adaptation speed: larger is slower
+#define UINT_PREFIX_BITS (7)     ///< Bits needed to code a bit length in 0..64.  See euint_*().
+
 void carry_null(stream_t *s) {} //no op
 void push_null(stream_t *s)  {s->ibyte++;}
 
@@ -406,9 +633,11 @@ void push_null(stream_t *s)  {s->ibyte++;}
   { u64 a,x,y;                                \
     y = L; /* End of interval */              \
     if(s!=(NSYM-1)) /*is not last symbol */   \
-      y = (y*C[s+1])>>SHIFT;                  \
+      y = mulshift_##T(y,C[s+1]);             \
     a = B;                                    \
-    x = (L*C[s])>>SHIFT;                      \
+    x = mulshift_##T(L,C[s]);                 \
+    STAT(state->stats, stat_->nsymbols++;     \
+      stat_->ideal+=log2(L/(double)(y-x)));   \
     B = (B+x)&MASK;                           \
     L = y-x;                                  \
     TRY(L>0);                                 \
@@ -422,46 +651,58 @@ DEFN_UPDATE(u1);
 DEFN_UPDATE(u4);
 DEFN_UPDATE(u8);
 DEFN_UPDATE(u16);
-DEFN_UPDATE(null);
+#ifdef AC_WIDE
+DEFN_UPDATE(u32);
+#endif
 
 #define DEFN_ERENORM(T) \
 static void erenorm_##T(state_t *state) \
 {                                      \
-  const int s = SHIFT-bitsofD;         \
+  const int s = SHIFT-bitsof_##T;      \
   while(L<LOWL)                        \
-  { push_##T(STREAM, B>>s);             \
-    L = (L<<bitsofD)&MASK;             \
-    B = (B<<bitsofD)&MASK;             \
+  { STAT(state->stats, stat_->nrenorm++); \
+    push_##T(STREAM, B>>s);            \
+    L = (L<<bitsof_##T)&MASK;          \
+    B = (B<<bitsof_##T)&MASK;          \
   }                                    \
 }
 DEFN_ERENORM(u1); // typed by output stream type
 DEFN_ERENORM(u4);
 DEFN_ERENORM(u8);
 DEFN_ERENORM(u16);
+#ifdef AC_WIDE
+DEFN_ERENORM(u32);
+#endif
 static void erenorm_null(state_t *state)
 {
-  const int s = SHIFT-bitsofD;
   while(L<LOWL)
   { push_null(STREAM);
-    L = (L<<bitsofD)&MASK;
-    B = (B<<bitsofD)&MASK;
+    L = (L<<bitsof_null)&MASK;
+    B = (B<<bitsof_null)&MASK;
   }
 }
 
 #define DEFN_ESELECT(T) \
   static void eselect_##T(state_t *state)                                                                \
   { u64 a;                                                                                              \
+    int i;                                                                                              \
     a=B;                                                                                                \
-    B=(B+(1ULL<<(SHIFT-bitsofD-1)) )&MASK; /* D^(P-1)/2: (2^8)^(4-1)/2 = 2^24/2 = 2^23 = 2^(32-8-1) */  \
-    L=(1ULL<<(SHIFT-2*bitsofD))-1;         /* requires P>2 */                                           \
+    B=(B+(1ULL<<(SHIFT-bitsof_##T-1)) )&MASK; /* D^(P-1)/2: (2^8)^(4-1)/2 = 2^24/2 = 2^23 = 2^(32-8-1) */\
     if(a>B)                                                                                             \
-      carry_##T(STREAM);                                                                                  \
-    erenorm_##T(state);                     /* output last 2 symbols */                                  \
+      carry_##T(STREAM);                                                                                \
+    for(i=0;i<2;++i)                          /* output last 2 symbols.  Works for P=2 (u16) too. */    \
+    { STAT(state->stats, stat_->nrenorm++);                                                             \
+      push_##T(STREAM, B>>(SHIFT-bitsof_##T));                                                          \
+      B = (B<<bitsof_##T)&MASK;                                                                         \
+    }                                                                                                   \
   }
 DEFN_ESELECT(u1); // typed by output stream type
 DEFN_ESELECT(u4);
 DEFN_ESELECT(u8);
 DEFN_ESELECT(u16);
+#ifdef AC_WIDE
+DEFN_ESELECT(u32);
+#endif
 
 #define DEFN_ESTEP(T) \
   static void estep_##T(state_t *state,u64 s) \
@@ -474,19 +715,136 @@ DEFN_ESTEP(u1); // typed by output stream type
 DEFN_ESTEP(u4);
 DEFN_ESTEP(u8);
 DEFN_ESTEP(u16);
-DEFN_ESTEP(null); // doesn't actually write to stream
+#ifdef AC_WIDE
+DEFN_ESTEP(u32);
+#endif
+
+/**
+  Bypass bits.  Codes the low \a n bits of \a v, high bit first, as
+  equiprobable bits.  Each bit halves the interval with a shift; a one adds
+  the new length to the base.  No multiply and no model lookup.
+*/
+#define DEFN_EBITS(T) \
+  static void ebits_##T(state_t *state, u64 v, unsigned n) \
+  { while(n--)                               \
+    { u64 a=B;                               \
+      L >>= 1;                               \
+      B = (B+(L&(0-((v>>n)&1))))&MASK;       \
+      if(a>B)                                \
+        carry_##T(STREAM);                   \
+      if(L<LOWL)                             \
+        erenorm_##T(state);                  \
+    }                                        \
+  }
+DEFN_EBITS(u1); // typed by output stream type
+DEFN_EBITS(u4);
+DEFN_EBITS(u8);
+DEFN_EBITS(u16);
+#ifdef AC_WIDE
+DEFN_EBITS(u32);
+#endif
+
+/**
+  Uniform model over \a m symbols in closed form: no table and no search.
+
+  With r=(L-1)/m, symbol s<m takes [s*r,(s+1)*r).  The remainder of the
+  interval, at least one unit, is the END symbol, s==m.  Requires m<2^16 so
+  r>0 for every stream type.
+*/
+#define DEFN_EUNIF(T) \
+  static void eunif_##T(state_t *state, u64 s, u64 m) \
+  { const u64 a=B,                           \
+              r=(L-1)/m,                     \
+              x=s*r;                         \
+    L = (s<m)?r:(L-x);                       \
+    B = (B+x)&MASK;                          \
+    if(a>B)                                  \
+      carry_##T(STREAM);                     \
+    if(L<LOWL)                               \
+      erenorm_##T(state);                    \
+  }
+DEFN_EUNIF(u1); // typed by output stream type
+DEFN_EUNIF(u4);
+DEFN_EUNIF(u8);
+DEFN_EUNIF(u16);
+#ifdef AC_WIDE
+DEFN_EUNIF(u32);
+#endif
+DEFN_EUNIF(null);
+
+/**
+  Integer frequency model.  Codes the symbol occupying [cum,cum+freq) out of
+  \a total.  With r=L/total the symbol gets [cum*r,(cum+freq)*r); the last
+  symbol also gets the remainder.  Requires total<=LOWL.  Used by models
+  that aren't a fixed cdf, like the adaptive ones.
+*/
+#define DEFN_EFREQ(T) \
+  static void efreq_##T(state_t *state, u64 cum, u64 freq, u64 total) \
+  { const u64 a=B,                           \
+              r=L/total,                     \
+              x=cum*r;                       \
+    L = (cum+freq<total)?(freq*r):(L-x);     \
+    B = (B+x)&MASK;                          \
+    if(a>B)                                  \
+      carry_##T(STREAM);                     \
+    if(L<LOWL)                               \
+      erenorm_##T(state);                    \
+  }
+DEFN_EFREQ(u1); // typed by output stream type
+DEFN_EFREQ(u4);
+DEFN_EFREQ(u8);
+DEFN_EFREQ(u16);
+#ifdef AC_WIDE
+DEFN_EFREQ(u32);
+#endif
+
+/**
+  Adaptive binary decision.  \a *p is the probability of a 0 out of
+  2^BIN_BITS.  The 0 gets [0,x) with x=(L>>BIN_BITS)*p.  Afterwards \a *p
+  moves 1/2^BIN_RATE of the way toward the bit that was coded.
+*/
+#define DEFN_EBIN(T) \
+  static void ebin_##T(state_t *state, u16 *p, unsigned bit) \
+  { const u64 a=B,                           \
+              x=(L>>BIN_BITS)*(*p);          \
+    if(bit)                                  \
+    { B  = (B+x)&MASK;                       \
+      L -= x;                                \
+      *p -= *p>>BIN_RATE;                    \
+    } else                                   \
+    { L  = x;                                \
+      *p += (BIN_ONE-*p)>>BIN_RATE;          \
+    }                                        \
+    if(a>B)                                  \
+      carry_##T(STREAM);                     \
+    if(L<LOWL)                               \
+      erenorm_##T(state);                    \
+  }
+DEFN_EBIN(u1); // typed by output stream type
+DEFN_EBIN(u4);
+DEFN_EBIN(u8);
+DEFN_EBIN(u16);
+#ifdef AC_WIDE
+DEFN_EBIN(u32);
+#endif
 
 #define DEFN_ENCODE(TOUT,TIN) \
-void encode_##TOUT##_##TIN(void **out, size_t *nout, TIN *in, size_t nin, real *cdf, size_t nsym) \
+void encode_##TOUT##_##TIN##_stats(void **out, size_t *nout, TIN *in, size_t nin, real *cdf, size_t nsym, ac_stats_t *stats) \
 { size_t i;                             \
   state_t s;                            \
-  init_##TOUT(&s,*out,*nout,cdf,nsym);  \
+  init_##TOUT(&s,*out,*nout,cdf,nsym,NULL); \
+  attach_stats(&s,stats,cdf,nsym);      \
   for(i=0;i<nin;++i)                    \
     estep_##TOUT(&s,in[i]);             \
   estep_##TOUT(&s,s.nsym-1);            \
   eselect_##TOUT(&s);                   \
+  pad_bits(&s.d);       /* u1,u4 */     \
+  STAT(stats, stat_->nbits=8*s.d.ibyte); \
   detach(&s.d,out,nout);                \
   free_internal(&s);                    \
+}                                       \
+void encode_##TOUT##_##TIN(void **out, size_t *nout, TIN *in, size_t nin, real *cdf, size_t nsym) \
+{ encode_##TOUT##_##TIN##_stats(out,nout,in,nin,cdf,nsym,NULL); \
 }
 #define DEFN_ENCODE_OUTS(TIN) \
   DEFN_ENCODE(u1,TIN); \
@@ -497,62 +855,86 @@ DEFN_ENCODE_OUTS(u8);
 DEFN_ENCODE_OUTS(u16);
 DEFN_ENCODE_OUTS(u32);
 DEFN_ENCODE_OUTS(u64);
+#ifdef AC_WIDE
+DEFN_ENCODE(u32,u8);
+DEFN_ENCODE(u32,u16);
+DEFN_ENCODE(u32,u32);
+DEFN_ENCODE(u32,u64);
+#endif
 
 //
 // Decode
 //
 
-static u64 dselect(state_t *state, u64 *v, int *isend)
-{ u64 s,n;
-  u64 x,y;
-
-  s = 0;
-  n = NSYM;
-  x = 0;
-  y = L;
-  while( (n-s)>1UL )   // bisection search
-  { u32 m = (s+n)>>1;
-    u64 z = (L*C[m])>>SHIFT;
-    if(z>*v)
-      n=m,y=z;
-    else
-      s=m,x=z;
-  }
-  *v -= x;
-  L = y-x;
-  if(s==(NSYM-1))
-    *isend=1;
-  return s;
+#define DEFN_DSELECT(T) \
+static u64 dselect_##T(state_t *state, u64 *v, int *isend) \
+{ u64 s,n;                                  \
+  u64 x,y;                                  \
+                                            \
+  s = 0;                                    \
+  n = NSYM;                                 \
+  x = 0;                                    \
+  y = L;                                    \
+  while( (n-s)>1UL )   /* bisection search */ \
+  { u32 m = (s+n)>>1;                       \
+    u64 z = mulshift_##T(L,C[m]);           \
+    STAT(state->stats, stat_->nprobe++);    \
+    if(z>*v)                                \
+      n=m,y=z;                              \
+    else                                    \
+      s=m,x=z;                              \
+  }                                         \
+  STAT(state->stats, stat_->nsymbols++;     \
+    stat_->ideal+=log2(L/(double)(y-x)));   \
+  *v -= x;                                  \
+  L = y-x;                                  \
+  if(s==(NSYM-1))                           \
+    *isend=1;                               \
+  return s;                                 \
 }
+DEFN_DSELECT(u1); // typed by input stream type
+DEFN_DSELECT(u4);
+DEFN_DSELECT(u8);
+DEFN_DSELECT(u16);
+#ifdef AC_WIDE
+DEFN_DSELECT(u32);
+#endif
 
 #define DEFN_DRENORM(T) \
 static void drenorm_##T(state_t *state, u64 *v)\
 { while(L<LOWL)                               \
-  { *v = ((*v<<bitsofD)&MASK)+pop_##T(STREAM); \
-    L =   ( L<<bitsofD)&MASK;                 \
+  { STAT(state->stats, stat_->nrenorm++);      \
+    *v = ((*v<<bitsof_##T)&MASK)+pop_##T(STREAM); \
+    L =   ( L<<bitsof_##T)&MASK;              \
   }                                           \
 }
 DEFN_DRENORM(u1);
 DEFN_DRENORM(u4);
 DEFN_DRENORM(u8);
 DEFN_DRENORM(u16);
+#ifdef AC_WIDE
+DEFN_DRENORM(u32);
+#endif
 
 #define DEFN_DPRIME(T) \
 static void dprime_##T(state_t *state, u64* v)                             \
 { size_t i;                                                               \
   *v = 0;                                                                 \
-  for(i=bitsofD;i<=SHIFT;i+=bitsofD)                                      \
+  for(i=bitsof_##T;i<=SHIFT;i+=bitsof_##T)                                \
     *v += (1ULL<<(SHIFT-i))*pop_##T(STREAM); /*(2^8)^(P-n) = 2^(8*(P-n))*/ \
 }
 DEFN_DPRIME(u1);
 DEFN_DPRIME(u4);
 DEFN_DPRIME(u8);
 DEFN_DPRIME(u16);
+#ifdef AC_WIDE
+DEFN_DPRIME(u32);
+#endif
 
 #define DEFN_DSTEP(T) \
 static u64 dstep_##T(state_t *state,u64 *v,int *isend) \
 {                                 \
-  u64 s = dselect(state,v,isend); \
+  u64 s = dselect_##T(state,v,isend);\
   if( L<LOWL )                    \
     drenorm_##T(state,v);         \
   return s;                       \
@@ -561,16 +943,116 @@ DEFN_DSTEP(u1);
 DEFN_DSTEP(u4);
 DEFN_DSTEP(u8);
 DEFN_DSTEP(u16);
+#ifdef AC_WIDE
+DEFN_DSTEP(u32);
+#endif
+
+/// Bypass bits.  Mirrors ebits_*().  \returns the \a n bits, first bit in the high position.
+#define DEFN_DBITS(T) \
+static u64 dbits_##T(state_t *state, u64 *v, unsigned n) \
+{ u64 r=0;                                  \
+  while(n--)                                \
+  { u64 bit;                                \
+    L >>= 1;                                \
+    bit = (*v>=L);                          \
+    *v -= L&(0-bit);                        \
+    r = (r<<1)|bit;                         \
+    if(L<LOWL)                              \
+      drenorm_##T(state,v);                 \
+  }                                         \
+  return r;                                 \
+}
+DEFN_DBITS(u1);
+DEFN_DBITS(u4);
+DEFN_DBITS(u8);
+DEFN_DBITS(u16);
+#ifdef AC_WIDE
+DEFN_DBITS(u32);
+#endif
+
+/// Uniform model over \a m symbols.  Mirrors eunif_*(): one division, no search.  \returns m for END.
+#define DEFN_DUNIF(T) \
+static u64 dunif_##T(state_t *state, u64 *v, u64 m) \
+{ const u64 r=(L-1)/m;                      \
+  u64 s=*v/r,x;                             \
+  if(s>m)                                   \
+    s=m;                                    \
+  x   = s*r;                                \
+  *v -= x;                                  \
+  L   = (s<m)?r:(L-x);                      \
+  if(L<LOWL)                                \
+    drenorm_##T(state,v);                   \
+  return s;                                 \
+}
+DEFN_DUNIF(u1);
+DEFN_DUNIF(u4);
+DEFN_DUNIF(u8);
+DEFN_DUNIF(u16);
+#ifdef AC_WIDE
+DEFN_DUNIF(u32);
+#endif
+
+/// Integer frequency model, step 1.  \returns the count in [0,total) that \a v points to.
+static u64 dtarget(state_t *state, u64 v, u64 total)
+{ u64 t = v/(L/total);
+  return (t<total)?t:(total-1);
+}
+
+/// Integer frequency model, step 2.  Mirrors efreq_*() once the caller has found the symbol.
+#define DEFN_DFREQ(T) \
+static void dfreq_##T(state_t *state, u64 *v, u64 cum, u64 freq, u64 total) \
+{ const u64 r=L/total,                      \
+            x=cum*r;                        \
+  *v -= x;                                  \
+  L   = (cum+freq<total)?(freq*r):(L-x);    \
+  if(L<LOWL)                                \
+    drenorm_##T(state,v);                   \
+}
+DEFN_DFREQ(u1);
+DEFN_DFREQ(u4);
+DEFN_DFREQ(u8);
+DEFN_DFREQ(u16);
+#ifdef AC_WIDE
+DEFN_DFREQ(u32);
+#endif
+
+/// Adaptive binary decision.  Mirrors ebin_*().  \returns the bit.
+#define DEFN_DBIN(T) \
+static unsigned dbin_##T(state_t *state, u64 *v, u16 *p) \
+{ const u64 x=(L>>BIN_BITS)*(*p);           \
+  unsigned bit=(*v>=x);                     \
+  if(bit)                                   \
+  { *v -= x;                                \
+    L  -= x;                                \
+    *p -= *p>>BIN_RATE;                     \
+  } else                                    \
+  { L   = x;                                \
+    *p += (BIN_ONE-*p)>>BIN_RATE;           \
+  }                                         \
+  if(L<LOWL)                                \
+    drenorm_##T(state,v);                   \
+  return bit;                               \
+}
+DEFN_DBIN(u1);
+DEFN_DBIN(u4);
+DEFN_DBIN(u8);
+DEFN_DBIN(u16);
+#ifdef AC_WIDE
+DEFN_DBIN(u32);
+#endif
 
 #define DEFN_DECODE(TOUT,TIN) \
-void decode_##TOUT##_##TIN(TOUT **out, size_t *nout, u8 *in, size_t nin, real *cdf, size_t nsym) \
+void decode_##TOUT##_##TIN##_stats(TOUT **out, size_t *nout, void *in, size_t nin, real *cdf, size_t nsym, ac_stats_t *stats) \
 { state_t s;                                   \
   stream_t d={0};                              \
   u64 v,x;                                     \
   size_t i=0;                                  \
   int isend=0;                                 \
   attach(&d,*out,*nout*sizeof(TOUT));          \
-  init_##TIN(&s,in,nin,cdf,nsym);              \
+  init_##TIN(&s,in,nin,cdf,nsym,NULL);         \
+  attach_stats(&s,stats,cdf,nsym);             \
+  STAT(stats, d.stats=stats;                   \
+              stat_->nbits=8*nin);             \
   dprime_##TIN(&s,&v);                         \
   x=dstep_##TIN(&s,&v,&isend);                 \
   while(!isend)                                \
@@ -580,6 +1062,9 @@ void decode_##TOUT##_##TIN(TOUT **out, size_t *nout, u8 *in, size_t nin, real *c
   free_internal(&s);                           \
   detach(&d,(void**)out,nout);                 \
   *nout /= sizeof(TOUT);                       \
+}                                              \
+void decode_##TOUT##_##TIN(TOUT **out, size_t *nout, void *in, size_t nin, real *cdf, size_t nsym) \
+{ decode_##TOUT##_##TIN##_stats(out,nout,in,nin,cdf,nsym,NULL); \
 }
 #define DEFN_DECODE_OUTS(TIN) \
   DEFN_DECODE(u8,TIN);  \
@@ -590,61 +1075,2416 @@ DEFN_DECODE_OUTS(u1);
 DEFN_DECODE_OUTS(u4);
 DEFN_DECODE_OUTS(u8);
 DEFN_DECODE_OUTS(u16);
+#ifdef AC_WIDE
+DEFN_DECODE_OUTS(u32);
+#endif
 
 //
-// Variable output alphabet encoding
+// Batch
 //
 
-void sync(stream_t *dest, stream_t *src)
-{ dest->d      = src->d;
-  dest->nbytes = src->nbytes;
+/// Resets the interval for the next message of a batch.  Keeps the scaled cdf and the stream.
+static void restart(state_t *state)
+{ B = 0;
+  L = MASK;
 }
-void vdecode1(u8 **out, size_t *nout, u8 *in, size_t nin, real *cdf, size_t nsym, real *tcdf, size_t tsym)
-{ state_t d0,e1;                                   
-  stream_t d={0};                              
-  int isend=0;
-  u64 v0;
-  attach(&d,*out,*nout);          
-  init_u8(&d0,in,nin,tcdf,tsym);            // the tcdf decode
-  init_u8(&e1, 0,  0,tcdf,tsym);            // the tcdf encode - used to check for end symbol
 
-  dprime_u8(&d0,&v0);
-  while(e1.d.ibyte<nin)                     // stop decoding when reencoding reproduces the input string
-  { u8 s = dstep_u8(&d0,&v0,&isend);
-    push_u8(&d,s);
-    estep_null(&e1,s);
+/// Points the input stream of a decoder at the next message of a batch.
+static void rewind_input(state_t *state, u8 *in, size_t nin)
+{ STREAM->d      = in;
+  STREAM->nbytes = nin;
+  STREAM->ibyte  = 0;
+  STREAM->ibit   = 0;
+}
+
+#define DEFN_ENCODE_BATCH(TOUT,TIN) \
+void encode_batch_##TOUT##_##TIN(void **out, size_t *nout, size_t *offsets, TIN **in, size_t *nin, size_t nmsg, real *cdf, size_t nsym) \
+{ size_t i,j;                           \
+  state_t s;                            \
+  init_##TOUT(&s,*out,*nout,cdf,nsym,NULL); \
+  offsets[0]=0;                         \
+  for(j=0;j<nmsg;++j)                   \
+  { restart(&s);                        \
+    for(i=0;i<nin[j];++i)               \
+      estep_##TOUT(&s,in[j][i]);        \
+    estep_##TOUT(&s,s.nsym-1);          \
+    eselect_##TOUT(&s);                 \
+    pad_bits(&s.d);                     \
+    offsets[j+1]=s.d.ibyte;             \
+  }                                     \
+  detach(&s.d,out,nout);                \
+  free_internal(&s);                    \
+}
+#define DEFN_ENCODE_BATCH_OUTS(TIN) \
+  DEFN_ENCODE_BATCH(u1,TIN); \
+  DEFN_ENCODE_BATCH(u4,TIN); \
+  DEFN_ENCODE_BATCH(u8,TIN); \
+  DEFN_ENCODE_BATCH(u16,TIN);
+DEFN_ENCODE_BATCH_OUTS(u8);
+DEFN_ENCODE_BATCH_OUTS(u16);
+DEFN_ENCODE_BATCH_OUTS(u32);
+DEFN_ENCODE_BATCH_OUTS(u64);
+#ifdef AC_WIDE
+DEFN_ENCODE_BATCH(u32,u8);
+DEFN_ENCODE_BATCH(u32,u16);
+DEFN_ENCODE_BATCH(u32,u32);
+DEFN_ENCODE_BATCH(u32,u64);
+#endif
+
+#define DEFN_DECODE_BATCH(TOUT,TIN) \
+void decode_batch_##TOUT##_##TIN(TOUT **out, size_t *nout, size_t *offsets, void *in, size_t *inoffsets, size_t nmsg, real *cdf, size_t nsym) \
+{ state_t s;                                   \
+  stream_t d={0};                              \
+  u64 v,x;                                     \
+  size_t j;                                    \
+  int isend;                                   \
+  attach(&d,*out,*nout*sizeof(TOUT));          \
+  init_##TIN(&s,in,inoffsets[nmsg],cdf,nsym,NULL); \
+  offsets[0]=0;                                \
+  for(j=0;j<nmsg;++j)                          \
+  { restart(&s);                               \
+    rewind_input(&s,(u8*)in+inoffsets[j],inoffsets[j+1]-inoffsets[j]); \
+    isend=0;                                   \
+    dprime_##TIN(&s,&v);                       \
+    x=dstep_##TIN(&s,&v,&isend);               \
+    while(!isend)                              \
+    { push_##TOUT(&d,x);                       \
+      x=dstep_##TIN(&s,&v,&isend);             \
+    }                                          \
+    offsets[j+1]=d.ibyte/sizeof(TOUT);         \
+  }                                            \
+  free_internal(&s);                           \
+  detach(&d,(void**)out,nout);                 \
+  *nout /= sizeof(TOUT);                       \
+}
+#define DEFN_DECODE_BATCH_OUTS(TIN) \
+  DEFN_DECODE_BATCH(u8,TIN);  \
+  DEFN_DECODE_BATCH(u16,TIN); \
+  DEFN_DECODE_BATCH(u32,TIN); \
+  DEFN_DECODE_BATCH(u64,TIN);
+DEFN_DECODE_BATCH_OUTS(u1);
+DEFN_DECODE_BATCH_OUTS(u4);
+DEFN_DECODE_BATCH_OUTS(u8);
+DEFN_DECODE_BATCH_OUTS(u16);
+#ifdef AC_WIDE
+DEFN_DECODE_BATCH_OUTS(u32);
+#endif
+
+//
+// Length-prefixed (no END symbol)
+//
+
+/// Pads a u8-level prefix with zeros so the digits that follow are aligned.
+static void align_digits(stream_t *d, size_t bytesof)
+{ while(d->ibyte%bytesof)
+    push_u8(d,0);
+}
+
+#define DEFN_LENCODE(TOUT,TIN) \
+void lencode_##TOUT##_##TIN(void **out, size_t *nout, TIN *in, size_t nin, real *cdf, size_t nsym) \
+{ size_t i;                             \
+  state_t s;                            \
+  init_##TOUT(&s,*out,*nout,cdf,nsym,NULL); \
+  rescale_noend(&s,cdf,nsym);           \
+  push_varint(&s.d,nin);                \
+  align_digits(&s.d,bytesof_##TOUT);    \
+  for(i=0;i<nin;++i)                    \
+    estep_##TOUT(&s,in[i]);             \
+  eselect_##TOUT(&s);                   \
+  pad_bits(&s.d);                       \
+  detach(&s.d,out,nout);                \
+  free_internal(&s);                    \
+}
+#define DEFN_LENCODE_OUTS(TIN) \
+  DEFN_LENCODE(u1,TIN); \
+  DEFN_LENCODE(u4,TIN); \
+  DEFN_LENCODE(u8,TIN); \
+  DEFN_LENCODE(u16,TIN);
+DEFN_LENCODE_OUTS(u8);
+DEFN_LENCODE_OUTS(u16);
+DEFN_LENCODE_OUTS(u32);
+DEFN_LENCODE_OUTS(u64);
+#ifdef AC_WIDE
+DEFN_LENCODE(u32,u8);
+DEFN_LENCODE(u32,u16);
+DEFN_LENCODE(u32,u32);
+DEFN_LENCODE(u32,u64);
+#endif
+
+/// The output is allocated once and the loop doesn't look for END, so it is unrolled by 4.
+#define DEFN_LDECODE(TOUT,TIN) \
+void ldecode_##TOUT##_##TIN(TOUT **out, size_t *nout, void *in, size_t nin, real *cdf, size_t nsym) \
+{ state_t s;                                   \
+  TOUT *o;                                     \
+  u64 v,i,n;                                   \
+  int isend; /* ignored */                     \
+  init_##TIN(&s,in,nin,cdf,nsym,NULL);         \
+  rescale_noend(&s,cdf,nsym);                  \
+  n = pop_varint(&s.d);                        \
+  s.d.ibyte = (s.d.ibyte+bytesof_##TIN-1)/bytesof_##TIN*bytesof_##TIN; \
+  if(*nout<n)                                  \
+    TRY( *out=realloc(*out,sizeof(TOUT)*n) );  \
+  o = *out;                                    \
+  dprime_##TIN(&s,&v);                         \
+  for(i=0;i+4<=n;i+=4)                         \
+  { o[i  ]=(TOUT)dstep_##TIN(&s,&v,&isend);    \
+    o[i+1]=(TOUT)dstep_##TIN(&s,&v,&isend);    \
+    o[i+2]=(TOUT)dstep_##TIN(&s,&v,&isend);    \
+    o[i+3]=(TOUT)dstep_##TIN(&s,&v,&isend);    \
+  }                                            \
+  for(;i<n;++i)                                \
+    o[i]=(TOUT)dstep_##TIN(&s,&v,&isend);      \
+  *nout = n;                                   \
+  free_internal(&s);                           \
+  return;                                      \
+Error:                                         \
+  abort();                                     \
+}
+#define DEFN_LDECODE_OUTS(TIN) \
+  DEFN_LDECODE(u8,TIN);  \
+  DEFN_LDECODE(u16,TIN); \
+  DEFN_LDECODE(u32,TIN); \
+  DEFN_LDECODE(u64,TIN);
+DEFN_LDECODE_OUTS(u1);
+DEFN_LDECODE_OUTS(u4);
+DEFN_LDECODE_OUTS(u8);
+DEFN_LDECODE_OUTS(u16);
+#ifdef AC_WIDE
+DEFN_LDECODE_OUTS(u32);
+#endif
+
+//
+// Adaptive (Fenwick tree model)
+//
+
+#define ADAPT_INC   32       ///< Frequency added to a symbol each time it's coded.
+#define ADAPT_LIMIT (1<<20)  ///< Largest total before halving, if the stream type allows it.
+
+/// Largest total the adaptive model uses for this stream type.  Keeps L/total>=64.
+static u64 adapt_limit(state_t *state)
+{ u64 lim = LOWL>>6;
+  return (lim<ADAPT_LIMIT)?lim:ADAPT_LIMIT;
+}
+
+/// Counts symbol \a s.  Halves the model when the total gets too big.
+static void adapt(fenwick_t *f, size_t s, u64 limit)
+{ fenwick_add(f,s,ADAPT_INC);
+  if(f->total>limit)
+    fenwick_halve(f);
+}
+
+#define DEFN_AENCODE(TOUT,TIN) \
+void aencode_##TOUT##_##TIN(void **out, size_t *nout, TIN *in, size_t nin, size_t nsym) \
+{ size_t i;                                   \
+  state_t s;                                  \
+  fenwick_t f;                                \
+  u64 lim;                                    \
+  init_##TOUT(&s,*out,*nout,NULL,0,NULL);     \
+  lim = adapt_limit(&s);                      \
+  TRY(nsym>0 && 2*(nsym+1)<=lim);             \
+  fenwick_init(&f,nsym+1);  /* +1 for END */  \
+  for(i=0;i<nin;++i)                          \
+  { const size_t x=(size_t)in[i];             \
+    TRY(x<nsym);                              \
+    efreq_##TOUT(&s,fenwick_prefix(&f,x),f.freq[x],f.total); \
+    adapt(&f,x,lim);                          \
+  }                                           \
+  efreq_##TOUT(&s,f.total-f.freq[nsym],f.freq[nsym],f.total); \
+  eselect_##TOUT(&s);                         \
+  pad_bits(&s.d);                             \
+  detach(&s.d,out,nout);                      \
+  free_internal(&s);                          \
+  fenwick_free(&f);                           \
+  return;                                     \
+Error:                                        \
+  abort();                                    \
+}
+#define DEFN_AENCODE_OUTS(TIN) \
+  DEFN_AENCODE(u1,TIN); \
+  DEFN_AENCODE(u4,TIN); \
+  DEFN_AENCODE(u8,TIN); \
+  DEFN_AENCODE(u16,TIN);
+DEFN_AENCODE_OUTS(u8);
+DEFN_AENCODE_OUTS(u16);
+DEFN_AENCODE_OUTS(u32);
+DEFN_AENCODE_OUTS(u64);
+#ifdef AC_WIDE
+DEFN_AENCODE(u32,u8);
+DEFN_AENCODE(u32,u16);
+DEFN_AENCODE(u32,u32);
+DEFN_AENCODE(u32,u64);
+#endif
+
+#define DEFN_ADECODE(TOUT,TIN) \
+void adecode_##TOUT##_##TIN(TOUT **out, size_t *nout, void *in, size_t nin, size_t nsym) \
+{ state_t s;                                   \
+  stream_t d={0};                              \
+  fenwick_t f;                                 \
+  u64 v,lim;                                   \
+  attach(&d,*out,*nout*sizeof(TOUT));          \
+  init_##TIN(&s,in,nin,NULL,0,NULL);           \
+  lim = adapt_limit(&s);                       \
+  TRY(nsym>0 && 2*(nsym+1)<=lim);              \
+  fenwick_init(&f,nsym+1);                     \
+  dprime_##TIN(&s,&v);                         \
+  for(;;)                                      \
+  { u64 cum;                                   \
+    size_t x=fenwick_find(&f,dtarget(&s,v,f.total),&cum); \
+    dfreq_##TIN(&s,&v,cum,f.freq[x],f.total);  \
+    if(x==nsym)                                \
+      break;                                   \
+    push_##TOUT(&d,(TOUT)x);                   \
+    adapt(&f,x,lim);                           \
+  }                                            \
+  free_internal(&s);                           \
+  fenwick_free(&f);                            \
+  detach(&d,(void**)out,nout);                 \
+  *nout /= sizeof(TOUT);                       \
+  return;                                      \
+Error:                                         \
+  abort();                                     \
+}
+#define DEFN_ADECODE_OUTS(TIN) \
+  DEFN_ADECODE(u8,TIN);  \
+  DEFN_ADECODE(u16,TIN); \
+  DEFN_ADECODE(u32,TIN); \
+  DEFN_ADECODE(u64,TIN);
+DEFN_ADECODE_OUTS(u1);
+DEFN_ADECODE_OUTS(u4);
+DEFN_ADECODE_OUTS(u8);
+DEFN_ADECODE_OUTS(u16);
+#ifdef AC_WIDE
+DEFN_ADECODE_OUTS(u32);
+#endif
+
+//
+// Binarized integers
+//
+
+void ac_uint_model_init(ac_uint_model_t *m)
+{ size_t i;
+  for(i=0;i<AC_UINT_CONTEXTS;++i)
+    m->p[i]=BIN_ONE/2;
+}
+
+/**
+  Codes \a v as its bit length k in 0..64 followed by the k-1 bits below
+  the leading one.  k is coded MSB first as UINT_PREFIX_BITS adaptive
+  binary decisions, each with its own context: the node of a binary tree
+  reached by the bits above it.  The suffix bits are bypass bits.
+*/
+#define DEFN_EUINT(T) \
+  static void euint_##T(state_t *state, u16 *p, u64 v) \
+  { const unsigned k=bitlen(v);              \
+    unsigned i,node=1;                       \
+    for(i=UINT_PREFIX_BITS;i--;)             \
+    { const unsigned bit=(k>>i)&1;           \
+      ebin_##T(state,p+node,bit);            \
+      node = (node<<1)|bit;                  \
+    }                                        \
+    if(k>1)                                  \
+      ebits_##T(state,v,k-1);                \
   }
+DEFN_EUINT(u1); // typed by output stream type
+DEFN_EUINT(u4);
+DEFN_EUINT(u8);
+DEFN_EUINT(u16);
+#ifdef AC_WIDE
+DEFN_EUINT(u32);
+#endif
 
-  detach(&d,(void**)out,nout);
-  { void *b;
-    detach(&e1.d,&b,NULL);
-    if(b) free(b);
+/// Mirrors euint_*().
+#define DEFN_DUINT(T) \
+static u64 duint_##T(state_t *state, u64 *v, u16 *p) \
+{ unsigned i,node=1,k;                      \
+  for(i=UINT_PREFIX_BITS;i--;)              \
+    node = (node<<1)|dbin_##T(state,v,p+node); \
+  k = node-(1u<<UINT_PREFIX_BITS);          \
+  if(k<2)                                   \
+    return k;                               \
+  return (1ULL<<(k-1))|dbits_##T(state,v,k-1); \
+}
+DEFN_DUINT(u1);
+DEFN_DUINT(u4);
+DEFN_DUINT(u8);
+DEFN_DUINT(u16);
+#ifdef AC_WIDE
+DEFN_DUINT(u32);
+#endif
+
+#define DEFN_IENCODE(TOUT,TIN) \
+void iencode_##TOUT##_##TIN(void **out, size_t *nout, TIN *in, size_t nin) \
+{ size_t i;                             \
+  state_t s;                            \
+  ac_uint_model_t m;                    \
+  ac_uint_model_init(&m);               \
+  init_##TOUT(&s,*out,*nout,NULL,0,NULL); \
+  push_varint(&s.d,nin);                \
+  align_digits(&s.d,bytesof_##TOUT);    \
+  for(i=0;i<nin;++i)                    \
+    euint_##TOUT(&s,m.p,in[i]);         \
+  eselect_##TOUT(&s);                   \
+  pad_bits(&s.d);                       \
+  detach(&s.d,out,nout);                \
+  free_internal(&s);                    \
+}
+#define DEFN_IENCODE_OUTS(TIN) \
+  DEFN_IENCODE(u1,TIN); \
+  DEFN_IENCODE(u4,TIN); \
+  DEFN_IENCODE(u8,TIN); \
+  DEFN_IENCODE(u16,TIN);
+DEFN_IENCODE_OUTS(u32);
+DEFN_IENCODE_OUTS(u64);
+#ifdef AC_WIDE
+DEFN_IENCODE(u32,u32);
+DEFN_IENCODE(u32,u64);
+#endif
+
+#define DEFN_IDECODE(TOUT,TIN) \
+void idecode_##TOUT##_##TIN(TOUT **out, size_t *nout, void *in, size_t nin) \
+{ state_t s;                                   \
+  ac_uint_model_t m;                           \
+  u64 v,i,n;                                   \
+  ac_uint_model_init(&m);                      \
+  init_##TIN(&s,in,nin,NULL,0,NULL);           \
+  n = pop_varint(&s.d);                        \
+  s.d.ibyte = (s.d.ibyte+bytesof_##TIN-1)/bytesof_##TIN*bytesof_##TIN; \
+  if(*nout<n)                                  \
+    TRY( *out=realloc(*out,sizeof(TOUT)*n) );  \
+  dprime_##TIN(&s,&v);                         \
+  for(i=0;i<n;++i)                             \
+    out[0][i]=(TOUT)duint_##TIN(&s,&v,m.p);    \
+  *nout = n;                                   \
+  free_internal(&s);                           \
+  return;                                      \
+Error:                                         \
+  abort();                                     \
+}
+#define DEFN_IDECODE_OUTS(TIN) \
+  DEFN_IDECODE(u32,TIN); \
+  DEFN_IDECODE(u64,TIN);
+DEFN_IDECODE_OUTS(u1);
+DEFN_IDECODE_OUTS(u4);
+DEFN_IDECODE_OUTS(u8);
+DEFN_IDECODE_OUTS(u16);
+#ifdef AC_WIDE
+DEFN_IDECODE_OUTS(u32);
+#endif
+
+//
+// Predictive
+//
+
+#define PRED_BLOCK 4096  ///< Values per block.  Each block picks its own transform.
+
+#define DEFN_PENCODE(TOUT,TIN) \
+void pencode_##TOUT##_##TIN(void **out, size_t *nout, TIN *in, size_t nin, ac_pred_t mode) \
+{ size_t i,j;                                   \
+  state_t s;                                    \
+  ac_uint_model_t m[AC_PRED_COUNT];             \
+  TIN r[PRED_BLOCK];                            \
+  TRY(mode<=AC_PRED_AUTO);                      \
+  for(i=0;i<AC_PRED_COUNT;++i)                  \
+    ac_uint_model_init(m+i);                    \
+  init_##TOUT(&s,*out,*nout,NULL,0,NULL);       \
+  push_varint(&s.d,nin);                        \
+  align_digits(&s.d,bytesof_##TOUT);            \
+  for(i=0;i<nin;i+=PRED_BLOCK)                  \
+  { const size_t n=(nin-i<PRED_BLOCK)?(nin-i):PRED_BLOCK; \
+    const ac_pred_t p=(mode==AC_PRED_AUTO)?predict_choose_##TIN(in+i,n):mode; \
+    eunif_##TOUT(&s,p,AC_PRED_COUNT);           \
+    predict_##TIN(r,in+i,n,p);                  \
+    for(j=0;j<n;++j)                            \
+      euint_##TOUT(&s,m[p].p,r[j]);             \
+  }                                             \
+  eselect_##TOUT(&s);                           \
+  pad_bits(&s.d);                               \
+  detach(&s.d,out,nout);                        \
+  free_internal(&s);                            \
+  return;                                       \
+Error:                                          \
+  abort();                                      \
+}
+#define DEFN_PENCODE_OUTS(TIN) \
+  DEFN_PENCODE(u1,TIN); \
+  DEFN_PENCODE(u4,TIN); \
+  DEFN_PENCODE(u8,TIN); \
+  DEFN_PENCODE(u16,TIN);
+DEFN_PENCODE_OUTS(u16);
+DEFN_PENCODE_OUTS(u32);
+#ifdef AC_WIDE
+DEFN_PENCODE(u32,u16);
+DEFN_PENCODE(u32,u32);
+#endif
+
+/// Residuals are decoded straight into the output and the transform is undone in place.
+#define DEFN_PDECODE(TOUT,TIN) \
+void pdecode_##TOUT##_##TIN(TOUT **out, size_t *nout, void *in, size_t nin) \
+{ state_t s;                                    \
+  ac_uint_model_t m[AC_PRED_COUNT];             \
+  u64 v,i,j,n;                                  \
+  for(i=0;i<AC_PRED_COUNT;++i)                  \
+    ac_uint_model_init(m+i);                    \
+  init_##TIN(&s,in,nin,NULL,0,NULL);            \
+  n = pop_varint(&s.d);                         \
+  s.d.ibyte = (s.d.ibyte+bytesof_##TIN-1)/bytesof_##TIN*bytesof_##TIN; \
+  if(*nout<n)                                   \
+    TRY( *out=realloc(*out,sizeof(TOUT)*n) );   \
+  dprime_##TIN(&s,&v);                          \
+  for(i=0;i<n;i+=PRED_BLOCK)                    \
+  { const u64 b=(n-i<PRED_BLOCK)?(n-i):PRED_BLOCK; \
+    const ac_pred_t p=(ac_pred_t)dunif_##TIN(&s,&v,AC_PRED_COUNT); \
+    TOUT *o=*out+i;                             \
+    TRY(p<AC_PRED_COUNT);                       \
+    for(j=0;j<b;++j)                            \
+      o[j]=(TOUT)duint_##TIN(&s,&v,m[p].p);     \
+    unpredict_##TOUT(o,o,b,p);                  \
+  }                                             \
+  *nout = n;                                    \
+  free_internal(&s);                            \
+  return;                                       \
+Error:                                          \
+  abort();                                      \
+}
+#define DEFN_PDECODE_OUTS(TIN) \
+  DEFN_PDECODE(u16,TIN); \
+  DEFN_PDECODE(u32,TIN);
+DEFN_PDECODE_OUTS(u1);
+DEFN_PDECODE_OUTS(u4);
+DEFN_PDECODE_OUTS(u8);
+DEFN_PDECODE_OUTS(u16);
+#ifdef AC_WIDE
+DEFN_PDECODE_OUTS(u32);
+#endif
+
+//
+// Run length
+//
+
+/**
+  Splits the model for run length coding.  \returns the most likely symbol
+  and sets \a lcdf to a new CDF over the other symbols, with the dominant
+  one given no width.  If the other symbols have no probability they're
+  made equally likely so any input can still be coded.  Caller frees
+  \a *lcdf.
+*/
+static size_t run_model(real **lcdf, real *cdf, size_t nsym)
+{ size_t i,d=0,nrest=0;
+  double rest=0.0,c=0.0;
+  real *l=NULL;
+  TRY(nsym>0);
+  TRY( l=malloc(sizeof(real)*(nsym+1)) );
+  for(i=1;i<nsym;++i)
+    if(cdf[i+1]-cdf[i]>cdf[d+1]-cdf[d])
+      d=i;
+  for(i=0;i<nsym;++i)
+    if(i!=d)
+    { rest += cdf[i+1]-cdf[i];
+      nrest++;
+    }
+  for(i=0;i<nsym;++i)
+  { l[i] = (real)c;
+    if(i!=d)
+      c += (rest>0.0)?(cdf[i+1]-cdf[i])/rest:1.0/nrest;
   }
-  free_internal(&d0);
-  free_internal(&e1);
+  l[nsym] = 1.0f;
+  *lcdf = l;
+  return d;
+Error:
+  abort();
+}
+
+#define DEFN_RENCODE(TOUT,TIN) \
+void rencode_##TOUT##_##TIN(void **out, size_t *nout, TIN *in, size_t nin, real *cdf, size_t nsym) \
+{ size_t i=0,d;                                 \
+  state_t s;                                    \
+  ac_uint_model_t m;                            \
+  real *lcdf=NULL;                              \
+  d = run_model(&lcdf,cdf,nsym);                \
+  ac_uint_model_init(&m);                       \
+  init_##TOUT(&s,*out,*nout,lcdf,nsym,NULL);    \
+  rescale_noend(&s,lcdf,nsym);                  \
+  push_varint(&s.d,nin);                        \
+  align_digits(&s.d,bytesof_##TOUT);            \
+  while(i<nin)                                  \
+  { size_t r=i;                                 \
+    while(r<nin && in[r]==d)                    \
+      ++r;                                      \
+    euint_##TOUT(&s,m.p,r-i);                   \
+    if(r<nin)                                   \
+      estep_##TOUT(&s,in[r++]);                 \
+    i=r;                                        \
+  }                                             \
+  eselect_##TOUT(&s);                           \
+  pad_bits(&s.d);                               \
+  detach(&s.d,out,nout);                        \
+  free_internal(&s);                            \
+  free(lcdf);                                   \
+}
+#define DEFN_RENCODE_OUTS(TIN) \
+  DEFN_RENCODE(u1,TIN); \
+  DEFN_RENCODE(u4,TIN); \
+  DEFN_RENCODE(u8,TIN); \
+  DEFN_RENCODE(u16,TIN);
+DEFN_RENCODE_OUTS(u8);
+DEFN_RENCODE_OUTS(u16);
+DEFN_RENCODE_OUTS(u32);
+DEFN_RENCODE_OUTS(u64);
+#ifdef AC_WIDE
+DEFN_RENCODE(u32,u8);
+DEFN_RENCODE(u32,u16);
+DEFN_RENCODE(u32,u32);
+DEFN_RENCODE(u32,u64);
+#endif
+
+/// Runs are expanded with a fill loop, which the compiler turns into memset() or vector stores.
+#define DEFN_RDECODE(TOUT,TIN) \
+void rdecode_##TOUT##_##TIN(TOUT **out, size_t *nout, void *in, size_t nin, real *cdf, size_t nsym) \
+{ state_t s;                                    \
+  ac_uint_model_t m;                            \
+  real *lcdf=NULL;                              \
+  TOUT *o,d;                                    \
+  u64 v,i=0,n;                                  \
+  int isend; /* ignored */                      \
+  d = (TOUT)run_model(&lcdf,cdf,nsym);          \
+  ac_uint_model_init(&m);                       \
+  init_##TIN(&s,in,nin,lcdf,nsym,NULL);         \
+  rescale_noend(&s,lcdf,nsym);                  \
+  n = pop_varint(&s.d);                         \
+  s.d.ibyte = (s.d.ibyte+bytesof_##TIN-1)/bytesof_##TIN*bytesof_##TIN; \
+  if(*nout<n)                                   \
+    TRY( *out=realloc(*out,sizeof(TOUT)*n) );   \
+  o = *out;                                     \
+  dprime_##TIN(&s,&v);                          \
+  while(i<n)                                    \
+  { const u64 r=duint_##TIN(&s,&v,m.p),e=i+r;   \
+    TRY(r<=n-i);                                \
+    for(;i<e;++i)                               \
+      o[i]=d;                                   \
+    if(i<n)                                     \
+      o[i++]=(TOUT)dstep_##TIN(&s,&v,&isend);   \
+  }                                             \
+  *nout = n;                                    \
+  free_internal(&s);                            \
+  free(lcdf);                                   \
+  return;                                       \
+Error:                                          \
+  abort();                                      \
+}
+#define DEFN_RDECODE_OUTS(TIN) \
+  DEFN_RDECODE(u8,TIN);  \
+  DEFN_RDECODE(u16,TIN); \
+  DEFN_RDECODE(u32,TIN); \
+  DEFN_RDECODE(u64,TIN);
+DEFN_RDECODE_OUTS(u1);
+DEFN_RDECODE_OUTS(u4);
+DEFN_RDECODE_OUTS(u8);
+DEFN_RDECODE_OUTS(u16);
+#ifdef AC_WIDE
+DEFN_RDECODE_OUTS(u32);
+#endif
+
+//
+// Records
+//
+
+#define RECORD_COLUMNS 1 ///< Header flag: one sub-stream per field.
+
+/// Reads an unsigned field of \a bytes bytes.  memcpy() since records needn't be aligned.
+static u64 load_field(const u8 *p, size_t bytes)
+{ switch(bytes)
+  { case 1: return *p;
+    case 2: { u16 v; memcpy(&v,p,2); return v; }
+    case 4: { u32 v; memcpy(&v,p,4); return v; }
+    default:{ u64 v; memcpy(&v,p,8); return v; }
+  }
+}
+
+static void store_field(u8 *p, size_t bytes, u64 v)
+{ switch(bytes)
+  { case 1: *p=(u8)v; break;
+    case 2: { u16 t=(u16)v; memcpy(p,&t,2); } break;
+    case 4: { u32 t=(u32)v; memcpy(p,&t,4); } break;
+    default:  memcpy(p,&v,8);
+  }
+}
+
+/// Checks the schema and scales each field's cdf to the interval \a top.  Caller frees the returned models.
+static u64** record_models(const ac_field_t *f, size_t nf, size_t stride, u64 top)
+{ u64 **c=NULL;
+  size_t i;
+  TRY(nf>0);
+  TRY( c=calloc(nf,sizeof(*c)) );
+  for(i=0;i<nf;++i)
+  { TRY(f[i].bytes==1 || f[i].bytes==2 || f[i].bytes==4 || f[i].bytes==8);
+    TRY(f[i].offset+f[i].bytes<=stride);
+    TRY(f[i].nsym>0);
+    TRY( c[i]=malloc(sizeof(u64)*(f[i].nsym+1)) );
+    scale_noend(c[i],top,f[i].cdf,f[i].nsym);
+  }
+  return c;
+Error:
+  abort();
+}
+
+static void record_models_free(u64 **c, size_t nf)
+{ size_t i;
+  for(i=0;i<nf;++i)
+    free(c[i]);
+  free(c);
+}
+
+/// Points the coder at field \a i's model.
+#define RECORD_MODEL(s,i)  do{ (s).cdf=c[i]; (s).nsym=f[i].nsym; }while(0)
+
+/**
+  Interleaved records go in one stream after the header.  In column mode,
+  each field is coded into its own stream and the header is followed by
+  the size and bytes of each.
+*/
+#define DEFN_RECORD_ENCODE(T) \
+static void record_encode_##T(stream_t *d, int columns, const u8 *rec, size_t stride, size_t nrec, \
+                              const ac_field_t *f, size_t nf) \
+{ state_t s;                                    \
+  u64 ws,**c;                                   \
+  size_t i,j;                                   \
+  init_##T(&s,d->d,d->nbytes,NULL,0,&ws);       \
+  c = record_models(f,nf,stride,s.l);           \
+  if(!columns)                                  \
+  { s.d = *d;                                   \
+    align_digits(&s.d,bytesof_##T);             \
+    for(i=0;i<nrec;++i,rec+=stride)             \
+      for(j=0;j<nf;++j)                         \
+      { RECORD_MODEL(s,j);                      \
+        estep_##T(&s,load_field(rec+f[j].offset,f[j].bytes)); \
+      }                                         \
+    eselect_##T(&s);                            \
+    pad_bits(&s.d);                             \
+    *d = s.d;                                   \
+  } else                                        \
+  { for(j=0;j<nf;++j)                           \
+    { const u8 *r=rec+f[j].offset;              \
+      void *b=NULL;                             \
+      size_t nb=0;                              \
+      init_##T(&s,NULL,0,NULL,0,&ws);           \
+      RECORD_MODEL(s,j);                        \
+      for(i=0;i<nrec;++i,r+=stride)             \
+        estep_##T(&s,load_field(r,f[j].bytes)); \
+      eselect_##T(&s);                          \
+      pad_bits(&s.d);                           \
+      detach(&s.d,&b,&nb);                      \
+      push_varint(d,nb);                        \
+      push_bytes(d,b,nb);                       \
+      free(b);                                  \
+    }                                           \
+  }                                             \
+  record_models_free(c,nf);                     \
+}
+
+#define DEFN_RECORD_DECODE(T) \
+static void record_decode_##T(u8 *rec, size_t stride, size_t nrec, int columns, const u8 *in, size_t nin, \
+                              size_t ibyte, const ac_field_t *f, size_t nf) \
+{ state_t s;                                    \
+  u64 ws,v,**c;                                 \
+  size_t i,j;                                   \
+  int isend; /* ignored */                      \
+  init_##T(&s,(u8*)in,nin,NULL,0,&ws);          \
+  c = record_models(f,nf,stride,s.l);           \
+  if(!columns)                                  \
+  { s.d.ibyte = (ibyte+bytesof_##T-1)/bytesof_##T*bytesof_##T; \
+    dprime_##T(&s,&v);                          \
+    for(i=0;i<nrec;++i,rec+=stride)             \
+      for(j=0;j<nf;++j)                         \
+      { RECORD_MODEL(s,j);                      \
+        store_field(rec+f[j].offset,f[j].bytes,dstep_##T(&s,&v,&isend)); \
+      }                                         \
+  } else                                        \
+  { stream_t h={0};                             \
+    attach(&h,(u8*)in,nin);                     \
+    h.ibyte = ibyte;                            \
+    for(j=0;j<nf;++j)                           \
+    { u8 *r=rec+f[j].offset;                    \
+      const size_t nb=pop_varint(&h);           \
+      TRY(h.ibyte+nb<=nin);                     \
+      init_##T(&s,(u8*)in+h.ibyte,nb,NULL,0,&ws); \
+      h.ibyte += nb;                            \
+      RECORD_MODEL(s,j);                        \
+      dprime_##T(&s,&v);                        \
+      for(i=0;i<nrec;++i,r+=stride)             \
+        store_field(r,f[j].bytes,dstep_##T(&s,&v,&isend)); \
+    }                                           \
+    detach(&h,NULL,NULL);                       \
+  }                                             \
+  record_models_free(c,nf);                     \
+  return;                                       \
+Error:                                          \
+  abort();                                      \
+}
+DEFN_RECORD_ENCODE(u1);
+DEFN_RECORD_ENCODE(u4);
+DEFN_RECORD_ENCODE(u8);
+DEFN_RECORD_ENCODE(u16);
+DEFN_RECORD_DECODE(u1);
+DEFN_RECORD_DECODE(u4);
+DEFN_RECORD_DECODE(u8);
+DEFN_RECORD_DECODE(u16);
+#ifdef AC_WIDE
+DEFN_RECORD_ENCODE(u32);
+DEFN_RECORD_DECODE(u32);
+#endif
+
+#define CASE_RECORD_ENCODE(T) case AC_##T: record_encode_##T(&d,columns,(const u8*)rec,stride,nrec,fields,nfields); break
+#define CASE_RECORD_DECODE(T) case AC_##T: record_decode_##T((u8*)rec,stride,n,flags&RECORD_COLUMNS,(const u8*)in,nin,d.ibyte,fields,nfields); break
+
+void ac_record_encode(ac_width_t width, int columns, void **out, size_t *nout,
+                      const void *rec, size_t stride, size_t nrec, const ac_field_t *fields, size_t nfields)
+{ stream_t d={0};
+  attach(&d,*out,*nout);
+  push_varint(&d,nrec);
+  push_varint(&d,columns?RECORD_COLUMNS:0);
+  switch(width)
+  { CASE_RECORD_ENCODE(u1);
+    CASE_RECORD_ENCODE(u4);
+    CASE_RECORD_ENCODE(u8);
+    CASE_RECORD_ENCODE(u16);
+#ifdef AC_WIDE
+    CASE_RECORD_ENCODE(u32);
+#endif
+    default: TRY(0);
+  }
+  detach(&d,out,nout);
+  return;
+Error:
+  abort();
+}
+
+size_t ac_record_count(const void *in, size_t nin)
+{ stream_t d={0};
+  size_t n;
+  attach(&d,(void*)in,nin);
+  n = pop_varint(&d);
+  detach(&d,NULL,NULL);
+  return n;
+}
+
+size_t ac_record_decode(ac_width_t width, void *rec, size_t stride, size_t nrec,
+                        const void *in, size_t nin, const ac_field_t *fields, size_t nfields)
+{ stream_t d={0};
+  size_t n,flags;
+  attach(&d,(void*)in,nin);
+  n     = pop_varint(&d);
+  flags = pop_varint(&d);
+  TRY(n<=nrec);
+  switch(width)
+  { CASE_RECORD_DECODE(u1);
+    CASE_RECORD_DECODE(u4);
+    CASE_RECORD_DECODE(u8);
+    CASE_RECORD_DECODE(u16);
+#ifdef AC_WIDE
+    CASE_RECORD_DECODE(u32);
+#endif
+    default: TRY(0);
+  }
+  detach(&d,NULL,NULL);
+  return n;
+Error:
+  abort();
+}
+
+//
+// Images
+//
+
+#define IMG_STRIPE 64  ///< Rows per independently coded stripe.
+#define IMG_NCTX   16  ///< Gradient contexts.  See image_context().
+
+/**
+  Predicts pixel \a x of \a row and picks its context.
+
+  The prediction is LOCO-I's median edge detector over the left (a), up
+  (b) and up-left (c) neighbours.  The context is the bit length of the
+  local gradient |d-b|+|b-c|+|c-a|, where d is up-right: flat regions and
+  edges get separate models.  Missing neighbours (first row of a stripe,
+  first or last column) are replaced by ones that exist.
+*/
+static unsigned image_context(const u16 *row, const u16 *up, size_t x, size_t w, u16 *pred)
+{ u32 a,b,c,d,g,mx,mn;
+  a = x?row[x-1]:(up?up[0]:0);
+  if(up)
+  { b = up[x];
+    c = x?up[x-1]:b;
+    d = (x+1<w)?up[x+1]:b;
+  } else
+    b = c = d = a;
+  mx = (a>b)?a:b;
+  mn = (a>b)?b:a;
+  *pred = (u16)((c>=mx)?mn:(c<=mn)?mx:(a+b-c));
+  g = ((d>b)?d-b:b-d)+((b>c)?b-c:c-b)+((c>a)?c-a:a-c);
+  g = bitlen(g);
+  return (g<IMG_NCTX)?g:(IMG_NCTX-1);
+}
+
+/// One stripe of an image.  Coded independently of the others.
+typedef struct _image_job_t
+{ ac_width_t  width;
+  u16        *img;         ///< first row of the stripe
+  size_t      w,h,stride;  ///< h is rows in this stripe, stride is in pixels
+  void       *buf;         ///< coded stripe
+  size_t      nbuf;
+} image_job_t;
+
+#define DEFN_IMAGE(T) \
+static void image_encode_##T(image_job_t *j)    \
+{ state_t s;                                    \
+  ac_uint_model_t m[IMG_NCTX];                  \
+  u64 ws;                                       \
+  size_t x,y,i;                                 \
+  for(i=0;i<IMG_NCTX;++i)                       \
+    ac_uint_model_init(m+i);                    \
+  init_##T(&s,NULL,0,NULL,0,&ws);               \
+  for(y=0;y<j->h;++y)                           \
+  { const u16 *row=j->img+y*j->stride,          \
+              *up =y?row-j->stride:NULL;        \
+    for(x=0;x<j->w;++x)                         \
+    { u16 p;                                    \
+      const unsigned c=image_context(row,up,x,j->w,&p); \
+      euint_##T(&s,m[c].p,ZIGZAG(u16,int16_t,row[x]-p));  \
+    }                                           \
+  }                                             \
+  eselect_##T(&s);                              \
+  pad_bits(&s.d);                               \
+  detach(&s.d,&j->buf,&j->nbuf);                \
+}                                               \
+static void image_decode_##T(image_job_t *j)    \
+{ state_t s;                                    \
+  ac_uint_model_t m[IMG_NCTX];                  \
+  u64 ws,v;                                     \
+  size_t x,y,i;                                 \
+  for(i=0;i<IMG_NCTX;++i)                       \
+    ac_uint_model_init(m+i);                    \
+  init_##T(&s,(u8*)j->buf,j->nbuf,NULL,0,&ws);  \
+  dprime_##T(&s,&v);                            \
+  for(y=0;y<j->h;++y)                           \
+  { u16 *row=j->img+y*j->stride,                \
+        *up =y?row-j->stride:NULL;              \
+    for(x=0;x<j->w;++x)                         \
+    { u16 p;                                    \
+      const unsigned c=image_context(row,up,x,j->w,&p); \
+      const u16 e=(u16)duint_##T(&s,&v,m[c].p); \
+      row[x]=(u16)(p+UNZIGZAG(u16,e));            \
+    }                                           \
+  }                                             \
+}
+DEFN_IMAGE(u1);
+DEFN_IMAGE(u4);
+DEFN_IMAGE(u8);
+DEFN_IMAGE(u16);
+#ifdef AC_WIDE
+DEFN_IMAGE(u32);
+#endif
+
+#define CASE_IMAGE(T,op) case AC_##T: image_##op##_##T(j); break
+static void image_encode_job(image_job_t *j)
+{ switch(j->width)
+  { CASE_IMAGE(u1,encode);
+    CASE_IMAGE(u4,encode);
+    CASE_IMAGE(u8,encode);
+    CASE_IMAGE(u16,encode);
+#ifdef AC_WIDE
+    CASE_IMAGE(u32,encode);
+#endif
+    default: abort();
+  }
+}
+static void image_decode_job(image_job_t *j)
+{ switch(j->width)
+  { CASE_IMAGE(u1,decode);
+    CASE_IMAGE(u4,decode);
+    CASE_IMAGE(u8,decode);
+    CASE_IMAGE(u16,decode);
+#ifdef AC_WIDE
+    CASE_IMAGE(u32,decode);
+#endif
+    default: abort();
+  }
+}
+
+/// A worker's share of the stripes: every nthreads'th one, starting at its index.
+typedef struct _image_worker_t
+{ void       (*fn)(image_job_t*);
+  image_job_t *jobs;
+  size_t       njobs,first,step;
+} image_worker_t;
+
+static void* image_work(void *arg)
+{ image_worker_t *w=(image_worker_t*)arg;
+  size_t i;
+  for(i=w->first;i<w->njobs;i+=w->step)
+    w->fn(w->jobs+i);
+  return NULL;
+}
+
+/// Runs \a fn over the stripes on up to \a nthreads threads.  Serial without AC_THREADS.
+static void image_run(void (*fn)(image_job_t*), image_job_t *jobs, size_t njobs, unsigned nthreads)
+{ image_worker_t self={fn,jobs,njobs,0,1};
+#ifdef AC_THREADS
+  if(nthreads>njobs)
+    nthreads=(unsigned)njobs;
+  if(nthreads>1)
+  { pthread_t      *th=NULL;
+    image_worker_t *w=NULL;
+    unsigned i;
+    TRY( th=malloc(sizeof(*th)*nthreads) );
+    TRY( w =malloc(sizeof(*w)*nthreads) );
+    for(i=1;i<nthreads;++i)
+    { w[i].fn=fn; w[i].jobs=jobs; w[i].njobs=njobs; w[i].first=i; w[i].step=nthreads;
+      TRY(pthread_create(th+i,NULL,image_work,w+i)==0);
+    }
+    self.step=nthreads;
+    image_work(&self);                  // the caller takes stripe 0
+    for(i=1;i<nthreads;++i)
+      pthread_join(th[i],NULL);
+    free(th);
+    free(w);
+    return;
+  }
+#endif
+  (void)nthreads;
+  image_work(&self);
+  return;
+#ifdef AC_THREADS
+Error:
+  abort();
+#endif
+}
+
+/// Splits an image into stripes.  Caller frees the returned jobs.
+static image_job_t* image_jobs(ac_width_t width, u16 *img, size_t w, size_t h, size_t stride, size_t *njobs)
+{ image_job_t *jobs=NULL;
+  size_t i;
+  *njobs = (h+IMG_STRIPE-1)/IMG_STRIPE;
+  TRY( jobs=calloc(*njobs?*njobs:1,sizeof(*jobs)) );
+  for(i=0;i<*njobs;++i)
+  { jobs[i].width  = width;
+    jobs[i].img    = img+i*IMG_STRIPE*stride;
+    jobs[i].w      = w;
+    jobs[i].h      = (h-i*IMG_STRIPE<IMG_STRIPE)?(h-i*IMG_STRIPE):IMG_STRIPE;
+    jobs[i].stride = stride;
+  }
+  return jobs;
+Error:
+  abort();
+}
+
+void ac_image_encode(ac_width_t width, void **out, size_t *nout,
+                     const uint16_t *img, size_t w, size_t h, size_t stride, unsigned nthreads)
+{ stream_t d={0};
+  image_job_t *jobs;
+  size_t i,n;
+  TRY(stride>=w);
+  jobs = image_jobs(width,(u16*)img,w,h,stride,&n);
+  image_run(image_encode_job,jobs,n,nthreads);
+  attach(&d,*out,*nout);
+  push_varint(&d,w);
+  push_varint(&d,h);
+  for(i=0;i<n;++i)                  // sizes first so stripes can be located up front
+    push_varint(&d,jobs[i].nbuf);
+  for(i=0;i<n;++i)
+  { push_bytes(&d,jobs[i].buf,jobs[i].nbuf);
+    free(jobs[i].buf);
+  }
+  detach(&d,out,nout);
+  free(jobs);
+  return;
+Error:
+  abort();
+}
+
+void ac_image_size(const void *in, size_t nin, size_t *w, size_t *h)
+{ stream_t d={0};
+  attach(&d,(void*)in,nin);
+  *w = pop_varint(&d);
+  *h = pop_varint(&d);
+  detach(&d,NULL,NULL);
+}
+
+void ac_image_decode(ac_width_t width, uint16_t *img, size_t w, size_t h, size_t stride,
+                     const void *in, size_t nin, unsigned nthreads)
+{ stream_t d={0};
+  image_job_t *jobs;
+  size_t i,n,off;
+  TRY(stride>=w);
+  attach(&d,(void*)in,nin);
+  TRY(pop_varint(&d)==w);
+  TRY(pop_varint(&d)==h);
+  jobs = image_jobs(width,img,w,h,stride,&n);
+  for(i=0;i<n;++i)
+    jobs[i].nbuf = pop_varint(&d);
+  for(i=0,off=d.ibyte;i<n;++i)
+  { TRY(off+jobs[i].nbuf<=nin);
+    jobs[i].buf = (u8*)in+off;
+    off += jobs[i].nbuf;
+  }
+  detach(&d,NULL,NULL);
+  image_run(image_decode_job,jobs,n,nthreads);
+  free(jobs);
+  return;
+Error:
+  abort();
+}
+
+//
+// Parametric
+//
+
+/**
+  Scaled cumulative count of symbol \a k under a parametric model, over
+  [0,top].  Every symbol gets at least \a minw on top of its share, which
+  keeps it codable however far out in the tail it is.  Integer arithmetic
+  throughout, so the intervals are the same on every platform.
+*/
+static u64 param_cum(const ac_param_t *m, size_t k, u64 top, u64 minw)
+{ const u64 span = top-m->nsym*minw,
+            c    = ac_param_cum(m,k);   // 0..2^32
+  return k*minw+((c>=AC_PARAM_ONE)?span:(span>>32)*c+(((span&0xffffffff)*c)>>32));
+}
+
+/// Minimum symbol width.  2*D keeps every symbol at least one unit wide after mulshift() for any L>=LOWL.
+#define PARAM_MINW (2*state->D)
+
+/// \returns 1 if the model's alphabet is small enough for the stream type.  Minimum widths take at most half the interval.
+static int param_fits(state_t *state, const ac_param_t *m)
+{ return m->nsym>0 && m->nsym<=(MASK/2+1)/PARAM_MINW;
+}
+
+#define DEFN_EPARAM(T) \
+  static void eparam_##T(state_t *state, const ac_param_t *m, u64 s) \
+  { const u64 a=B,                           \
+              x=mulshift_##T(L,param_cum(m,s,MASK,PARAM_MINW)), \
+              y=(s+1<m->nsym)?mulshift_##T(L,param_cum(m,s+1,MASK,PARAM_MINW)):L; \
+    B = (B+x)&MASK;                          \
+    L = y-x;                                 \
+    if(a>B)                                  \
+      carry_##T(STREAM);                     \
+    if(L<LOWL)                               \
+      erenorm_##T(state);                    \
+  }
+
+/**
+  Decodes against a parametric model.  The model's quantile function
+  guesses the symbol; a galloping search from the guess then finds the
+  exact one.  A good guess costs two or three CDF evaluations.
+*/
+#define DEFN_DPARAM(T) \
+static u64 dparam_##T(state_t *state, u64 *v, const ac_param_t *m) \
+{ const u64 n=m->nsym;                      \
+  u64 lo,hi,step=1,x,y;                     \
+  lo = ac_param_quantile(m,(double)*v/(double)L); \
+  if(AT_##T(lo)<=*v)                        \
+  { hi = lo+1;                              \
+    while(hi<n && AT_##T(hi)<=*v)           \
+    { lo=hi; hi+=step; step<<=1; }          \
+    if(hi>n) hi=n;                          \
+  } else                                    \
+  { hi = lo;                                \
+    while(AT_##T(lo)>*v)  /* AT(0)==0 */    \
+    { hi=lo; lo=(lo>step)?lo-step:0; step<<=1; } \
+  }                                         \
+  while(hi-lo>1)                            \
+  { const u64 mid=(lo+hi)>>1;               \
+    if(AT_##T(mid)<=*v) lo=mid;             \
+    else                hi=mid;             \
+  }                                         \
+  x = AT_##T(lo);                           \
+  y = (lo+1<n)?AT_##T(lo+1):L;              \
+  *v -= x;                                  \
+  L   = y-x;                                \
+  if(L<LOWL)                                \
+    drenorm_##T(state,v);                   \
+  return lo;                                \
+}
+#define DEFN_PARAM(T) \
+  DEFN_EPARAM(T)      \
+  DEFN_DPARAM(T)
+#define AT_u1(k)  mulshift_u1 (L,param_cum(m,k,MASK,PARAM_MINW))
+#define AT_u4(k)  mulshift_u4 (L,param_cum(m,k,MASK,PARAM_MINW))
+#define AT_u8(k)  mulshift_u8 (L,param_cum(m,k,MASK,PARAM_MINW))
+#define AT_u16(k) mulshift_u16(L,param_cum(m,k,MASK,PARAM_MINW))
+#define AT_u32(k) mulshift_u32(L,param_cum(m,k,MASK,PARAM_MINW))
+DEFN_PARAM(u1);
+DEFN_PARAM(u4);
+DEFN_PARAM(u8);
+DEFN_PARAM(u16);
+#ifdef AC_WIDE
+DEFN_PARAM(u32);
+#endif
+
+#define DEFN_MENCODE(TOUT,TIN) \
+void mencode_##TOUT##_##TIN(void **out, size_t *nout, TIN *in, size_t nin, const ac_param_t *m) \
+{ size_t i;                             \
+  state_t s;                            \
+  u64 ws;                               \
+  init_##TOUT(&s,*out,*nout,NULL,0,&ws);\
+  TRY(param_fits(&s,m));                \
+  push_varint(&s.d,nin);                \
+  align_digits(&s.d,bytesof_##TOUT);    \
+  for(i=0;i<nin;++i)                    \
+  { TRY(in[i]<m->nsym);                 \
+    eparam_##TOUT(&s,m,in[i]);          \
+  }                                     \
+  eselect_##TOUT(&s);                   \
+  pad_bits(&s.d);                       \
+  detach(&s.d,out,nout);                \
+  return;                               \
+Error:                                  \
+  abort();                              \
+}
+#define DEFN_MENCODE_OUTS(TIN) \
+  DEFN_MENCODE(u1,TIN); \
+  DEFN_MENCODE(u4,TIN); \
+  DEFN_MENCODE(u8,TIN); \
+  DEFN_MENCODE(u16,TIN);
+DEFN_MENCODE_OUTS(u8);
+DEFN_MENCODE_OUTS(u16);
+DEFN_MENCODE_OUTS(u32);
+DEFN_MENCODE_OUTS(u64);
+#ifdef AC_WIDE
+DEFN_MENCODE(u32,u8);
+DEFN_MENCODE(u32,u16);
+DEFN_MENCODE(u32,u32);
+DEFN_MENCODE(u32,u64);
+#endif
+
+#define DEFN_MDECODE(TOUT,TIN) \
+void mdecode_##TOUT##_##TIN(TOUT **out, size_t *nout, void *in, size_t nin, const ac_param_t *m) \
+{ state_t s;                                   \
+  u64 ws,v,i,n;                                \
+  init_##TIN(&s,in,nin,NULL,0,&ws);            \
+  TRY(param_fits(&s,m));                       \
+  n = pop_varint(&s.d);                        \
+  s.d.ibyte = (s.d.ibyte+bytesof_##TIN-1)/bytesof_##TIN*bytesof_##TIN; \
+  if(*nout<n)                                  \
+    TRY( *out=realloc(*out,sizeof(TOUT)*n) );  \
+  dprime_##TIN(&s,&v);                         \
+  for(i=0;i<n;++i)                             \
+    out[0][i]=(TOUT)dparam_##TIN(&s,&v,m);     \
+  *nout = n;                                   \
+  return;                                      \
+Error:                                         \
+  abort();                                     \
+}
+#define DEFN_MDECODE_OUTS(TIN) \
+  DEFN_MDECODE(u8,TIN);  \
+  DEFN_MDECODE(u16,TIN); \
+  DEFN_MDECODE(u32,TIN); \
+  DEFN_MDECODE(u64,TIN);
+DEFN_MDECODE_OUTS(u1);
+DEFN_MDECODE_OUTS(u4);
+DEFN_MDECODE_OUTS(u8);
+DEFN_MDECODE_OUTS(u16);
+#ifdef AC_WIDE
+DEFN_MDECODE_OUTS(u32);
+#endif
+
+//
+// Guided search
+//
+
+/**
+  Fills the guide table \a g (AC_GUIDE_SIZE+1 entries) for the scaled cdf
+  \a c over \a n symbols.  Entry b is the symbol holding the point
+  b/AC_GUIDE_SIZE of the way through the interval [0,top].
+*/
+static void guide_build(u32 *g, const u64 *c, size_t n, u64 top)
+{ size_t b,j=0;
+  for(b=0;b<=AC_GUIDE_SIZE;++b)
+  { const u64 cb=(top/AC_GUIDE_SIZE)*b;
+    while(j+1<n && c[j+1]<=cb)
+      ++j;
+    g[b]=(u32)j;
+  }
+}
+
+/**
+  Symbol selection through a guide table.  Like dselect_*(), but \a v's
+  bucket is found with one division and the search only runs between the
+  guides of the neighbouring buckets.  That is usually one or two symbols
+  instead of log2(nsym).  Renormalizes.
+
+  The bucket estimate is off by less than D/2^shift of the interval, well
+  under a bucket, so one bucket of margin on each side always brackets the
+  symbol.
+*/
+#define DEFN_GSELECT(T) \
+static u64 gselect_##T(state_t *state, u64 *v, const u32 *guide) \
+{ size_t q=(size_t)((double)*v/(double)L*AC_GUIDE_SIZE); \
+  u64 s,n,x,y;                              \
+  if(q>AC_GUIDE_SIZE) q=AC_GUIDE_SIZE;      \
+  s = guide[(q>0)?q-1:0];                   \
+  n = (q+2<AC_GUIDE_SIZE)?guide[q+2]+1:NSYM; /* last bucket runs to top */ \
+  x = mulshift_##T(L,C[s]);                 \
+  y = (n<NSYM)?mulshift_##T(L,C[n]):L;      \
+  while(n-s>1)                              \
+  { const u64 m=(s+n)>>1,                   \
+              z=mulshift_##T(L,C[m]);       \
+    STAT(state->stats, stat_->nprobe++);    \
+    if(z>*v) n=m,y=z;                       \
+    else     s=m,x=z;                       \
+  }                                         \
+  *v -= x;                                  \
+  L   = y-x;                                \
+  if(L<LOWL)                                \
+    drenorm_##T(state,v);                   \
+  return s;                                 \
+}
+DEFN_GSELECT(u1); // typed by input stream type
+DEFN_GSELECT(u4);
+DEFN_GSELECT(u8);
+DEFN_GSELECT(u16);
+#ifdef AC_WIDE
+DEFN_GSELECT(u32);
+#endif
+
+//
+// Alphabet extension
+//
+
+#define XMAX_NSYM 4096  ///< Largest joint alphabet.  Keeps the scaled table (32 kB) in cache.
+#define XMAX_K    16    ///< Most symbols per joint symbol.
+
+/**
+  Picks the number of symbols per joint symbol.  The largest k, up to
+  \a kmax, such that the joint alphabet has at most XMAX_NSYM symbols, and
+  the least likely tuple still has probability of at least 1/LOWL.  That
+  is the precision rule for encode_*() in ac.h, applied to the tuples.
+*/
+static unsigned extension_k(state_t *state, real *cdf, size_t nsym, unsigned kmax)
+{ double pmin=1.0;
+  size_t i,j=nsym;
+  unsigned k=1;
+  for(i=0;i<nsym;++i)
+  { const double p=cdf[i+1]-cdf[i];
+    if(p>0.0 && p<pmin)
+      pmin=p;
+  }
+  while(k<kmax && j*nsym<=XMAX_NSYM && pow(pmin,k+1)*LOWL>=1.0)
+  { ++k;
+    j*=nsym;
+  }
+  return k;
+}
+
+/// Joint alphabet size for tuples of \a k symbols.  0 if it's bigger than XMAX_NSYM.
+static size_t extension_nsym(size_t nsym, unsigned k)
+{ size_t j=1;
+  while(k--)
+  { if(j*nsym>XMAX_NSYM)
+      return 0;
+    j*=nsym;
+  }
+  return j;
+}
+
+/**
+  Scales the product model over \a k-tuples to the whole interval (no END),
+  first symbol most significant.  Works in double from the symbol
+  probabilities, so small tuple probabilities aren't lost to float
+  rounding in a joint cdf.  Caller frees the result.
+*/
+static u64* extension_model(state_t *state, real *cdf, size_t nsym, unsigned k, size_t njoint)
+{ u64   *c=NULL;
+  double acc=0.0;
+  const double top=(double)state->l;
+  size_t j;
+  TRY( c=malloc(sizeof(*c)*(njoint+1)) );
+  for(j=0;j<njoint;++j)
+  { size_t r=j;
+    double p=1.0;
+    unsigned t;
+    const double x=top*acc;
+    c[j] = (x>=top)?state->l:(u64)x;
+    for(t=0;t<k;++t,r/=nsym)
+      p *= cdf[r%nsym+1]-cdf[r%nsym];
+    acc += p;
+  }
+  c[njoint] = state->l;
+  return c;
+Error:
+  abort();
+}
+
+/// The \a k symbols of every joint symbol, first symbol first.  Caller frees the result.
+static u16* extension_digits(size_t nsym, unsigned k, size_t njoint)
+{ u16 *d=NULL;
+  size_t j;
+  TRY( d=malloc(sizeof(*d)*k*njoint) );
+  for(j=0;j<njoint;++j)
+  { size_t r=j;
+    unsigned t=k;
+    while(t--)
+    { d[j*k+t]=(u16)(r%nsym);
+      r/=nsym;
+    }
+  }
+  return d;
+Error:
+  abort();
+}
+
+/// The most likely symbol.  Pads the last tuple.
+static size_t extension_pad(real *cdf, size_t nsym)
+{ size_t i,d=0;
+  for(i=1;i<nsym;++i)
+    if(cdf[i+1]-cdf[i]>cdf[d+1]-cdf[d])
+      d=i;
+  return d;
+}
+
+#define DEFN_XENCODE(TOUT,TIN) \
+void xencode_##TOUT##_##TIN(void **out, size_t *nout, TIN *in, size_t nin, real *cdf, size_t nsym, unsigned k) \
+{ size_t i,njoint;                              \
+  state_t s;                                    \
+  u64 ws,*c;                                    \
+  const u64 pad=extension_pad(cdf,nsym);        \
+  TRY(nsym>0);                                  \
+  init_##TOUT(&s,*out,*nout,NULL,0,&ws);        \
+  TRY(k<=XMAX_K && extension_nsym(nsym,k));    \
+  k = extension_k(&s,cdf,nsym,k?k:XMAX_K);      \
+  njoint = extension_nsym(nsym,k);              \
+  c = extension_model(&s,cdf,nsym,k,njoint);    \
+  s.cdf  = c;                                   \
+  s.nsym = njoint;                              \
+  push_varint(&s.d,nin);                        \
+  push_varint(&s.d,k);                          \
+  align_digits(&s.d,bytesof_##TOUT);            \
+  for(i=0;i<nin;i+=k)                           \
+  { u64 j=0;                                    \
+    unsigned t;                                 \
+    for(t=0;t<k;++t)                            \
+      j = j*nsym+((i+t<nin)?(u64)in[i+t]:pad);  \
+    estep_##TOUT(&s,j);                         \
+  }                                             \
+  eselect_##TOUT(&s);                           \
+  pad_bits(&s.d);                               \
+  detach(&s.d,out,nout);                        \
+  free(c);                                      \
+  return;                                       \
+Error:                                          \
+  abort();                                      \
+}
+#define DEFN_XENCODE_OUTS(TIN) \
+  DEFN_XENCODE(u1,TIN); \
+  DEFN_XENCODE(u4,TIN); \
+  DEFN_XENCODE(u8,TIN); \
+  DEFN_XENCODE(u16,TIN);
+DEFN_XENCODE_OUTS(u8);
+DEFN_XENCODE_OUTS(u16);
+DEFN_XENCODE_OUTS(u32);
+DEFN_XENCODE_OUTS(u64);
+#ifdef AC_WIDE
+DEFN_XENCODE(u32,u8);
+DEFN_XENCODE(u32,u16);
+DEFN_XENCODE(u32,u32);
+DEFN_XENCODE(u32,u64);
+#endif
+
+/// Joint symbols are split with a table of their digits, so decoding needs no division.
+#define DEFN_XDECODE(TOUT,TIN) \
+void xdecode_##TOUT##_##TIN(TOUT **out, size_t *nout, void *in, size_t nin, real *cdf, size_t nsym) \
+{ state_t s;                                    \
+  u64 ws,*c,v,i,n,njoint;                       \
+  u16 *digits;                                  \
+  u32 *guide=NULL;                              \
+  unsigned k;                                   \
+  TRY(nsym>0);                                  \
+  init_##TIN(&s,in,nin,NULL,0,&ws);             \
+  n = pop_varint(&s.d);                         \
+  k = (unsigned)pop_varint(&s.d);               \
+  s.d.ibyte = (s.d.ibyte+bytesof_##TIN-1)/bytesof_##TIN*bytesof_##TIN; \
+  TRY(k>0 && k<=XMAX_K && (njoint=extension_nsym(nsym,k))); \
+  c = extension_model(&s,cdf,nsym,k,njoint);    \
+  digits = extension_digits(nsym,k,njoint);     \
+  TRY( guide=malloc(sizeof(*guide)*(AC_GUIDE_SIZE+1)) ); \
+  guide_build(guide,c,njoint,s.l);              \
+  s.cdf  = c;                                   \
+  s.nsym = njoint;                              \
+  if(*nout<n)                                   \
+    TRY( *out=realloc(*out,sizeof(TOUT)*n) );   \
+  dprime_##TIN(&s,&v);                          \
+  for(i=0;i+k<=n;i+=k)                          \
+  { const u16 *d=digits+k*gselect_##TIN(&s,&v,guide); \
+    unsigned t;                                 \
+    for(t=0;t<k;++t)                            \
+      out[0][i+t]=(TOUT)d[t];                   \
+  }                                             \
+  if(i<n)                                       \
+  { const u16 *d=digits+k*gselect_##TIN(&s,&v,guide); \
+    for(;i<n;++i,++d)                           \
+      out[0][i]=(TOUT)*d;                       \
+  }                                             \
+  *nout = n;                                    \
+  free(guide);                                  \
+  free(digits);                                 \
+  free(c);                                      \
+  return;                                       \
+Error:                                          \
+  abort();                                      \
+}
+#define DEFN_XDECODE_OUTS(TIN) \
+  DEFN_XDECODE(u8,TIN);  \
+  DEFN_XDECODE(u16,TIN); \
+  DEFN_XDECODE(u32,TIN); \
+  DEFN_XDECODE(u64,TIN);
+DEFN_XDECODE_OUTS(u1);
+DEFN_XDECODE_OUTS(u4);
+DEFN_XDECODE_OUTS(u8);
+DEFN_XDECODE_OUTS(u16);
+#ifdef AC_WIDE
+DEFN_XDECODE_OUTS(u32);
+#endif
+
+//
+// Static models
+//
+
+/**
+  Builds the scaled tables for \a width bit output digits.  The cdf is
+  the one init_common() builds, so the bitstream matches encode_*().
+  Release with ac_static_model_free().
+*/
+void ac_static_model_build(ac_static_model_t *m, unsigned width, real *cdf, size_t nsym)
+{ state_t s;
+  u32  *g=NULL;
+  void *d;
+  memset(m,0,sizeof(*m));
+  switch(width)
+  { case 1:  init_u1 (&s,NULL,0,cdf,nsym,NULL); break;
+    case 4:  init_u4 (&s,NULL,0,cdf,nsym,NULL); break;
+    case 8:  init_u8 (&s,NULL,0,cdf,nsym,NULL); break;
+    case 16: init_u16(&s,NULL,0,cdf,nsym,NULL); break;
+#ifdef AC_WIDE
+    case 32: init_u32(&s,NULL,0,cdf,nsym,NULL); break;
+#endif
+    default: TRY(0);
+  }
+  detach(&s.d,&d,NULL);
+  free(d);
+  TRY( g=malloc(sizeof(*g)*(AC_GUIDE_SIZE+1)) );
+  guide_build(g,s.cdf,s.nsym,s.l);
+  m->width = width;
+  m->nsym  = nsym;
+  m->cdf   = s.cdf;
+  m->guide = g;
+  return;
+Error:
+  abort();
+}
+
+/// Releases the tables of a model made by ac_static_model_build().
+void ac_static_model_free(ac_static_model_t *m)
+{ free((void*)m->cdf);
+  free((void*)m->guide);
+  memset(m,0,sizeof(*m));
+}
+
+/**
+  u16 digits leave 16 bits of interval below the renormalization point, so
+  2^-14 keeps two bits of margin.  The other widths leave 24 or more, and
+  the float CDF's own rounding is the limit: 2^-20.
+*/
+double ac_static_model_pmin(unsigned width)
+{ return (width==16)?1.0/(1<<14):1.0/(1<<20);
+}
+
+/// Points the coder at the model's tables.  Call after init_*().
+static void use_static(state_t *state, const ac_static_model_t *m)
+{ state->cdf  = (u64*)m->cdf;   // only read
+  state->nsym = m->nsym+1;      // END
+}
+
+#define DEFN_SENCODE(TOUT,TIN) \
+void sencode_##TOUT##_##TIN(void **out, size_t *nout, TIN *in, size_t nin, const ac_static_model_t *m) \
+{ state_t s;                                  \
+  u64 ws;                                     \
+  size_t i;                                   \
+  TRY(m->width==bitsof_##TOUT);               \
+  init_##TOUT(&s,*out,*nout,NULL,0,&ws);      \
+  use_static(&s,m);                           \
+  for(i=0;i<nin;++i)                          \
+    estep_##TOUT(&s,in[i]);                   \
+  estep_##TOUT(&s,s.nsym-1);                  \
+  eselect_##TOUT(&s);                         \
+  pad_bits(&s.d);       /* u1,u4 */           \
+  detach(&s.d,out,nout);                      \
+  return;                                     \
+Error:                                        \
+  abort();                                    \
+}
+#define DEFN_SENCODE_OUTS(TIN) \
+  DEFN_SENCODE(u1,TIN); \
+  DEFN_SENCODE(u4,TIN); \
+  DEFN_SENCODE(u8,TIN); \
+  DEFN_SENCODE(u16,TIN);
+DEFN_SENCODE_OUTS(u8);
+DEFN_SENCODE_OUTS(u16);
+DEFN_SENCODE_OUTS(u32);
+DEFN_SENCODE_OUTS(u64);
+#ifdef AC_WIDE
+DEFN_SENCODE(u32,u8);
+DEFN_SENCODE(u32,u16);
+DEFN_SENCODE(u32,u32);
+DEFN_SENCODE(u32,u64);
+#endif
+
+/// With a guide table, each symbol costs a division and a short search instead of a full bisection.
+#define DEFN_SDECODE(TOUT,TIN) \
+void sdecode_##TOUT##_##TIN(TOUT **out, size_t *nout, void *in, size_t nin, const ac_static_model_t *m) \
+{ state_t s;                                  \
+  stream_t d={0};                             \
+  u64 ws,v,x;                                 \
+  int isend=0;                                \
+  TRY(m->width==bitsof_##TIN);                \
+  attach(&d,*out,*nout*sizeof(TOUT));         \
+  init_##TIN(&s,in,nin,NULL,0,&ws);           \
+  use_static(&s,m);                           \
+  dprime_##TIN(&s,&v);                        \
+  if(m->guide)                                \
+  { while((x=gselect_##TIN(&s,&v,m->guide))!=m->nsym) \
+      push_##TOUT(&d,x);                      \
+  } else                                      \
+  { x=dstep_##TIN(&s,&v,&isend);              \
+    while(!isend)                             \
+    { push_##TOUT(&d,x);                      \
+      x=dstep_##TIN(&s,&v,&isend);            \
+    }                                         \
+  }                                           \
+  detach(&d,(void**)out,nout);                \
+  *nout /= sizeof(TOUT);                      \
+  return;                                     \
+Error:                                        \
+  abort();                                    \
+}
+#define DEFN_SDECODE_OUTS(TIN) \
+  DEFN_SDECODE(u8,TIN);  \
+  DEFN_SDECODE(u16,TIN); \
+  DEFN_SDECODE(u32,TIN); \
+  DEFN_SDECODE(u64,TIN);
+DEFN_SDECODE_OUTS(u1);
+DEFN_SDECODE_OUTS(u4);
+DEFN_SDECODE_OUTS(u8);
+DEFN_SDECODE_OUTS(u16);
+#ifdef AC_WIDE
+DEFN_SDECODE_OUTS(u32);
+#endif
+
+//
+// Model switching
+//
+
+/// Checks that every model is built for \a width bit digits.
+static int models_fit(const ac_static_model_t *const *models, size_t nmodels, unsigned width)
+{ size_t k;
+  for(k=0;k<nmodels;++k)
+    if(!models[k] || models[k]->width!=width)
+      return 0;
+  return nmodels>0;
+}
+
+/// The model for symbol \a i.  See kencode_*().
+static const ac_static_model_t* pick_model(const ac_static_model_t *const *models, size_t nmodels,
+                                           const uint8_t *which, ac_model_fn next, void *ctx, size_t i, u64 prev)
+{ const size_t k = which?which[i]:next(ctx,i,prev);
+  TRY(k<nmodels);
+  return models[k];
+Error:
+  abort();
+}
+
+#define DEFN_KENCODE(TOUT,TIN) \
+void kencode_##TOUT##_##TIN(void **out, size_t *nout, TIN *in, size_t nin, const ac_static_model_t *const *models, size_t nmodels, const uint8_t *which, ac_model_fn next, void *ctx) \
+{ state_t s;                                  \
+  u64 ws;                                     \
+  size_t i;                                   \
+  TRY(which || next);                         \
+  TRY(models_fit(models,nmodels,bitsof_##TOUT)); \
+  init_##TOUT(&s,*out,*nout,NULL,0,&ws);      \
+  push_varint(&s.d,nin);                      \
+  align_digits(&s.d,bytesof_##TOUT);          \
+  for(i=0;i<nin;++i)                          \
+  { use_static(&s,pick_model(models,nmodels,which,next,ctx,i,i?in[i-1]:0)); \
+    estep_##TOUT(&s,in[i]);                   \
+  }                                           \
+  eselect_##TOUT(&s);                         \
+  pad_bits(&s.d);                             \
+  detach(&s.d,out,nout);                      \
+  return;                                     \
+Error:                                        \
+  abort();                                    \
+}
+#define DEFN_KENCODE_OUTS(TIN) \
+  DEFN_KENCODE(u1,TIN); \
+  DEFN_KENCODE(u4,TIN); \
+  DEFN_KENCODE(u8,TIN); \
+  DEFN_KENCODE(u16,TIN);
+DEFN_KENCODE_OUTS(u8);
+DEFN_KENCODE_OUTS(u16);
+DEFN_KENCODE_OUTS(u32);
+DEFN_KENCODE_OUTS(u64);
+#ifdef AC_WIDE
+DEFN_KENCODE(u32,u8);
+DEFN_KENCODE(u32,u16);
+DEFN_KENCODE(u32,u32);
+DEFN_KENCODE(u32,u64);
+#endif
+
+#define DEFN_KDECODE(TOUT,TIN) \
+void kdecode_##TOUT##_##TIN(TOUT **out, size_t *nout, void *in, size_t nin, const ac_static_model_t *const *models, size_t nmodels, const uint8_t *which, ac_model_fn next, void *ctx) \
+{ state_t s;                                   \
+  u64 ws,v,i,n,x=0;                            \
+  int isend; /* ignored */                     \
+  TRY(which || next);                          \
+  TRY(models_fit(models,nmodels,bitsof_##TIN)); \
+  init_##TIN(&s,in,nin,NULL,0,&ws);            \
+  n = pop_varint(&s.d);                        \
+  s.d.ibyte = (s.d.ibyte+bytesof_##TIN-1)/bytesof_##TIN*bytesof_##TIN; \
+  if(*nout<n)                                  \
+    TRY( *out=realloc(*out,sizeof(TOUT)*n) );  \
+  dprime_##TIN(&s,&v);                         \
+  for(i=0;i<n;++i)                             \
+  { const ac_static_model_t *m=pick_model(models,nmodels,which,next,ctx,i,x); \
+    use_static(&s,m);                          \
+    x = m->guide?gselect_##TIN(&s,&v,m->guide):dstep_##TIN(&s,&v,&isend); \
+    out[0][i]=(TOUT)x;                         \
+  }                                            \
+  *nout = n;                                   \
+  return;                                      \
+Error:                                         \
+  abort();                                     \
+}
+#define DEFN_KDECODE_OUTS(TIN) \
+  DEFN_KDECODE(u8,TIN);  \
+  DEFN_KDECODE(u16,TIN); \
+  DEFN_KDECODE(u32,TIN); \
+  DEFN_KDECODE(u64,TIN);
+DEFN_KDECODE_OUTS(u1);
+DEFN_KDECODE_OUTS(u4);
+DEFN_KDECODE_OUTS(u8);
+DEFN_KDECODE_OUTS(u16);
+#ifdef AC_WIDE
+DEFN_KDECODE_OUTS(u32);
+#endif
+
+//
+// Per-block configuration
+//
+
+/**
+  The candidates ac_block_encode() chooses from.  A block's header holds an
+  index into this table, so entries are only ever appended.
+
+  \c ns and \c ns_bit model the time to encode and then decode one symbol
+  as <tt>ns + ns_bit*(coded bits per symbol)</tt>.  Renormalization follows
+  the output rate, and costs more the narrower the digit.  Measured at -O3
+  on x86-64 with geometric and flat byte sources.  Only the ratios matter.
+
+  u16 digits leave at least 2^16 of the interval after renormalizing, so
+  their models stop at 2^13.
+*/
+typedef struct _block_config_t
+{ unsigned width;   ///< bits per output digit.  0 stores the block as is.
+  unsigned bits;    ///< model precision: frequencies sum to 2^bits
+  double   ns;      ///< ns per symbol...
+  double   ns_bit;  ///< ...plus ns per coded bit
+} block_config_t;
+
+static const block_config_t g_block_configs[] =
+{ { 0, 0, 0.2,0.0},
+  { 1,10,50.0,7.0}, { 1,13,50.0,7.0}, { 1,18,50.0,7.0},
+  { 4,10,37.0,2.0}, { 4,13,37.0,2.0}, { 4,18,37.0,2.0},
+  { 8,10,29.0,1.3}, { 8,13,29.0,1.3}, { 8,18,29.0,1.3},
+  {16,10,27.0,0.8}, {16,13,27.0,0.8},
+#ifdef AC_WIDE
+  {32,10,24.0,0.6}, {32,13,24.0,0.6}, {32,18,24.0,0.6},
+#endif
+};
+#define BLOCK_NCONFIGS (sizeof(g_block_configs)/sizeof(*g_block_configs))
+#define BLOCK_SETUP_NS 2000.0 ///< Per coded block: scaling the model and building the guide.
+
+/// Bytes in the varint for \a v.
+static size_t varint_bytes(u64 v)
+{ size_t n=1;
+  while(v>=0x80)
+    v>>=7,++n;
+  return n;
+}
+
+/// The real CDF the coder is initialized with for frequencies \a f.  Exact: bits<=18.
+static void block_cdf(real *cdf, const u32 *f, size_t nsym, unsigned bits)
+{ u64 acc=0;
+  size_t i;
+  cdf[0]=0.0f;
+  for(i=0;i<nsym;++i)
+  { acc+=f[i];
+    cdf[i+1]=(real)ldexp((double)acc,-(int)bits);
+  }
+}
+
+/// The change in a symbol's frequency, zigzag mapped: 0,-1,1,-2,... -> 0,1,2,3,...
+static u64 block_delta(u32 f, u32 base)
+{ return ZIGZAG(u64,int64_t,(u64)f-base);
+}
+
+/// Undoes block_delta().
+static u32 block_undelta(u32 base, u64 z)
+{ return (u32)(base+UNZIGZAG(u64,z));
+}
+
+/**
+  Estimated bits for coding the model \a f as changes from \a base.  The
+  model is coded as runs of unchanged symbols, each followed by a change
+  (see bencode_*()), and each value costs about its bit length plus two
+  for the length contexts of euint_*().  An unchanged model is one run.
+*/
+static double block_model_bits(const u32 *f, const u32 *base, size_t nsym)
+{ double b=0.0;
+  size_t i=0;
+  while(i<nsym)
+  { size_t r=0;
+    while(i+r<nsym && f[i+r]==base[i+r])
+      ++r;
+    b+=2.0+bitlen(r);
+    i+=r;
+    if(i<nsym)
+      b+=2.0+bitlen(block_delta(f[i],base[i])-1),++i;
+  }
+  return b;
+}
+
+static const u32 g_block_nomodel[256]; ///< The base for a model that isn't a delta.
+
+/**
+  Picks the configuration for a block of \a n symbols with counts \a h over
+  \a nsym symbols.  \returns the index into g_block_configs, and the model in \a f.
+
+  Sizes are estimates in bytes of the whole block, header included: the
+  cross entropy of the counts against each quantized model, the model
+  itself, and the two digits of the flush.  A model with the same precision
+  as the last one, \a prev, is coded as a delta, which favours keeping it.
+*/
+static size_t block_choose(u32 *f, const u64 *h, size_t nsym, size_t n, double budget, const u32 *prev, unsigned prevbits)
+{ double size[BLOCK_NCONFIGS],ns[BLOCK_NCONFIGS],smallest;
+  size_t k,best=0;
+  for(k=0;k<BLOCK_NCONFIGS;++k)
+  { const block_config_t *c=g_block_configs+k;
+    double coded=0.0;
+    size_t i;
+    if(!c->width)
+    { size[k]=1.0+n;
+      ns[k]=c->ns*n;
+      continue;
+    }
+    normalize_counts(f,h,nsym,n,c->bits);
+    for(i=0;i<nsym;++i)
+      if(h[i])
+        coded+=h[i]*(c->bits-log2((double)f[i]));
+    coded+=block_model_bits(f,(c->bits==prevbits)?prev:g_block_nomodel,nsym);
+    size[k]=1.0+varint_bytes(nsym)+ceil((coded+2.0*c->width)/8.0);
+    size[k]+=varint_bytes((u64)size[k]);
+    ns[k]=BLOCK_SETUP_NS+c->ns*n+c->ns_bit*coded;
+  }
+  smallest=size[0];
+  for(k=1;k<BLOCK_NCONFIGS;++k)
+    if(size[k]<smallest)
+      smallest=size[k];
+  for(k=1;k<BLOCK_NCONFIGS;++k)
+    if(size[k]<=smallest*(1.0+budget)
+       && (size[best]>smallest*(1.0+budget) || ns[k]<ns[best]))
+      best=k;
+  if(g_block_configs[best].width)
+    normalize_counts(f,h,nsym,n,g_block_configs[best].bits);
+  return best;
+}
+
+/**
+  Codes a block after its header: the coded size, then the aligned digits.
+  The digits start with the model \a f, as changes from \a base, and go on
+  with the \a n symbols.
+
+  The model alternates the length of a run of symbols whose frequency is
+  unchanged with the next change, zigzagged less one.  Each has its own
+  binarized integer model.
+*/
+#define DEFN_BENCODE(T) \
+static void bencode_##T(stream_t *o, const u8 *in, size_t n, const u32 *f, const u32 *base, size_t nsym, unsigned bits) \
+{ state_t s;                                  \
+  ac_uint_model_t m[2];                       \
+  u64 ws[257];                                \
+  real cdf[257];                              \
+  void *d;                                    \
+  size_t i,nd;                                \
+  ac_uint_model_init(m);                      \
+  ac_uint_model_init(m+1);                    \
+  init_##T(&s,NULL,0,NULL,0,ws);              \
+  for(i=0;i<nsym;)                            \
+  { size_t r=0;                               \
+    while(i+r<nsym && f[i+r]==base[i+r])      \
+      ++r;                                    \
+    euint_##T(&s,m[0].p,r);                   \
+    i+=r;                                     \
+    if(i<nsym)                                \
+      euint_##T(&s,m[1].p,block_delta(f[i],base[i])-1),++i; \
+  }                                           \
+  block_cdf(cdf,f,nsym,bits);                 \
+  rescale_noend(&s,cdf,nsym);                 \
+  for(i=0;i<n;++i)                            \
+    estep_##T(&s,in[i]);                      \
+  eselect_##T(&s);                            \
+  pad_bits(&s.d);                             \
+  detach(&s.d,&d,&nd);                        \
+  push_varint(o,nd);                          \
+  align_digits(o,bytesof_##T);                \
+  push_bytes(o,d,nd);                         \
+  free(d);                                    \
+}
+DEFN_BENCODE(u1);
+DEFN_BENCODE(u4);
+DEFN_BENCODE(u8);
+DEFN_BENCODE(u16);
+#ifdef AC_WIDE
+DEFN_BENCODE(u32);
+#endif
+
+/**
+  Decodes \a n symbols from the \a nin bytes at \a in.  \a f holds the base
+  the model was coded against (256 entries) and is updated to the block's
+  model.  The symbols are looked up through a guide table.
+*/
+#define DEFN_BDECODE(T) \
+static void bdecode_##T(u8 *out, size_t n, const u8 *in, size_t nin, u32 *f, size_t nsym, unsigned bits) \
+{ state_t s;                                  \
+  ac_uint_model_t m[2];                       \
+  u64 ws[257],v,r,sum=0;                      \
+  u32 g[AC_GUIDE_SIZE+1];                     \
+  real cdf[257];                              \
+  size_t i;                                   \
+  ac_uint_model_init(m);                      \
+  ac_uint_model_init(m+1);                    \
+  init_##T(&s,(u8*)in,nin,NULL,0,ws);         \
+  dprime_##T(&s,&v);                          \
+  for(i=0;i<nsym;)                            \
+  { TRY((r=duint_##T(&s,&v,m[0].p))<=nsym-i); \
+    i+=r;                                     \
+    if(i<nsym)                                \
+      f[i]=block_undelta(f[i],duint_##T(&s,&v,m[1].p)+1),++i; \
+  }                                           \
+  for(i=0;i<256;++i)                          \
+    if(i<nsym) sum+=f[i]; else f[i]=0;        \
+  TRY(sum==(1ULL<<bits));                     \
+  block_cdf(cdf,f,nsym,bits);                 \
+  rescale_noend(&s,cdf,nsym);                 \
+  guide_build(g,s.cdf,s.nsym,s.mask);         \
+  for(i=0;i<n;++i)                            \
+    out[i]=(u8)gselect_##T(&s,&v,g);          \
+  return;                                     \
+Error:                                        \
+  abort();                                    \
+}
+DEFN_BDECODE(u1);
+DEFN_BDECODE(u4);
+DEFN_BDECODE(u8);
+DEFN_BDECODE(u16);
+#ifdef AC_WIDE
+DEFN_BDECODE(u32);
+#endif
+
+/**
+  Reads the header of a block of \a n symbols and finds its coded bytes, or
+  its stored bytes.  Leaves \a d past the block.  \returns the
+  configuration's index into g_block_configs.
+*/
+static size_t block_read(stream_t *d, size_t n, size_t *nsym, const u8 **data, size_t *ndata)
+{ const size_t k=pop_u8(d);
+  const block_config_t *c=g_block_configs+k;
+  TRY(k<BLOCK_NCONFIGS);
+  *nsym=0;
+  *ndata=n;
+  if(c->width)
+  { const size_t a=(c->width<8)?1:c->width/8; // digit alignment, see bencode_*()
+    *nsym=pop_varint(d);
+    TRY(*nsym>=1 && *nsym<=256);
+    *ndata=pop_varint(d);
+    d->ibyte=(d->ibyte+a-1)/a*a;
+  }
+  TRY(d->ibyte+*ndata<=d->nbytes);
+  *data=d->d+d->ibyte;
+  d->ibyte+=*ndata;
+  return k;
+Error:
+  abort();
+}
+
+void ac_block_encode(void **out, size_t *nout, const uint8_t *in, size_t nin, size_t block, double budget)
+{ stream_t o={0};
+  u32      prev[256]={0};
+  unsigned prevbits=0;
+  size_t   i,j;
+  if(!block)
+    block=AC_BLOCK_SIZE;
+  attach(&o,*out,*nout);
+  push_varint(&o,nin);
+  push_varint(&o,block);
+  for(i=0;i<nin;i+=block)
+  { const size_t n=(nin-i<block)?(nin-i):block;
+    const u8 *b=in+i;
+    const u32 *base;
+    u64    h[256]={0};
+    u32    f[256]={0};
+    size_t nsym=0,k;
+    unsigned bits;
+    for(j=0;j<n;++j)
+      h[b[j]]++;
+    for(j=0;j<256;++j)
+      if(h[j])
+        nsym=j+1;
+    k=block_choose(f,h,nsym,n,budget,prev,prevbits);
+    push_u8(&o,(u8)k);
+    if(!g_block_configs[k].width)
+    { push_bytes(&o,b,n);
+      continue;
+    }
+    bits=g_block_configs[k].bits;
+    base=(bits==prevbits)?prev:g_block_nomodel;
+    push_varint(&o,nsym);
+    switch(g_block_configs[k].width)
+    { case 1:  bencode_u1 (&o,b,n,f,base,nsym,bits); break;
+      case 4:  bencode_u4 (&o,b,n,f,base,nsym,bits); break;
+      case 8:  bencode_u8 (&o,b,n,f,base,nsym,bits); break;
+      case 16: bencode_u16(&o,b,n,f,base,nsym,bits); break;
+#ifdef AC_WIDE
+      case 32: bencode_u32(&o,b,n,f,base,nsym,bits); break;
+#endif
+    }
+    memcpy(prev,f,sizeof(prev));
+    prevbits=bits;
+  }
+  detach(&o,out,nout);
+}
+
+void ac_block_decode(uint8_t **out, size_t *nout, const void *in, size_t nin)
+{ stream_t d={0};
+  u32      f[256]={0};  // the last block's model
+  unsigned fbits=0;
+  size_t   n,block,i;
+  attach(&d,(void*)in,nin);
+  n=pop_varint(&d);
+  block=pop_varint(&d);
+  TRY(block>0 || n==0);
+  if(*nout<n)
+    TRY( *out=realloc(*out,n?n:1) );
+  for(i=0;i<n;i+=block)
+  { const size_t m=(n-i<block)?(n-i):block;
+    const u8 *data;
+    size_t nsym,ndata,k;
+    unsigned bits;
+    k=block_read(&d,m,&nsym,&data,&ndata);
+    if(!g_block_configs[k].width)
+    { memcpy(*out+i,data,m);
+      continue;
+    }
+    bits=g_block_configs[k].bits;
+    if(bits!=fbits)
+      memset(f,0,sizeof(f));
+    switch(g_block_configs[k].width)
+    { case 1:  bdecode_u1 (*out+i,m,data,ndata,f,nsym,bits); break;
+      case 4:  bdecode_u4 (*out+i,m,data,ndata,f,nsym,bits); break;
+      case 8:  bdecode_u8 (*out+i,m,data,ndata,f,nsym,bits); break;
+      case 16: bdecode_u16(*out+i,m,data,ndata,f,nsym,bits); break;
+#ifdef AC_WIDE
+      case 32: bdecode_u32(*out+i,m,data,ndata,f,nsym,bits); break;
+#endif
+    }
+    fbits=bits;
+  }
+  *nout=n;
+  return;
+Error:
+  abort();
+}
+
+size_t ac_block_configs(const void *in, size_t nin, ac_block_config_t *cfg, size_t ncfg)
+{ stream_t d={0};
+  size_t n,block,i,nblocks=0;
+  attach(&d,(void*)in,nin);
+  n=pop_varint(&d);
+  block=pop_varint(&d);
+  TRY(block>0 || n==0);
+  for(i=0;i<n;i+=block,++nblocks)
+  { const u8 *data;
+    size_t nsym,ndata;
+    const size_t k=block_read(&d,(n-i<block)?(n-i):block,&nsym,&data,&ndata);
+    if(nblocks<ncfg)
+    { cfg[nblocks].width=g_block_configs[k].width;
+      cfg[nblocks].bits =g_block_configs[k].bits;
+    }
+  }
+  return nblocks;
+Error:
+  abort();
+}
+
+//
+// Stepwise
+//
+
+/// Stepwise encoder.  See ac_encoder_open().
+struct _ac_encoder_t
+{ state_t  s;
+  void   (*step)  (state_t*,u64);
+  void   (*bits)  (state_t*,u64,unsigned);
+  void   (*unif)  (state_t*,u64,u64);
+  void   (*select)(state_t*);
+  void   (*uint)  (state_t*,u16*,u64);
+  void   (*param) (state_t*,const ac_param_t*,u64);
+};
+
+/// Stepwise decoder.  See ac_decoder_open().
+struct _ac_decoder_t
+{ state_t  s;
+  u64      v;
+  u64    (*step)(state_t*,u64*,int*);
+  u64    (*bits)(state_t*,u64*,unsigned);
+  u64    (*unif)(state_t*,u64*,u64);
+  u64    (*uint)(state_t*,u64*,u16*);
+  u64    (*param)(state_t*,u64*,const ac_param_t*);
+  void   (*prime)(state_t*,u64*);
+  unsigned nbits;   ///< bits per input digit
+};
+
+#define CASE_ENCODER(T) \
+  case AC_##T: init_##T(&e->s,NULL,0,cdf,nsym,NULL); \
+    e->step=estep_##T; e->bits=ebits_##T; e->unif=eunif_##T; e->select=eselect_##T; \
+    e->uint=euint_##T; e->param=eparam_##T; break
+#define CASE_DECODER(T) \
+  case AC_##T: init_##T(&d->s,(u8*)in,nin,cdf,nsym,NULL); \
+    d->step=dstep_##T; d->bits=dbits_##T; d->unif=dunif_##T; d->uint=duint_##T; d->param=dparam_##T; \
+    d->prime=dprime_##T; d->nbits=bitsof_##T; dprime_##T(&d->s,&d->v); break
+
+ac_encoder_t* ac_encoder_open(ac_width_t width, real *cdf, size_t nsym)
+{ ac_encoder_t *e=NULL;
+  TRY(e=malloc(sizeof(*e)));
+  switch(width)
+  { CASE_ENCODER(u1);
+    CASE_ENCODER(u4);
+    CASE_ENCODER(u8);
+    CASE_ENCODER(u16);
+#ifdef AC_WIDE
+    CASE_ENCODER(u32);
+#endif
+    default: TRY(0);
+  }
+  rescale_noend(&e->s,cdf,nsym);
+  return e;
+Error:
+  abort();
+}
+
+void ac_encode_symbol(ac_encoder_t *e, uint64_t s)
+{ e->step(&e->s,s);
+}
+
+void ac_encode_bits(ac_encoder_t *e, uint64_t v, unsigned n)
+{ e->bits(&e->s,v,n);
+}
+
+void ac_encode_uniform(ac_encoder_t *e, uint64_t s, uint64_t m)
+{ TRY(s<m && m && m<(1u<<16));
+  e->unif(&e->s,s,m);
+  return;
+Error:
+  abort();
+}
+
+void ac_encode_uint(ac_encoder_t *e, ac_uint_model_t *m, uint64_t v)
+{ e->uint(&e->s,m->p,v);
+}
+
+void ac_encode_param(ac_encoder_t *e, const ac_param_t *m, uint64_t s)
+{ TRY(param_fits(&e->s,m) && s<m->nsym);
+  e->param(&e->s,m,s);
+  return;
+Error:
+  abort();
+}
+
+/**
+  Sync point.  eselect_*() leaves a value that decodes correctly whatever
+  digits follow it, and a fresh interval can't carry into digits before
+  it, so the bytes up to here are final.
+*/
+void ac_encoder_flush(ac_encoder_t *e, const void **out, size_t *nout)
+{ e->select(&e->s);
+  pad_bits(&e->s.d);
+  restart(&e->s);
+  if(out)  *out  = e->s.d.d;
+  if(nout) *nout = e->s.d.ibyte;
+}
+
+void ac_encoder_close(ac_encoder_t *e, void **out, size_t *nout)
+{ e->select(&e->s);
+  pad_bits(&e->s.d);
+  detach(&e->s.d,out,nout);
+  free_internal(&e->s);
+  free(e);
+}
+
+ac_decoder_t* ac_decoder_open(ac_width_t width, real *cdf, size_t nsym, void *in, size_t nin)
+{ ac_decoder_t *d=NULL;
+  TRY(in);
+  TRY(d=malloc(sizeof(*d)));
+  switch(width)
+  { CASE_DECODER(u1);
+    CASE_DECODER(u4);
+    CASE_DECODER(u8);
+    CASE_DECODER(u16);
+#ifdef AC_WIDE
+    CASE_DECODER(u32);
+#endif
+    default: TRY(0);
+  }
+  rescale_noend(&d->s,cdf,nsym);
+  return d;
+Error:
+  abort();
+}
+
+uint64_t ac_decode_symbol(ac_decoder_t *d)
+{ int isend; // no END in stepwise streams
+  return d->step(&d->s,&d->v,&isend);
+}
+
+uint64_t ac_decode_bits(ac_decoder_t *d, unsigned n)
+{ return d->bits(&d->s,&d->v,n);
+}
+
+uint64_t ac_decode_uniform(ac_decoder_t *d, uint64_t m)
+{ TRY(m && m<(1u<<16));
+  return d->unif(&d->s,&d->v,m);
+Error:
+  abort();
+}
+
+uint64_t ac_decode_uint(ac_decoder_t *d, ac_uint_model_t *m)
+{ return d->uint(&d->s,&d->v,m->p);
+}
+
+uint64_t ac_decode_param(ac_decoder_t *d, const ac_param_t *m)
+{ TRY(param_fits(&d->s,m));
+  return d->param(&d->s,&d->v,m);
+Error:
+  abort();
+}
+
+/**
+  Mirrors ac_encoder_flush().  Encoder and decoder renormalize in lock
+  step, but the decoder reads a full window (SHIFT bits) ahead.  So the
+  encoder's segment ended two digits past the start of that window, then
+  was padded to a byte.
+*/
+size_t ac_decoder_sync(ac_decoder_t *d, void *in, size_t nin)
+{ stream_t *s=&d->s.d;
+  const size_t end=(8*s->ibyte+s->ibit+2*d->nbits-d->s.shift+7)/8;
+  if(in)
+    rewind_input(&d->s,(u8*)in,nin);
+  s->ibyte = end;
+  s->ibit  = 0;
+  restart(&d->s);
+  d->prime(&d->s,&d->v);
+  return end;
+}
+
+void ac_decoder_close(ac_decoder_t *d)
+{ free_internal(&d->s);
+  free(d);
+}
+
+//
+// Workspace (no heap)
+//
+
+/// \returns the number of bytes of workspace needed by the *_ws functions for an alphabet of \a nsym symbols.
+size_t ac_workspace_size(size_t nsym)
+{ return (nsym+1)*sizeof(u64); // scaled cdf, including END
+}
+
+/// Picks the caller's workspace, or the stack buffer \a stk for small alphabets.
+static u64* workspace(void *ws, u64 *stk, size_t nsym)
+{ if(ws)
+    return (u64*)ws;
+  return (nsym<=AC_WS_STACK_NSYM)?stk:NULL;
+}
+
+#define DEFN_ENCODE_WS(TOUT,TIN) \
+int encode_##TOUT##_##TIN##_ws(void *out, size_t *nout, TIN *in, size_t nin, real *cdf, size_t nsym, void *ws) \
+{ u64 stk[AC_WS_STACK_NSYM+1],*c;      \
+  size_t i,cap;                         \
+  state_t s;                            \
+  TRY(out && in);                       \
+  TRY(c=workspace(ws,stk,nsym));        \
+  cap = *nout&~(size_t)(bytesof_##TOUT-1); \
+  init_##TOUT(&s,(u8*)out,cap,cdf,nsym,c); /* attach() won't allocate */ \
+  attach_fixed(&s.d,out,cap);           \
+  for(i=0;i<nin;++i)                    \
+    estep_##TOUT(&s,in[i]);             \
+  estep_##TOUT(&s,s.nsym-1);            \
+  eselect_##TOUT(&s);                   \
+  pad_bits(&s.d);                       \
+  *nout = s.d.overflow?cap:s.d.ibyte;   \
+  return overflowed(&s.d)?-1:0;         \
+Error:                                  \
+  abort();                              \
+}
+#define DEFN_ENCODE_WS_OUTS(TIN) \
+  DEFN_ENCODE_WS(u1,TIN); \
+  DEFN_ENCODE_WS(u4,TIN); \
+  DEFN_ENCODE_WS(u8,TIN); \
+  DEFN_ENCODE_WS(u16,TIN);
+DEFN_ENCODE_WS_OUTS(u8);
+DEFN_ENCODE_WS_OUTS(u16);
+DEFN_ENCODE_WS_OUTS(u32);
+DEFN_ENCODE_WS_OUTS(u64);
+#ifdef AC_WIDE
+DEFN_ENCODE_WS(u32,u8);
+DEFN_ENCODE_WS(u32,u16);
+DEFN_ENCODE_WS(u32,u32);
+DEFN_ENCODE_WS(u32,u64);
+#endif
+
+#define DEFN_DECODE_WS(TOUT,TIN) \
+int decode_##TOUT##_##TIN##_ws(TOUT *out, size_t *nout, void *in, size_t nin, real *cdf, size_t nsym, void *ws) \
+{ u64 stk[AC_WS_STACK_NSYM+1],*c;             \
+  state_t s;                                   \
+  stream_t d={0};                              \
+  u64 v,x;                                     \
+  size_t cap;                                  \
+  int isend=0;                                 \
+  TRY(out && in);                              \
+  TRY(c=workspace(ws,stk,nsym));               \
+  cap = *nout*sizeof(TOUT);                    \
+  attach_fixed(&d,out,cap);                    \
+  init_##TIN(&s,in,nin,cdf,nsym,c);            \
+  dprime_##TIN(&s,&v);                         \
+  x=dstep_##TIN(&s,&v,&isend);                 \
+  while(!isend)                                \
+  { push_##TOUT(&d,x);                         \
+    x=dstep_##TIN(&s,&v,&isend);               \
+  }                                            \
+  *nout = (d.overflow?cap:d.ibyte)/sizeof(TOUT); \
+  return overflowed(&d)?-1:0;                  \
+Error:                                         \
+  abort();                                     \
+}
+#define DEFN_DECODE_WS_OUTS(TIN) \
+  DEFN_DECODE_WS(u8,TIN);  \
+  DEFN_DECODE_WS(u16,TIN); \
+  DEFN_DECODE_WS(u32,TIN); \
+  DEFN_DECODE_WS(u64,TIN);
+DEFN_DECODE_WS_OUTS(u1);
+DEFN_DECODE_WS_OUTS(u4);
+DEFN_DECODE_WS_OUTS(u8);
+DEFN_DECODE_WS_OUTS(u16);
+#ifdef AC_WIDE
+DEFN_DECODE_WS_OUTS(u32);
+#endif
+
+//
+// Scan
+//
+
+#define DEFN_DECODE_SCAN(TIN) \
+size_t decode_scan_##TIN(void *in, size_t nin, real *cdf, size_t nsym, ac_symbol_fn fn, void *ctx, void *ws) \
+{ u64 stk[AC_WS_STACK_NSYM+1],*c;              \
+  state_t s;                                   \
+  u64 v,x;                                     \
+  size_t n=0;                                  \
+  int isend=0;                                 \
+  TRY(in && fn);                               \
+  c = workspace(ws,stk,nsym);  /* NULL: heap */ \
+  init_##TIN(&s,in,nin,cdf,nsym,c);            \
+  dprime_##TIN(&s,&v);                         \
+  x=dstep_##TIN(&s,&v,&isend);                 \
+  while(!isend)                                \
+  { ++n;                                       \
+    if(fn(ctx,x))                              \
+      break;                                   \
+    x=dstep_##TIN(&s,&v,&isend);               \
+  }                                            \
+  if(!c)                                       \
+    free_internal(&s);                         \
+  return n;                                    \
+Error:                                         \
+  abort();                                     \
+}
+DEFN_DECODE_SCAN(u1);
+DEFN_DECODE_SCAN(u4);
+DEFN_DECODE_SCAN(u8);
+DEFN_DECODE_SCAN(u16);
+#ifdef AC_WIDE
+DEFN_DECODE_SCAN(u32);
+#endif
+
+//
+// Variable output alphabet encoding
+//
+
+void sync(stream_t *dest, stream_t *src)
+{ dest->d      = src->d;
+  dest->nbytes = src->nbytes;
+}
+/// Decodes \a in as a sequence of uniform symbols over \a tsym, as many as it takes to re-encode \a in.
+void vdecode1(u8 **out, size_t *nout, u8 *in, size_t nin, size_t tsym)
+{ state_t d0,e1;                                   
+  stream_t d={0};                              
+  u64 v0;
+  attach(&d,*out,*nout);          
+  init_u8(&d0,in,nin,NULL,0,NULL);          // the uniform decode
+  init_u8(&e1, 0,  0,NULL,0,NULL);          // the uniform encode - used to check for end symbol
+
+  dprime_u8(&d0,&v0);
+  while(e1.d.ibyte<nin)                     // stop decoding when reencoding reproduces the input string
+  { u8 s = dunif_u8(&d0,&v0,tsym);
+    push_u8(&d,s);
+    eunif_null(&e1,s,tsym);
+  }
+
+  detach(&d,(void**)out,nout);
+  { void *b;
+    detach(&e1.d,&b,NULL);
+    if(b) free(b);
+  }
+  free_internal(&d0);
+  free_internal(&e1);
+}
+
+/// Encodes \a in as uniform symbols over \a tsym followed by END.
+static void uencode_u8(void **out, size_t *nout, u8 *in, size_t nin, size_t tsym)
+{ state_t s;
+  size_t i;
+  init_u8(&s,*out,*nout,NULL,0,NULL);
+  for(i=0;i<nin;++i)
+    eunif_u8(&s,in[i],tsym);
+  eunif_u8(&s,tsym,tsym);                   // END
+  eselect_u8(&s);
+  detach(&s.d,out,nout);
+  free_internal(&s);
 }
 
 #define DEFN_VENCODE(T) \
 void vencode_##T(u8 **out, size_t *nout, size_t noutsym, T *in, size_t nin, size_t ninsym, real *cdf) \
-{ u8 *t=NULL;                                          \
-  size_t i,n=0;                                        \
-  real *tcdf;                                          \
-  TRY( tcdf=malloc(sizeof(*tcdf)*(noutsym+1)) );       \
-  { size_t i;                                          \
-    real v = 1.0/(real)noutsym;                        \
-    for(i=0;i<=noutsym;++i)                            \
-      tcdf[i] = i*v;                                   \
-  }                                                    \
-  { void *buf=0;                                       \
-    n = 0;                                             \
-    encode_u8_##T(&buf,&n,in,nin,cdf,ninsym);          \
-    vdecode1(out,nout,buf,n,cdf,ninsym,tcdf,noutsym);  \
-    free(buf);                                         \
-  }                                                    \
-  free(tcdf);                                          \
-  return;                                              \
-Error:                                                 \
-  abort();                                             \
+{ void *buf=0;                                         \
+  size_t n=0;                                          \
+  encode_u8_##T(&buf,&n,in,nin,cdf,ninsym);            \
+  vdecode1(out,nout,buf,n,noutsym);                    \
+  free(buf);                                           \
 }
 DEFN_VENCODE(u8);
 DEFN_VENCODE(u16);
@@ -653,25 +3493,11 @@ DEFN_VENCODE(u64);
 
 #define DEFN_VDECODE(T) \
 void vdecode_##T(T **out, size_t *nout, size_t noutsym, u8 *in, size_t nin, size_t ninsym, real *cdf) \
-{ u8 *t=NULL;                                          \
-  size_t i,n=0;                                        \
-  real *tcdf;                                          \
-  TRY( tcdf=malloc(sizeof(*tcdf)*(ninsym+1)) );        \
-  { size_t i;                                          \
-    real v = 1.0/(real)ninsym;                         \
-    for(i=0;i<=ninsym;++i)                             \
-      tcdf[i] = i*v;                                   \
-  }                                                    \
-  { void *buf=0;                                       \
-    n = 0;                                             \
-    encode_u8_u8(&buf,&n,in,nin,tcdf,ninsym);          \
-    decode_##T##_u8(out,nout,buf,n,cdf,noutsym);       \
-    free(buf);                                         \
-  }                                                    \
-  free(tcdf);                                          \
-  return;                                              \
-Error:                                                 \
-  abort();                                             \
+{ void *buf=0;                                         \
+  size_t n=0;                                          \
+  uencode_u8(&buf,&n,in,nin,ninsym);                   \
+  decode_##T##_u8(out,nout,buf,n,cdf,noutsym);         \
+  free(buf);                                           \
 }
 DEFN_VDECODE(u8);
 DEFN_VDECODE(u16);
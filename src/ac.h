@@ -5,6 +5,9 @@ extern "C" {
 
 #include <stdint.h>
 #include <stdlib.h>
+#include "stats.h"
+#include "predict.h" // for ac_pred_t
+#include "param.h"   // for ac_param_t
 
 typedef uint8_t   u8;
 typedef uint32_t  u32;
@@ -68,6 +71,17 @@ void encode_u16_u8 (void **out, size_t *nout, uint8_t *in, size_t nin, real *cdf
 void encode_u16_u16 (void **out, size_t *nout, uint16_t  *in, size_t nin, real *cdf, size_t nsym);
 void encode_u16_u32 (void **out, size_t *nout, uint32_t *in, size_t nin, real *cdf, size_t nsym);
 void encode_u16_u64 (void **out, size_t *nout, uint64_t *in, size_t nin, real *cdf, size_t nsym);
+
+// u32 outputs use a 64-bit interval with 128-bit intermediate products.
+// Smallest codable probability is 2^-32.  Only if the compiler has
+// unsigned __int128.
+#if defined(__SIZEOF_INT128__)
+#define AC_HAVE_U32_OUTPUT
+void encode_u32_u8 (void **out, size_t *nout, uint8_t *in, size_t nin, real *cdf, size_t nsym);
+void encode_u32_u16 (void **out, size_t *nout, uint16_t  *in, size_t nin, real *cdf, size_t nsym);
+void encode_u32_u32 (void **out, size_t *nout, uint32_t *in, size_t nin, real *cdf, size_t nsym);
+void encode_u32_u64 (void **out, size_t *nout, uint64_t *in, size_t nin, real *cdf, size_t nsym);
+#endif
 /// @}
 
 /// \defgroup Decoding Decoding functions
@@ -96,13 +110,877 @@ void decode_u8_u16(uint8_t **out, size_t *nout, void *in, size_t nin, real *cdf,
 void decode_u16_u16(uint16_t **out, size_t *nout, void *in, size_t nin, real *cdf, size_t nsym);
 void decode_u32_u16(uint32_t **out, size_t *nout, void *in, size_t nin, real *cdf, size_t nsym);
 void decode_u64_u16(uint64_t **out, size_t *nout, void *in, size_t nin, real *cdf, size_t nsym);
+
+#ifdef AC_HAVE_U32_OUTPUT
+void decode_u8_u32 (uint8_t **out, size_t *nout, void *in, size_t nin, real *cdf, size_t nsym);
+void decode_u16_u32(uint16_t **out, size_t *nout, void *in, size_t nin, real *cdf, size_t nsym);
+void decode_u32_u32(uint32_t **out, size_t *nout, void *in, size_t nin, real *cdf, size_t nsym);
+void decode_u64_u32(uint64_t **out, size_t *nout, void *in, size_t nin, real *cdf, size_t nsym);
+#endif
+/// @}
+
+/// \defgroup Statistics Encoding/decoding with statistics
+/// @{
+// Same as encode_<Tout>_<Tin> and decode_<Tout>_<Tin> but fill in <stats>.
+// - <stats> may be NULL.
+// - Counters are only collected when compiled with AC_STATS.  See stats.h.
+void encode_u1_u8_stats  (void **out, size_t *nout, uint8_t  *in, size_t nin, real *cdf, size_t nsym, ac_stats_t *stats);
+void encode_u4_u8_stats  (void **out, size_t *nout, uint8_t  *in, size_t nin, real *cdf, size_t nsym, ac_stats_t *stats);
+void encode_u8_u8_stats  (void **out, size_t *nout, uint8_t  *in, size_t nin, real *cdf, size_t nsym, ac_stats_t *stats);
+void encode_u16_u8_stats (void **out, size_t *nout, uint8_t  *in, size_t nin, real *cdf, size_t nsym, ac_stats_t *stats);
+void encode_u1_u16_stats (void **out, size_t *nout, uint16_t *in, size_t nin, real *cdf, size_t nsym, ac_stats_t *stats);
+void encode_u4_u16_stats (void **out, size_t *nout, uint16_t *in, size_t nin, real *cdf, size_t nsym, ac_stats_t *stats);
+void encode_u8_u16_stats (void **out, size_t *nout, uint16_t *in, size_t nin, real *cdf, size_t nsym, ac_stats_t *stats);
+void encode_u16_u16_stats(void **out, size_t *nout, uint16_t *in, size_t nin, real *cdf, size_t nsym, ac_stats_t *stats);
+void encode_u1_u32_stats (void **out, size_t *nout, uint32_t *in, size_t nin, real *cdf, size_t nsym, ac_stats_t *stats);
+void encode_u4_u32_stats (void **out, size_t *nout, uint32_t *in, size_t nin, real *cdf, size_t nsym, ac_stats_t *stats);
+void encode_u8_u32_stats (void **out, size_t *nout, uint32_t *in, size_t nin, real *cdf, size_t nsym, ac_stats_t *stats);
+void encode_u16_u32_stats(void **out, size_t *nout, uint32_t *in, size_t nin, real *cdf, size_t nsym, ac_stats_t *stats);
+void encode_u1_u64_stats (void **out, size_t *nout, uint64_t *in, size_t nin, real *cdf, size_t nsym, ac_stats_t *stats);
+void encode_u4_u64_stats (void **out, size_t *nout, uint64_t *in, size_t nin, real *cdf, size_t nsym, ac_stats_t *stats);
+void encode_u8_u64_stats (void **out, size_t *nout, uint64_t *in, size_t nin, real *cdf, size_t nsym, ac_stats_t *stats);
+void encode_u16_u64_stats(void **out, size_t *nout, uint64_t *in, size_t nin, real *cdf, size_t nsym, ac_stats_t *stats);
+
+void decode_u8_u1_stats  (uint8_t  **out, size_t *nout, void *in, size_t nin, real *cdf, size_t nsym, ac_stats_t *stats);
+void decode_u8_u4_stats  (uint8_t  **out, size_t *nout, void *in, size_t nin, real *cdf, size_t nsym, ac_stats_t *stats);
+void decode_u8_u8_stats  (uint8_t  **out, size_t *nout, void *in, size_t nin, real *cdf, size_t nsym, ac_stats_t *stats);
+void decode_u8_u16_stats (uint8_t  **out, size_t *nout, void *in, size_t nin, real *cdf, size_t nsym, ac_stats_t *stats);
+void decode_u16_u1_stats (uint16_t **out, size_t *nout, void *in, size_t nin, real *cdf, size_t nsym, ac_stats_t *stats);
+void decode_u16_u4_stats (uint16_t **out, size_t *nout, void *in, size_t nin, real *cdf, size_t nsym, ac_stats_t *stats);
+void decode_u16_u8_stats (uint16_t **out, size_t *nout, void *in, size_t nin, real *cdf, size_t nsym, ac_stats_t *stats);
+void decode_u16_u16_stats(uint16_t **out, size_t *nout, void *in, size_t nin, real *cdf, size_t nsym, ac_stats_t *stats);
+void decode_u32_u1_stats (uint32_t **out, size_t *nout, void *in, size_t nin, real *cdf, size_t nsym, ac_stats_t *stats);
+void decode_u32_u4_stats (uint32_t **out, size_t *nout, void *in, size_t nin, real *cdf, size_t nsym, ac_stats_t *stats);
+void decode_u32_u8_stats (uint32_t **out, size_t *nout, void *in, size_t nin, real *cdf, size_t nsym, ac_stats_t *stats);
+void decode_u32_u16_stats(uint32_t **out, size_t *nout, void *in, size_t nin, real *cdf, size_t nsym, ac_stats_t *stats);
+void decode_u64_u1_stats (uint64_t **out, size_t *nout, void *in, size_t nin, real *cdf, size_t nsym, ac_stats_t *stats);
+void decode_u64_u4_stats (uint64_t **out, size_t *nout, void *in, size_t nin, real *cdf, size_t nsym, ac_stats_t *stats);
+void decode_u64_u8_stats (uint64_t **out, size_t *nout, void *in, size_t nin, real *cdf, size_t nsym, ac_stats_t *stats);
+void decode_u64_u16_stats(uint64_t **out, size_t *nout, void *in, size_t nin, real *cdf, size_t nsym, ac_stats_t *stats);
+#ifdef AC_HAVE_U32_OUTPUT
+void encode_u32_u8_stats (void **out, size_t *nout, uint8_t  *in, size_t nin, real *cdf, size_t nsym, ac_stats_t *stats);
+void encode_u32_u16_stats(void **out, size_t *nout, uint16_t *in, size_t nin, real *cdf, size_t nsym, ac_stats_t *stats);
+void encode_u32_u32_stats(void **out, size_t *nout, uint32_t *in, size_t nin, real *cdf, size_t nsym, ac_stats_t *stats);
+void encode_u32_u64_stats(void **out, size_t *nout, uint64_t *in, size_t nin, real *cdf, size_t nsym, ac_stats_t *stats);
+void decode_u8_u32_stats (uint8_t  **out, size_t *nout, void *in, size_t nin, real *cdf, size_t nsym, ac_stats_t *stats);
+void decode_u16_u32_stats(uint16_t **out, size_t *nout, void *in, size_t nin, real *cdf, size_t nsym, ac_stats_t *stats);
+void decode_u32_u32_stats(uint32_t **out, size_t *nout, void *in, size_t nin, real *cdf, size_t nsym, ac_stats_t *stats);
+void decode_u64_u32_stats(uint64_t **out, size_t *nout, void *in, size_t nin, real *cdf, size_t nsym, ac_stats_t *stats);
+#endif
+/// @}
+
+/// \defgroup Batch Batch encoding/decoding
+/// @{
+// encode_batch_<Tout>_<Tin>
+// - codes <nmsg> messages, in[i] with nin[i] symbols, against one CDF.
+// - the coded messages are written back to back to <*out>.  Message i is
+//   bytes offsets[i]..offsets[i+1]-1.  <offsets> has nmsg+1 elements.
+// - each coded message is identical to encode_<Tout>_<Tin>'s output.
+//
+// decode_batch_<Tout>_<Tin>
+// - <in>,<inoffsets>: the encoder's output and offsets.
+// - the decoded messages are written back to back to <*out>.  Message i is
+//   symbols offsets[i]..offsets[i+1]-1.  <offsets> has nmsg+1 elements.
+void encode_batch_u1_u8  (void **out, size_t *nout, size_t *offsets, uint8_t  **in, size_t *nin, size_t nmsg, real *cdf, size_t nsym);
+void encode_batch_u1_u16 (void **out, size_t *nout, size_t *offsets, uint16_t **in, size_t *nin, size_t nmsg, real *cdf, size_t nsym);
+void encode_batch_u1_u32 (void **out, size_t *nout, size_t *offsets, uint32_t **in, size_t *nin, size_t nmsg, real *cdf, size_t nsym);
+void encode_batch_u1_u64 (void **out, size_t *nout, size_t *offsets, uint64_t **in, size_t *nin, size_t nmsg, real *cdf, size_t nsym);
+void encode_batch_u4_u8  (void **out, size_t *nout, size_t *offsets, uint8_t  **in, size_t *nin, size_t nmsg, real *cdf, size_t nsym);
+void encode_batch_u4_u16 (void **out, size_t *nout, size_t *offsets, uint16_t **in, size_t *nin, size_t nmsg, real *cdf, size_t nsym);
+void encode_batch_u4_u32 (void **out, size_t *nout, size_t *offsets, uint32_t **in, size_t *nin, size_t nmsg, real *cdf, size_t nsym);
+void encode_batch_u4_u64 (void **out, size_t *nout, size_t *offsets, uint64_t **in, size_t *nin, size_t nmsg, real *cdf, size_t nsym);
+void encode_batch_u8_u8  (void **out, size_t *nout, size_t *offsets, uint8_t  **in, size_t *nin, size_t nmsg, real *cdf, size_t nsym);
+void encode_batch_u8_u16 (void **out, size_t *nout, size_t *offsets, uint16_t **in, size_t *nin, size_t nmsg, real *cdf, size_t nsym);
+void encode_batch_u8_u32 (void **out, size_t *nout, size_t *offsets, uint32_t **in, size_t *nin, size_t nmsg, real *cdf, size_t nsym);
+void encode_batch_u8_u64 (void **out, size_t *nout, size_t *offsets, uint64_t **in, size_t *nin, size_t nmsg, real *cdf, size_t nsym);
+void encode_batch_u16_u8 (void **out, size_t *nout, size_t *offsets, uint8_t  **in, size_t *nin, size_t nmsg, real *cdf, size_t nsym);
+void encode_batch_u16_u16(void **out, size_t *nout, size_t *offsets, uint16_t **in, size_t *nin, size_t nmsg, real *cdf, size_t nsym);
+void encode_batch_u16_u32(void **out, size_t *nout, size_t *offsets, uint32_t **in, size_t *nin, size_t nmsg, real *cdf, size_t nsym);
+void encode_batch_u16_u64(void **out, size_t *nout, size_t *offsets, uint64_t **in, size_t *nin, size_t nmsg, real *cdf, size_t nsym);
+
+void decode_batch_u8_u1  (uint8_t  **out, size_t *nout, size_t *offsets, void *in, size_t *inoffsets, size_t nmsg, real *cdf, size_t nsym);
+void decode_batch_u16_u1 (uint16_t **out, size_t *nout, size_t *offsets, void *in, size_t *inoffsets, size_t nmsg, real *cdf, size_t nsym);
+void decode_batch_u32_u1 (uint32_t **out, size_t *nout, size_t *offsets, void *in, size_t *inoffsets, size_t nmsg, real *cdf, size_t nsym);
+void decode_batch_u64_u1 (uint64_t **out, size_t *nout, size_t *offsets, void *in, size_t *inoffsets, size_t nmsg, real *cdf, size_t nsym);
+void decode_batch_u8_u4  (uint8_t  **out, size_t *nout, size_t *offsets, void *in, size_t *inoffsets, size_t nmsg, real *cdf, size_t nsym);
+void decode_batch_u16_u4 (uint16_t **out, size_t *nout, size_t *offsets, void *in, size_t *inoffsets, size_t nmsg, real *cdf, size_t nsym);
+void decode_batch_u32_u4 (uint32_t **out, size_t *nout, size_t *offsets, void *in, size_t *inoffsets, size_t nmsg, real *cdf, size_t nsym);
+void decode_batch_u64_u4 (uint64_t **out, size_t *nout, size_t *offsets, void *in, size_t *inoffsets, size_t nmsg, real *cdf, size_t nsym);
+void decode_batch_u8_u8  (uint8_t  **out, size_t *nout, size_t *offsets, void *in, size_t *inoffsets, size_t nmsg, real *cdf, size_t nsym);
+void decode_batch_u16_u8 (uint16_t **out, size_t *nout, size_t *offsets, void *in, size_t *inoffsets, size_t nmsg, real *cdf, size_t nsym);
+void decode_batch_u32_u8 (uint32_t **out, size_t *nout, size_t *offsets, void *in, size_t *inoffsets, size_t nmsg, real *cdf, size_t nsym);
+void decode_batch_u64_u8 (uint64_t **out, size_t *nout, size_t *offsets, void *in, size_t *inoffsets, size_t nmsg, real *cdf, size_t nsym);
+void decode_batch_u8_u16 (uint8_t  **out, size_t *nout, size_t *offsets, void *in, size_t *inoffsets, size_t nmsg, real *cdf, size_t nsym);
+void decode_batch_u16_u16(uint16_t **out, size_t *nout, size_t *offsets, void *in, size_t *inoffsets, size_t nmsg, real *cdf, size_t nsym);
+void decode_batch_u32_u16(uint32_t **out, size_t *nout, size_t *offsets, void *in, size_t *inoffsets, size_t nmsg, real *cdf, size_t nsym);
+void decode_batch_u64_u16(uint64_t **out, size_t *nout, size_t *offsets, void *in, size_t *inoffsets, size_t nmsg, real *cdf, size_t nsym);
+#ifdef AC_HAVE_U32_OUTPUT
+void encode_batch_u32_u8 (void **out, size_t *nout, size_t *offsets, uint8_t  **in, size_t *nin, size_t nmsg, real *cdf, size_t nsym);
+void encode_batch_u32_u16(void **out, size_t *nout, size_t *offsets, uint16_t **in, size_t *nin, size_t nmsg, real *cdf, size_t nsym);
+void encode_batch_u32_u32(void **out, size_t *nout, size_t *offsets, uint32_t **in, size_t *nin, size_t nmsg, real *cdf, size_t nsym);
+void encode_batch_u32_u64(void **out, size_t *nout, size_t *offsets, uint64_t **in, size_t *nin, size_t nmsg, real *cdf, size_t nsym);
+
+void decode_batch_u8_u32 (uint8_t  **out, size_t *nout, size_t *offsets, void *in, size_t *inoffsets, size_t nmsg, real *cdf, size_t nsym);
+void decode_batch_u16_u32(uint16_t **out, size_t *nout, size_t *offsets, void *in, size_t *inoffsets, size_t nmsg, real *cdf, size_t nsym);
+void decode_batch_u32_u32(uint32_t **out, size_t *nout, size_t *offsets, void *in, size_t *inoffsets, size_t nmsg, real *cdf, size_t nsym);
+void decode_batch_u64_u32(uint64_t **out, size_t *nout, size_t *offsets, void *in, size_t *inoffsets, size_t nmsg, real *cdf, size_t nsym);
+#endif
+/// @}
+
+/// \defgroup Length Length-prefixed encoding/decoding
+/// @{
+// lencode_<Tout>_<Tin>, ldecode_<Tout>_<Tin>
+// - no END symbol.  The symbol count is stored as a varint at the front of
+//   the stream (zero padded to a whole output digit) and the input alphabet
+//   gets the whole interval.
+// - the decoder sizes <*out> once from the stored count.
+// - not compatible with the encode_/decode_ streams.
+void lencode_u1_u8  (void **out, size_t *nout, uint8_t  *in, size_t nin, real *cdf, size_t nsym);
+void lencode_u1_u16 (void **out, size_t *nout, uint16_t *in, size_t nin, real *cdf, size_t nsym);
+void lencode_u1_u32 (void **out, size_t *nout, uint32_t *in, size_t nin, real *cdf, size_t nsym);
+void lencode_u1_u64 (void **out, size_t *nout, uint64_t *in, size_t nin, real *cdf, size_t nsym);
+void lencode_u4_u8  (void **out, size_t *nout, uint8_t  *in, size_t nin, real *cdf, size_t nsym);
+void lencode_u4_u16 (void **out, size_t *nout, uint16_t *in, size_t nin, real *cdf, size_t nsym);
+void lencode_u4_u32 (void **out, size_t *nout, uint32_t *in, size_t nin, real *cdf, size_t nsym);
+void lencode_u4_u64 (void **out, size_t *nout, uint64_t *in, size_t nin, real *cdf, size_t nsym);
+void lencode_u8_u8  (void **out, size_t *nout, uint8_t  *in, size_t nin, real *cdf, size_t nsym);
+void lencode_u8_u16 (void **out, size_t *nout, uint16_t *in, size_t nin, real *cdf, size_t nsym);
+void lencode_u8_u32 (void **out, size_t *nout, uint32_t *in, size_t nin, real *cdf, size_t nsym);
+void lencode_u8_u64 (void **out, size_t *nout, uint64_t *in, size_t nin, real *cdf, size_t nsym);
+void lencode_u16_u8 (void **out, size_t *nout, uint8_t  *in, size_t nin, real *cdf, size_t nsym);
+void lencode_u16_u16(void **out, size_t *nout, uint16_t *in, size_t nin, real *cdf, size_t nsym);
+void lencode_u16_u32(void **out, size_t *nout, uint32_t *in, size_t nin, real *cdf, size_t nsym);
+void lencode_u16_u64(void **out, size_t *nout, uint64_t *in, size_t nin, real *cdf, size_t nsym);
+
+void ldecode_u8_u1  (uint8_t  **out, size_t *nout, void *in, size_t nin, real *cdf, size_t nsym);
+void ldecode_u16_u1 (uint16_t **out, size_t *nout, void *in, size_t nin, real *cdf, size_t nsym);
+void ldecode_u32_u1 (uint32_t **out, size_t *nout, void *in, size_t nin, real *cdf, size_t nsym);
+void ldecode_u64_u1 (uint64_t **out, size_t *nout, void *in, size_t nin, real *cdf, size_t nsym);
+void ldecode_u8_u4  (uint8_t  **out, size_t *nout, void *in, size_t nin, real *cdf, size_t nsym);
+void ldecode_u16_u4 (uint16_t **out, size_t *nout, void *in, size_t nin, real *cdf, size_t nsym);
+void ldecode_u32_u4 (uint32_t **out, size_t *nout, void *in, size_t nin, real *cdf, size_t nsym);
+void ldecode_u64_u4 (uint64_t **out, size_t *nout, void *in, size_t nin, real *cdf, size_t nsym);
+void ldecode_u8_u8  (uint8_t  **out, size_t *nout, void *in, size_t nin, real *cdf, size_t nsym);
+void ldecode_u16_u8 (uint16_t **out, size_t *nout, void *in, size_t nin, real *cdf, size_t nsym);
+void ldecode_u32_u8 (uint32_t **out, size_t *nout, void *in, size_t nin, real *cdf, size_t nsym);
+void ldecode_u64_u8 (uint64_t **out, size_t *nout, void *in, size_t nin, real *cdf, size_t nsym);
+void ldecode_u8_u16 (uint8_t  **out, size_t *nout, void *in, size_t nin, real *cdf, size_t nsym);
+void ldecode_u16_u16(uint16_t **out, size_t *nout, void *in, size_t nin, real *cdf, size_t nsym);
+void ldecode_u32_u16(uint32_t **out, size_t *nout, void *in, size_t nin, real *cdf, size_t nsym);
+void ldecode_u64_u16(uint64_t **out, size_t *nout, void *in, size_t nin, real *cdf, size_t nsym);
+#ifdef AC_HAVE_U32_OUTPUT
+void lencode_u32_u8 (void **out, size_t *nout, uint8_t  *in, size_t nin, real *cdf, size_t nsym);
+void lencode_u32_u16(void **out, size_t *nout, uint16_t *in, size_t nin, real *cdf, size_t nsym);
+void lencode_u32_u32(void **out, size_t *nout, uint32_t *in, size_t nin, real *cdf, size_t nsym);
+void lencode_u32_u64(void **out, size_t *nout, uint64_t *in, size_t nin, real *cdf, size_t nsym);
+
+void ldecode_u8_u32 (uint8_t  **out, size_t *nout, void *in, size_t nin, real *cdf, size_t nsym);
+void ldecode_u16_u32(uint16_t **out, size_t *nout, void *in, size_t nin, real *cdf, size_t nsym);
+void ldecode_u32_u32(uint32_t **out, size_t *nout, void *in, size_t nin, real *cdf, size_t nsym);
+void ldecode_u64_u32(uint64_t **out, size_t *nout, void *in, size_t nin, real *cdf, size_t nsym);
+#endif
+/// @}
+
+/// \defgroup Adaptive Adaptive encoding/decoding
+/// @{
+// aencode_<Tout>_<Tin>, adecode_<Tout>_<Tin>
+// - no CDF.  Symbol frequencies are learned as the message is coded, using
+//   a Fenwick tree (see fenwick.h): O(log nsym) per symbol.
+// - <nsym> is the alphabet size.  Large alphabets need precision: up to
+//   524287 symbols for u1, u4 and u32 outputs, 131071 for u8, 511 for u16.
+// - ends with an END symbol like encode_/decode_, but the streams are not
+//   compatible.
+void aencode_u1_u8  (void **out, size_t *nout, uint8_t  *in, size_t nin, size_t nsym);
+void aencode_u1_u16 (void **out, size_t *nout, uint16_t *in, size_t nin, size_t nsym);
+void aencode_u1_u32 (void **out, size_t *nout, uint32_t *in, size_t nin, size_t nsym);
+void aencode_u1_u64 (void **out, size_t *nout, uint64_t *in, size_t nin, size_t nsym);
+void aencode_u4_u8  (void **out, size_t *nout, uint8_t  *in, size_t nin, size_t nsym);
+void aencode_u4_u16 (void **out, size_t *nout, uint16_t *in, size_t nin, size_t nsym);
+void aencode_u4_u32 (void **out, size_t *nout, uint32_t *in, size_t nin, size_t nsym);
+void aencode_u4_u64 (void **out, size_t *nout, uint64_t *in, size_t nin, size_t nsym);
+void aencode_u8_u8  (void **out, size_t *nout, uint8_t  *in, size_t nin, size_t nsym);
+void aencode_u8_u16 (void **out, size_t *nout, uint16_t *in, size_t nin, size_t nsym);
+void aencode_u8_u32 (void **out, size_t *nout, uint32_t *in, size_t nin, size_t nsym);
+void aencode_u8_u64 (void **out, size_t *nout, uint64_t *in, size_t nin, size_t nsym);
+void aencode_u16_u8 (void **out, size_t *nout, uint8_t  *in, size_t nin, size_t nsym);
+void aencode_u16_u16(void **out, size_t *nout, uint16_t *in, size_t nin, size_t nsym);
+void aencode_u16_u32(void **out, size_t *nout, uint32_t *in, size_t nin, size_t nsym);
+void aencode_u16_u64(void **out, size_t *nout, uint64_t *in, size_t nin, size_t nsym);
+
+void adecode_u8_u1  (uint8_t  **out, size_t *nout, void *in, size_t nin, size_t nsym);
+void adecode_u16_u1 (uint16_t **out, size_t *nout, void *in, size_t nin, size_t nsym);
+void adecode_u32_u1 (uint32_t **out, size_t *nout, void *in, size_t nin, size_t nsym);
+void adecode_u64_u1 (uint64_t **out, size_t *nout, void *in, size_t nin, size_t nsym);
+void adecode_u8_u4  (uint8_t  **out, size_t *nout, void *in, size_t nin, size_t nsym);
+void adecode_u16_u4 (uint16_t **out, size_t *nout, void *in, size_t nin, size_t nsym);
+void adecode_u32_u4 (uint32_t **out, size_t *nout, void *in, size_t nin, size_t nsym);
+void adecode_u64_u4 (uint64_t **out, size_t *nout, void *in, size_t nin, size_t nsym);
+void adecode_u8_u8  (uint8_t  **out, size_t *nout, void *in, size_t nin, size_t nsym);
+void adecode_u16_u8 (uint16_t **out, size_t *nout, void *in, size_t nin, size_t nsym);
+void adecode_u32_u8 (uint32_t **out, size_t *nout, void *in, size_t nin, size_t nsym);
+void adecode_u64_u8 (uint64_t **out, size_t *nout, void *in, size_t nin, size_t nsym);
+void adecode_u8_u16 (uint8_t  **out, size_t *nout, void *in, size_t nin, size_t nsym);
+void adecode_u16_u16(uint16_t **out, size_t *nout, void *in, size_t nin, size_t nsym);
+void adecode_u32_u16(uint32_t **out, size_t *nout, void *in, size_t nin, size_t nsym);
+void adecode_u64_u16(uint64_t **out, size_t *nout, void *in, size_t nin, size_t nsym);
+#ifdef AC_HAVE_U32_OUTPUT
+void aencode_u32_u8 (void **out, size_t *nout, uint8_t  *in, size_t nin, size_t nsym);
+void aencode_u32_u16(void **out, size_t *nout, uint16_t *in, size_t nin, size_t nsym);
+void aencode_u32_u32(void **out, size_t *nout, uint32_t *in, size_t nin, size_t nsym);
+void aencode_u32_u64(void **out, size_t *nout, uint64_t *in, size_t nin, size_t nsym);
+
+void adecode_u8_u32 (uint8_t  **out, size_t *nout, void *in, size_t nin, size_t nsym);
+void adecode_u16_u32(uint16_t **out, size_t *nout, void *in, size_t nin, size_t nsym);
+void adecode_u32_u32(uint32_t **out, size_t *nout, void *in, size_t nin, size_t nsym);
+void adecode_u64_u32(uint64_t **out, size_t *nout, void *in, size_t nin, size_t nsym);
+#endif
+/// @}
+
+/// \defgroup Integers Binarized integer encoding/decoding
+/// @{
+// iencode_<Tout>_<Tin>, idecode_<Tout>_<Tin>
+// - codes u32/u64 values without a CDF, using the same binarization as
+//   ac_encode_uint() with one model for the whole array.
+// - the value count is stored up front (as for lencode_*).
+void iencode_u1_u32 (void **out, size_t *nout, uint32_t  *in, size_t nin);
+void iencode_u1_u64 (void **out, size_t *nout, uint64_t  *in, size_t nin);
+void iencode_u4_u32 (void **out, size_t *nout, uint32_t  *in, size_t nin);
+void iencode_u4_u64 (void **out, size_t *nout, uint64_t  *in, size_t nin);
+void iencode_u8_u32 (void **out, size_t *nout, uint32_t  *in, size_t nin);
+void iencode_u8_u64 (void **out, size_t *nout, uint64_t  *in, size_t nin);
+void iencode_u16_u32(void **out, size_t *nout, uint32_t  *in, size_t nin);
+void iencode_u16_u64(void **out, size_t *nout, uint64_t  *in, size_t nin);
+
+void idecode_u32_u1 (uint32_t **out, size_t *nout, void *in, size_t nin);
+void idecode_u64_u1 (uint64_t **out, size_t *nout, void *in, size_t nin);
+void idecode_u32_u4 (uint32_t **out, size_t *nout, void *in, size_t nin);
+void idecode_u64_u4 (uint64_t **out, size_t *nout, void *in, size_t nin);
+void idecode_u32_u8 (uint32_t **out, size_t *nout, void *in, size_t nin);
+void idecode_u64_u8 (uint64_t **out, size_t *nout, void *in, size_t nin);
+void idecode_u32_u16(uint32_t **out, size_t *nout, void *in, size_t nin);
+void idecode_u64_u16(uint64_t **out, size_t *nout, void *in, size_t nin);
+#ifdef AC_HAVE_U32_OUTPUT
+void iencode_u32_u32(void **out, size_t *nout, uint32_t  *in, size_t nin);
+void iencode_u32_u64(void **out, size_t *nout, uint64_t  *in, size_t nin);
+void idecode_u32_u32(uint32_t **out, size_t *nout, void *in, size_t nin);
+void idecode_u64_u32(uint64_t **out, size_t *nout, void *in, size_t nin);
+#endif
+/// @}
+
+/// \defgroup Predictive Predictive encoding/decoding
+/// @{
+// pencode_<Tout>_<Tin>, pdecode_<Tout>_<Tin>
+// - for smooth u16/u32 series.  Each block of 4096 values is replaced by
+//   prediction residuals (see predict.h) that are coded like iencode_*.
+// - <mode> picks the transform.  AC_PRED_AUTO picks one per block by
+//   estimated entropy.  The choice is stored, so decoding needs no mode.
+void pencode_u1_u16 (void **out, size_t *nout, uint16_t  *in, size_t nin, ac_pred_t mode);
+void pencode_u1_u32 (void **out, size_t *nout, uint32_t  *in, size_t nin, ac_pred_t mode);
+void pencode_u4_u16 (void **out, size_t *nout, uint16_t  *in, size_t nin, ac_pred_t mode);
+void pencode_u4_u32 (void **out, size_t *nout, uint32_t  *in, size_t nin, ac_pred_t mode);
+void pencode_u8_u16 (void **out, size_t *nout, uint16_t  *in, size_t nin, ac_pred_t mode);
+void pencode_u8_u32 (void **out, size_t *nout, uint32_t  *in, size_t nin, ac_pred_t mode);
+void pencode_u16_u16(void **out, size_t *nout, uint16_t  *in, size_t nin, ac_pred_t mode);
+void pencode_u16_u32(void **out, size_t *nout, uint32_t  *in, size_t nin, ac_pred_t mode);
+
+void pdecode_u16_u1 (uint16_t **out, size_t *nout, void *in, size_t nin);
+void pdecode_u32_u1 (uint32_t **out, size_t *nout, void *in, size_t nin);
+void pdecode_u16_u4 (uint16_t **out, size_t *nout, void *in, size_t nin);
+void pdecode_u32_u4 (uint32_t **out, size_t *nout, void *in, size_t nin);
+void pdecode_u16_u8 (uint16_t **out, size_t *nout, void *in, size_t nin);
+void pdecode_u32_u8 (uint32_t **out, size_t *nout, void *in, size_t nin);
+void pdecode_u16_u16(uint16_t **out, size_t *nout, void *in, size_t nin);
+void pdecode_u32_u16(uint32_t **out, size_t *nout, void *in, size_t nin);
+#ifdef AC_HAVE_U32_OUTPUT
+void pencode_u32_u16(void **out, size_t *nout, uint16_t  *in, size_t nin, ac_pred_t mode);
+void pencode_u32_u32(void **out, size_t *nout, uint32_t  *in, size_t nin, ac_pred_t mode);
+
+void pdecode_u16_u32(uint16_t **out, size_t *nout, void *in, size_t nin);
+void pdecode_u32_u32(uint32_t **out, size_t *nout, void *in, size_t nin);
+#endif
+/// @}
+
+/// \defgroup RunLength Run length encoding/decoding
+/// @{
+// rencode_<Tout>_<Tin>, rdecode_<Tout>_<Tin>
+// - same CDF as encode_*.  Runs of the most likely symbol are coded as one
+//   binarized length each (see iencode_*); the other symbols are coded
+//   against the CDF with the dominant symbol removed.
+// - for sparse data, where one symbol is >90% of the message.  Decoding
+//   expands runs with a fill instead of a coder step per symbol.
+// - the symbol count is stored up front (as for lencode_*).
+void rencode_u1_u8  (void **out, size_t *nout, uint8_t  *in, size_t nin, real *cdf, size_t nsym);
+void rencode_u1_u16 (void **out, size_t *nout, uint16_t *in, size_t nin, real *cdf, size_t nsym);
+void rencode_u1_u32 (void **out, size_t *nout, uint32_t *in, size_t nin, real *cdf, size_t nsym);
+void rencode_u1_u64 (void **out, size_t *nout, uint64_t *in, size_t nin, real *cdf, size_t nsym);
+void rencode_u4_u8  (void **out, size_t *nout, uint8_t  *in, size_t nin, real *cdf, size_t nsym);
+void rencode_u4_u16 (void **out, size_t *nout, uint16_t *in, size_t nin, real *cdf, size_t nsym);
+void rencode_u4_u32 (void **out, size_t *nout, uint32_t *in, size_t nin, real *cdf, size_t nsym);
+void rencode_u4_u64 (void **out, size_t *nout, uint64_t *in, size_t nin, real *cdf, size_t nsym);
+void rencode_u8_u8  (void **out, size_t *nout, uint8_t  *in, size_t nin, real *cdf, size_t nsym);
+void rencode_u8_u16 (void **out, size_t *nout, uint16_t *in, size_t nin, real *cdf, size_t nsym);
+void rencode_u8_u32 (void **out, size_t *nout, uint32_t *in, size_t nin, real *cdf, size_t nsym);
+void rencode_u8_u64 (void **out, size_t *nout, uint64_t *in, size_t nin, real *cdf, size_t nsym);
+void rencode_u16_u8 (void **out, size_t *nout, uint8_t  *in, size_t nin, real *cdf, size_t nsym);
+void rencode_u16_u16(void **out, size_t *nout, uint16_t *in, size_t nin, real *cdf, size_t nsym);
+void rencode_u16_u32(void **out, size_t *nout, uint32_t *in, size_t nin, real *cdf, size_t nsym);
+void rencode_u16_u64(void **out, size_t *nout, uint64_t *in, size_t nin, real *cdf, size_t nsym);
+
+void rdecode_u8_u1  (uint8_t  **out, size_t *nout, void *in, size_t nin, real *cdf, size_t nsym);
+void rdecode_u16_u1 (uint16_t **out, size_t *nout, void *in, size_t nin, real *cdf, size_t nsym);
+void rdecode_u32_u1 (uint32_t **out, size_t *nout, void *in, size_t nin, real *cdf, size_t nsym);
+void rdecode_u64_u1 (uint64_t **out, size_t *nout, void *in, size_t nin, real *cdf, size_t nsym);
+void rdecode_u8_u4  (uint8_t  **out, size_t *nout, void *in, size_t nin, real *cdf, size_t nsym);
+void rdecode_u16_u4 (uint16_t **out, size_t *nout, void *in, size_t nin, real *cdf, size_t nsym);
+void rdecode_u32_u4 (uint32_t **out, size_t *nout, void *in, size_t nin, real *cdf, size_t nsym);
+void rdecode_u64_u4 (uint64_t **out, size_t *nout, void *in, size_t nin, real *cdf, size_t nsym);
+void rdecode_u8_u8  (uint8_t  **out, size_t *nout, void *in, size_t nin, real *cdf, size_t nsym);
+void rdecode_u16_u8 (uint16_t **out, size_t *nout, void *in, size_t nin, real *cdf, size_t nsym);
+void rdecode_u32_u8 (uint32_t **out, size_t *nout, void *in, size_t nin, real *cdf, size_t nsym);
+void rdecode_u64_u8 (uint64_t **out, size_t *nout, void *in, size_t nin, real *cdf, size_t nsym);
+void rdecode_u8_u16 (uint8_t  **out, size_t *nout, void *in, size_t nin, real *cdf, size_t nsym);
+void rdecode_u16_u16(uint16_t **out, size_t *nout, void *in, size_t nin, real *cdf, size_t nsym);
+void rdecode_u32_u16(uint32_t **out, size_t *nout, void *in, size_t nin, real *cdf, size_t nsym);
+void rdecode_u64_u16(uint64_t **out, size_t *nout, void *in, size_t nin, real *cdf, size_t nsym);
+#ifdef AC_HAVE_U32_OUTPUT
+void rencode_u32_u8 (void **out, size_t *nout, uint8_t  *in, size_t nin, real *cdf, size_t nsym);
+void rencode_u32_u16(void **out, size_t *nout, uint16_t *in, size_t nin, real *cdf, size_t nsym);
+void rencode_u32_u32(void **out, size_t *nout, uint32_t *in, size_t nin, real *cdf, size_t nsym);
+void rencode_u32_u64(void **out, size_t *nout, uint64_t *in, size_t nin, real *cdf, size_t nsym);
+
+void rdecode_u8_u32 (uint8_t  **out, size_t *nout, void *in, size_t nin, real *cdf, size_t nsym);
+void rdecode_u16_u32(uint16_t **out, size_t *nout, void *in, size_t nin, real *cdf, size_t nsym);
+void rdecode_u32_u32(uint32_t **out, size_t *nout, void *in, size_t nin, real *cdf, size_t nsym);
+void rdecode_u64_u32(uint64_t **out, size_t *nout, void *in, size_t nin, real *cdf, size_t nsym);
+#endif
+/// @}
+
+/// \defgroup Parametric Parametric encoding/decoding
+/// @{
+// mencode_<Tout>_<Tin>, mdecode_<Tout>_<Tin>
+// - code against a parametric model (see param.h) instead of a CDF.  No
+//   table is built: cumulative counts are computed per symbol.
+// - every symbol is codable, however unlikely.  That reserves a little of
+//   the interval per symbol and limits the alphabet to 2^29 symbols for u1
+//   output, 2^26 for u4, 2^22 for u8, 2^14 for u16 and 2^30 for u32.
+// - the symbol count is stored up front (as for lencode_*).  The model is
+//   not: decode with the same one.
+void mencode_u1_u8  (void **out, size_t *nout, uint8_t  *in, size_t nin, const ac_param_t *m);
+void mencode_u1_u16 (void **out, size_t *nout, uint16_t *in, size_t nin, const ac_param_t *m);
+void mencode_u1_u32 (void **out, size_t *nout, uint32_t *in, size_t nin, const ac_param_t *m);
+void mencode_u1_u64 (void **out, size_t *nout, uint64_t *in, size_t nin, const ac_param_t *m);
+void mencode_u4_u8  (void **out, size_t *nout, uint8_t  *in, size_t nin, const ac_param_t *m);
+void mencode_u4_u16 (void **out, size_t *nout, uint16_t *in, size_t nin, const ac_param_t *m);
+void mencode_u4_u32 (void **out, size_t *nout, uint32_t *in, size_t nin, const ac_param_t *m);
+void mencode_u4_u64 (void **out, size_t *nout, uint64_t *in, size_t nin, const ac_param_t *m);
+void mencode_u8_u8  (void **out, size_t *nout, uint8_t  *in, size_t nin, const ac_param_t *m);
+void mencode_u8_u16 (void **out, size_t *nout, uint16_t *in, size_t nin, const ac_param_t *m);
+void mencode_u8_u32 (void **out, size_t *nout, uint32_t *in, size_t nin, const ac_param_t *m);
+void mencode_u8_u64 (void **out, size_t *nout, uint64_t *in, size_t nin, const ac_param_t *m);
+void mencode_u16_u8 (void **out, size_t *nout, uint8_t  *in, size_t nin, const ac_param_t *m);
+void mencode_u16_u16(void **out, size_t *nout, uint16_t *in, size_t nin, const ac_param_t *m);
+void mencode_u16_u32(void **out, size_t *nout, uint32_t *in, size_t nin, const ac_param_t *m);
+void mencode_u16_u64(void **out, size_t *nout, uint64_t *in, size_t nin, const ac_param_t *m);
+
+void mdecode_u8_u1  (uint8_t  **out, size_t *nout, void *in, size_t nin, const ac_param_t *m);
+void mdecode_u16_u1 (uint16_t **out, size_t *nout, void *in, size_t nin, const ac_param_t *m);
+void mdecode_u32_u1 (uint32_t **out, size_t *nout, void *in, size_t nin, const ac_param_t *m);
+void mdecode_u64_u1 (uint64_t **out, size_t *nout, void *in, size_t nin, const ac_param_t *m);
+void mdecode_u8_u4  (uint8_t  **out, size_t *nout, void *in, size_t nin, const ac_param_t *m);
+void mdecode_u16_u4 (uint16_t **out, size_t *nout, void *in, size_t nin, const ac_param_t *m);
+void mdecode_u32_u4 (uint32_t **out, size_t *nout, void *in, size_t nin, const ac_param_t *m);
+void mdecode_u64_u4 (uint64_t **out, size_t *nout, void *in, size_t nin, const ac_param_t *m);
+void mdecode_u8_u8  (uint8_t  **out, size_t *nout, void *in, size_t nin, const ac_param_t *m);
+void mdecode_u16_u8 (uint16_t **out, size_t *nout, void *in, size_t nin, const ac_param_t *m);
+void mdecode_u32_u8 (uint32_t **out, size_t *nout, void *in, size_t nin, const ac_param_t *m);
+void mdecode_u64_u8 (uint64_t **out, size_t *nout, void *in, size_t nin, const ac_param_t *m);
+void mdecode_u8_u16 (uint8_t  **out, size_t *nout, void *in, size_t nin, const ac_param_t *m);
+void mdecode_u16_u16(uint16_t **out, size_t *nout, void *in, size_t nin, const ac_param_t *m);
+void mdecode_u32_u16(uint32_t **out, size_t *nout, void *in, size_t nin, const ac_param_t *m);
+void mdecode_u64_u16(uint64_t **out, size_t *nout, void *in, size_t nin, const ac_param_t *m);
+#ifdef AC_HAVE_U32_OUTPUT
+void mencode_u32_u8 (void **out, size_t *nout, uint8_t  *in, size_t nin, const ac_param_t *m);
+void mencode_u32_u16(void **out, size_t *nout, uint16_t *in, size_t nin, const ac_param_t *m);
+void mencode_u32_u32(void **out, size_t *nout, uint32_t *in, size_t nin, const ac_param_t *m);
+void mencode_u32_u64(void **out, size_t *nout, uint64_t *in, size_t nin, const ac_param_t *m);
+
+void mdecode_u8_u32 (uint8_t  **out, size_t *nout, void *in, size_t nin, const ac_param_t *m);
+void mdecode_u16_u32(uint16_t **out, size_t *nout, void *in, size_t nin, const ac_param_t *m);
+void mdecode_u32_u32(uint32_t **out, size_t *nout, void *in, size_t nin, const ac_param_t *m);
+void mdecode_u64_u32(uint64_t **out, size_t *nout, void *in, size_t nin, const ac_param_t *m);
+#endif
+/// @}
+
+/// \defgroup Extension Alphabet extension encoding/decoding
+/// @{
+// xencode_<Tout>_<Tin>, xdecode_<Tout>_<Tin>
+// - same CDF as encode_*.  Each run of <k> symbols is coded as one joint
+//   symbol, with the product of the symbol probabilities as its model: one
+//   coder step per <k> input symbols.
+// - <k>=0 picks k automatically: the largest with nsym^k<=4096 whose least
+//   likely tuple still respects the resolution rule above (probabilities
+//   greater than 1/2^(32-bitsof(output symbol))).  An explicit <k> must
+//   keep nsym^k<=4096, and is lowered until the least likely tuple
+//   respects the resolution rule.  The k used is the one stored.
+// - the symbol count and k are stored up front.  The last tuple is padded
+//   with the most likely symbol.
+void xencode_u1_u8  (void **out, size_t *nout, uint8_t  *in, size_t nin, real *cdf, size_t nsym, unsigned k);
+void xencode_u1_u16 (void **out, size_t *nout, uint16_t *in, size_t nin, real *cdf, size_t nsym, unsigned k);
+void xencode_u1_u32 (void **out, size_t *nout, uint32_t *in, size_t nin, real *cdf, size_t nsym, unsigned k);
+void xencode_u1_u64 (void **out, size_t *nout, uint64_t *in, size_t nin, real *cdf, size_t nsym, unsigned k);
+void xencode_u4_u8  (void **out, size_t *nout, uint8_t  *in, size_t nin, real *cdf, size_t nsym, unsigned k);
+void xencode_u4_u16 (void **out, size_t *nout, uint16_t *in, size_t nin, real *cdf, size_t nsym, unsigned k);
+void xencode_u4_u32 (void **out, size_t *nout, uint32_t *in, size_t nin, real *cdf, size_t nsym, unsigned k);
+void xencode_u4_u64 (void **out, size_t *nout, uint64_t *in, size_t nin, real *cdf, size_t nsym, unsigned k);
+void xencode_u8_u8  (void **out, size_t *nout, uint8_t  *in, size_t nin, real *cdf, size_t nsym, unsigned k);
+void xencode_u8_u16 (void **out, size_t *nout, uint16_t *in, size_t nin, real *cdf, size_t nsym, unsigned k);
+void xencode_u8_u32 (void **out, size_t *nout, uint32_t *in, size_t nin, real *cdf, size_t nsym, unsigned k);
+void xencode_u8_u64 (void **out, size_t *nout, uint64_t *in, size_t nin, real *cdf, size_t nsym, unsigned k);
+void xencode_u16_u8 (void **out, size_t *nout, uint8_t  *in, size_t nin, real *cdf, size_t nsym, unsigned k);
+void xencode_u16_u16(void **out, size_t *nout, uint16_t *in, size_t nin, real *cdf, size_t nsym, unsigned k);
+void xencode_u16_u32(void **out, size_t *nout, uint32_t *in, size_t nin, real *cdf, size_t nsym, unsigned k);
+void xencode_u16_u64(void **out, size_t *nout, uint64_t *in, size_t nin, real *cdf, size_t nsym, unsigned k);
+
+void xdecode_u8_u1  (uint8_t  **out, size_t *nout, void *in, size_t nin, real *cdf, size_t nsym);
+void xdecode_u16_u1 (uint16_t **out, size_t *nout, void *in, size_t nin, real *cdf, size_t nsym);
+void xdecode_u32_u1 (uint32_t **out, size_t *nout, void *in, size_t nin, real *cdf, size_t nsym);
+void xdecode_u64_u1 (uint64_t **out, size_t *nout, void *in, size_t nin, real *cdf, size_t nsym);
+void xdecode_u8_u4  (uint8_t  **out, size_t *nout, void *in, size_t nin, real *cdf, size_t nsym);
+void xdecode_u16_u4 (uint16_t **out, size_t *nout, void *in, size_t nin, real *cdf, size_t nsym);
+void xdecode_u32_u4 (uint32_t **out, size_t *nout, void *in, size_t nin, real *cdf, size_t nsym);
+void xdecode_u64_u4 (uint64_t **out, size_t *nout, void *in, size_t nin, real *cdf, size_t nsym);
+void xdecode_u8_u8  (uint8_t  **out, size_t *nout, void *in, size_t nin, real *cdf, size_t nsym);
+void xdecode_u16_u8 (uint16_t **out, size_t *nout, void *in, size_t nin, real *cdf, size_t nsym);
+void xdecode_u32_u8 (uint32_t **out, size_t *nout, void *in, size_t nin, real *cdf, size_t nsym);
+void xdecode_u64_u8 (uint64_t **out, size_t *nout, void *in, size_t nin, real *cdf, size_t nsym);
+void xdecode_u8_u16 (uint8_t  **out, size_t *nout, void *in, size_t nin, real *cdf, size_t nsym);
+void xdecode_u16_u16(uint16_t **out, size_t *nout, void *in, size_t nin, real *cdf, size_t nsym);
+void xdecode_u32_u16(uint32_t **out, size_t *nout, void *in, size_t nin, real *cdf, size_t nsym);
+void xdecode_u64_u16(uint64_t **out, size_t *nout, void *in, size_t nin, real *cdf, size_t nsym);
+#ifdef AC_HAVE_U32_OUTPUT
+void xencode_u32_u8 (void **out, size_t *nout, uint8_t  *in, size_t nin, real *cdf, size_t nsym, unsigned k);
+void xencode_u32_u16(void **out, size_t *nout, uint16_t *in, size_t nin, real *cdf, size_t nsym, unsigned k);
+void xencode_u32_u32(void **out, size_t *nout, uint32_t *in, size_t nin, real *cdf, size_t nsym, unsigned k);
+void xencode_u32_u64(void **out, size_t *nout, uint64_t *in, size_t nin, real *cdf, size_t nsym, unsigned k);
+
+void xdecode_u8_u32 (uint8_t  **out, size_t *nout, void *in, size_t nin, real *cdf, size_t nsym);
+void xdecode_u16_u32(uint16_t **out, size_t *nout, void *in, size_t nin, real *cdf, size_t nsym);
+void xdecode_u32_u32(uint32_t **out, size_t *nout, void *in, size_t nin, real *cdf, size_t nsym);
+void xdecode_u64_u32(uint64_t **out, size_t *nout, void *in, size_t nin, real *cdf, size_t nsym);
+#endif
+/// @}
+
+/// \defgroup Static Static model encoding/decoding
+/// @{
+// ac_static_model_t
+// - a model with its tables already scaled for one output digit <width>:
+//   <cdf> holds the nsym+1 cumulative counts encode_* builds from a real
+//   CDF.  The last one is where END starts.  <guide> is a lookup table
+//   that brackets the decoder's search, with AC_GUIDE_SIZE+1 entries.  It
+//   may be NULL.
+// - meant to be generated ahead of time as static const data by mkmodel
+//   (app/mkmodel.c) and compiled in.  Coding with it needs no setup: no
+//   allocation and no scaling.
+//
+// ac_static_model_build, ac_static_model_free
+// - build the same tables at run time, on the heap.  mkmodel uses them.
+//
+// ac_static_model_pmin
+// - the smallest probability a symbol of a real CDF should have to be coded
+//   with <width>-bit digits: the resolution rule of encode_* with a margin
+//   for float rounding in the CDF.  mkmodel and the ac compressor
+//   (app/cli.c) floor their models with it.
+//
+// sencode_<Tout>_<Tin>, sdecode_<Tout>_<Tin>
+// - same bitstream as encode_*/decode_* with the CDF the model was built
+//   from.  The model's <width> must match Tout (encode) or Tin (decode).
+#define AC_GUIDE_SIZE 4096
+
+typedef struct _ac_static_model_t
+{ unsigned        width;  // bits per output digit: 1,4,8,16 or 32
+  size_t          nsym;   // not counting END
+  const uint64_t *cdf;    // nsym+1 scaled cumulative counts
+  const uint32_t *guide;  // AC_GUIDE_SIZE+1 symbols, or NULL
+} ac_static_model_t;
+
+void ac_static_model_build(ac_static_model_t *m, unsigned width, real *cdf, size_t nsym);
+void ac_static_model_free (ac_static_model_t *m);
+double ac_static_model_pmin(unsigned width);
+
+void sencode_u1_u8  (void **out, size_t *nout, uint8_t  *in, size_t nin, const ac_static_model_t *m);
+void sencode_u1_u16 (void **out, size_t *nout, uint16_t *in, size_t nin, const ac_static_model_t *m);
+void sencode_u1_u32 (void **out, size_t *nout, uint32_t *in, size_t nin, const ac_static_model_t *m);
+void sencode_u1_u64 (void **out, size_t *nout, uint64_t *in, size_t nin, const ac_static_model_t *m);
+void sencode_u4_u8  (void **out, size_t *nout, uint8_t  *in, size_t nin, const ac_static_model_t *m);
+void sencode_u4_u16 (void **out, size_t *nout, uint16_t *in, size_t nin, const ac_static_model_t *m);
+void sencode_u4_u32 (void **out, size_t *nout, uint32_t *in, size_t nin, const ac_static_model_t *m);
+void sencode_u4_u64 (void **out, size_t *nout, uint64_t *in, size_t nin, const ac_static_model_t *m);
+void sencode_u8_u8  (void **out, size_t *nout, uint8_t  *in, size_t nin, const ac_static_model_t *m);
+void sencode_u8_u16 (void **out, size_t *nout, uint16_t *in, size_t nin, const ac_static_model_t *m);
+void sencode_u8_u32 (void **out, size_t *nout, uint32_t *in, size_t nin, const ac_static_model_t *m);
+void sencode_u8_u64 (void **out, size_t *nout, uint64_t *in, size_t nin, const ac_static_model_t *m);
+void sencode_u16_u8 (void **out, size_t *nout, uint8_t  *in, size_t nin, const ac_static_model_t *m);
+void sencode_u16_u16(void **out, size_t *nout, uint16_t *in, size_t nin, const ac_static_model_t *m);
+void sencode_u16_u32(void **out, size_t *nout, uint32_t *in, size_t nin, const ac_static_model_t *m);
+void sencode_u16_u64(void **out, size_t *nout, uint64_t *in, size_t nin, const ac_static_model_t *m);
+
+void sdecode_u8_u1  (uint8_t  **out, size_t *nout, void *in, size_t nin, const ac_static_model_t *m);
+void sdecode_u16_u1 (uint16_t **out, size_t *nout, void *in, size_t nin, const ac_static_model_t *m);
+void sdecode_u32_u1 (uint32_t **out, size_t *nout, void *in, size_t nin, const ac_static_model_t *m);
+void sdecode_u64_u1 (uint64_t **out, size_t *nout, void *in, size_t nin, const ac_static_model_t *m);
+void sdecode_u8_u4  (uint8_t  **out, size_t *nout, void *in, size_t nin, const ac_static_model_t *m);
+void sdecode_u16_u4 (uint16_t **out, size_t *nout, void *in, size_t nin, const ac_static_model_t *m);
+void sdecode_u32_u4 (uint32_t **out, size_t *nout, void *in, size_t nin, const ac_static_model_t *m);
+void sdecode_u64_u4 (uint64_t **out, size_t *nout, void *in, size_t nin, const ac_static_model_t *m);
+void sdecode_u8_u8  (uint8_t  **out, size_t *nout, void *in, size_t nin, const ac_static_model_t *m);
+void sdecode_u16_u8 (uint16_t **out, size_t *nout, void *in, size_t nin, const ac_static_model_t *m);
+void sdecode_u32_u8 (uint32_t **out, size_t *nout, void *in, size_t nin, const ac_static_model_t *m);
+void sdecode_u64_u8 (uint64_t **out, size_t *nout, void *in, size_t nin, const ac_static_model_t *m);
+void sdecode_u8_u16 (uint8_t  **out, size_t *nout, void *in, size_t nin, const ac_static_model_t *m);
+void sdecode_u16_u16(uint16_t **out, size_t *nout, void *in, size_t nin, const ac_static_model_t *m);
+void sdecode_u32_u16(uint32_t **out, size_t *nout, void *in, size_t nin, const ac_static_model_t *m);
+void sdecode_u64_u16(uint64_t **out, size_t *nout, void *in, size_t nin, const ac_static_model_t *m);
+#ifdef AC_HAVE_U32_OUTPUT
+void sencode_u32_u8 (void **out, size_t *nout, uint8_t  *in, size_t nin, const ac_static_model_t *m);
+void sencode_u32_u16(void **out, size_t *nout, uint16_t *in, size_t nin, const ac_static_model_t *m);
+void sencode_u32_u32(void **out, size_t *nout, uint32_t *in, size_t nin, const ac_static_model_t *m);
+void sencode_u32_u64(void **out, size_t *nout, uint64_t *in, size_t nin, const ac_static_model_t *m);
+
+void sdecode_u8_u32 (uint8_t  **out, size_t *nout, void *in, size_t nin, const ac_static_model_t *m);
+void sdecode_u16_u32(uint16_t **out, size_t *nout, void *in, size_t nin, const ac_static_model_t *m);
+void sdecode_u32_u32(uint32_t **out, size_t *nout, void *in, size_t nin, const ac_static_model_t *m);
+void sdecode_u64_u32(uint64_t **out, size_t *nout, void *in, size_t nin, const ac_static_model_t *m);
+#endif
+
+// kencode_<Tout>_<Tin>, kdecode_<Tout>_<Tin>
+// - one stream, with the model chosen symbol by symbol from <models>.  All
+//   of them must be built for the same width (Tout to encode, Tin to
+//   decode).  Switching is a pointer swap: nothing is rescaled.
+// - symbol i uses models[which[i]].  If <which> is NULL, it uses
+//   models[next(ctx,i,prev)] instead, where <prev> is symbol i-1 (0 for
+//   the first).  The decoder calls <next> in the same order with the same
+//   symbols, so a state machine in <ctx> sees the same inputs on both
+//   sides.
+// - length-prefixed like lencode_*: no END, and one flush for the whole
+//   stream.
+typedef size_t (*ac_model_fn)(void *ctx, size_t i, uint64_t prev);
+
+void kencode_u1_u8  (void **out, size_t *nout, uint8_t  *in, size_t nin, const ac_static_model_t *const *models, size_t nmodels, const uint8_t *which, ac_model_fn next, void *ctx);
+void kencode_u1_u16 (void **out, size_t *nout, uint16_t *in, size_t nin, const ac_static_model_t *const *models, size_t nmodels, const uint8_t *which, ac_model_fn next, void *ctx);
+void kencode_u1_u32 (void **out, size_t *nout, uint32_t *in, size_t nin, const ac_static_model_t *const *models, size_t nmodels, const uint8_t *which, ac_model_fn next, void *ctx);
+void kencode_u1_u64 (void **out, size_t *nout, uint64_t *in, size_t nin, const ac_static_model_t *const *models, size_t nmodels, const uint8_t *which, ac_model_fn next, void *ctx);
+void kencode_u4_u8  (void **out, size_t *nout, uint8_t  *in, size_t nin, const ac_static_model_t *const *models, size_t nmodels, const uint8_t *which, ac_model_fn next, void *ctx);
+void kencode_u4_u16 (void **out, size_t *nout, uint16_t *in, size_t nin, const ac_static_model_t *const *models, size_t nmodels, const uint8_t *which, ac_model_fn next, void *ctx);
+void kencode_u4_u32 (void **out, size_t *nout, uint32_t *in, size_t nin, const ac_static_model_t *const *models, size_t nmodels, const uint8_t *which, ac_model_fn next, void *ctx);
+void kencode_u4_u64 (void **out, size_t *nout, uint64_t *in, size_t nin, const ac_static_model_t *const *models, size_t nmodels, const uint8_t *which, ac_model_fn next, void *ctx);
+void kencode_u8_u8  (void **out, size_t *nout, uint8_t  *in, size_t nin, const ac_static_model_t *const *models, size_t nmodels, const uint8_t *which, ac_model_fn next, void *ctx);
+void kencode_u8_u16 (void **out, size_t *nout, uint16_t *in, size_t nin, const ac_static_model_t *const *models, size_t nmodels, const uint8_t *which, ac_model_fn next, void *ctx);
+void kencode_u8_u32 (void **out, size_t *nout, uint32_t *in, size_t nin, const ac_static_model_t *const *models, size_t nmodels, const uint8_t *which, ac_model_fn next, void *ctx);
+void kencode_u8_u64 (void **out, size_t *nout, uint64_t *in, size_t nin, const ac_static_model_t *const *models, size_t nmodels, const uint8_t *which, ac_model_fn next, void *ctx);
+void kencode_u16_u8 (void **out, size_t *nout, uint8_t  *in, size_t nin, const ac_static_model_t *const *models, size_t nmodels, const uint8_t *which, ac_model_fn next, void *ctx);
+void kencode_u16_u16(void **out, size_t *nout, uint16_t *in, size_t nin, const ac_static_model_t *const *models, size_t nmodels, const uint8_t *which, ac_model_fn next, void *ctx);
+void kencode_u16_u32(void **out, size_t *nout, uint32_t *in, size_t nin, const ac_static_model_t *const *models, size_t nmodels, const uint8_t *which, ac_model_fn next, void *ctx);
+void kencode_u16_u64(void **out, size_t *nout, uint64_t *in, size_t nin, const ac_static_model_t *const *models, size_t nmodels, const uint8_t *which, ac_model_fn next, void *ctx);
+
+void kdecode_u8_u1  (uint8_t  **out, size_t *nout, void *in, size_t nin, const ac_static_model_t *const *models, size_t nmodels, const uint8_t *which, ac_model_fn next, void *ctx);
+void kdecode_u16_u1 (uint16_t **out, size_t *nout, void *in, size_t nin, const ac_static_model_t *const *models, size_t nmodels, const uint8_t *which, ac_model_fn next, void *ctx);
+void kdecode_u32_u1 (uint32_t **out, size_t *nout, void *in, size_t nin, const ac_static_model_t *const *models, size_t nmodels, const uint8_t *which, ac_model_fn next, void *ctx);
+void kdecode_u64_u1 (uint64_t **out, size_t *nout, void *in, size_t nin, const ac_static_model_t *const *models, size_t nmodels, const uint8_t *which, ac_model_fn next, void *ctx);
+void kdecode_u8_u4  (uint8_t  **out, size_t *nout, void *in, size_t nin, const ac_static_model_t *const *models, size_t nmodels, const uint8_t *which, ac_model_fn next, void *ctx);
+void kdecode_u16_u4 (uint16_t **out, size_t *nout, void *in, size_t nin, const ac_static_model_t *const *models, size_t nmodels, const uint8_t *which, ac_model_fn next, void *ctx);
+void kdecode_u32_u4 (uint32_t **out, size_t *nout, void *in, size_t nin, const ac_static_model_t *const *models, size_t nmodels, const uint8_t *which, ac_model_fn next, void *ctx);
+void kdecode_u64_u4 (uint64_t **out, size_t *nout, void *in, size_t nin, const ac_static_model_t *const *models, size_t nmodels, const uint8_t *which, ac_model_fn next, void *ctx);
+void kdecode_u8_u8  (uint8_t  **out, size_t *nout, void *in, size_t nin, const ac_static_model_t *const *models, size_t nmodels, const uint8_t *which, ac_model_fn next, void *ctx);
+void kdecode_u16_u8 (uint16_t **out, size_t *nout, void *in, size_t nin, const ac_static_model_t *const *models, size_t nmodels, const uint8_t *which, ac_model_fn next, void *ctx);
+void kdecode_u32_u8 (uint32_t **out, size_t *nout, void *in, size_t nin, const ac_static_model_t *const *models, size_t nmodels, const uint8_t *which, ac_model_fn next, void *ctx);
+void kdecode_u64_u8 (uint64_t **out, size_t *nout, void *in, size_t nin, const ac_static_model_t *const *models, size_t nmodels, const uint8_t *which, ac_model_fn next, void *ctx);
+void kdecode_u8_u16 (uint8_t  **out, size_t *nout, void *in, size_t nin, const ac_static_model_t *const *models, size_t nmodels, const uint8_t *which, ac_model_fn next, void *ctx);
+void kdecode_u16_u16(uint16_t **out, size_t *nout, void *in, size_t nin, const ac_static_model_t *const *models, size_t nmodels, const uint8_t *which, ac_model_fn next, void *ctx);
+void kdecode_u32_u16(uint32_t **out, size_t *nout, void *in, size_t nin, const ac_static_model_t *const *models, size_t nmodels, const uint8_t *which, ac_model_fn next, void *ctx);
+void kdecode_u64_u16(uint64_t **out, size_t *nout, void *in, size_t nin, const ac_static_model_t *const *models, size_t nmodels, const uint8_t *which, ac_model_fn next, void *ctx);
+#ifdef AC_HAVE_U32_OUTPUT
+void kencode_u32_u8 (void **out, size_t *nout, uint8_t  *in, size_t nin, const ac_static_model_t *const *models, size_t nmodels, const uint8_t *which, ac_model_fn next, void *ctx);
+void kencode_u32_u16(void **out, size_t *nout, uint16_t *in, size_t nin, const ac_static_model_t *const *models, size_t nmodels, const uint8_t *which, ac_model_fn next, void *ctx);
+void kencode_u32_u32(void **out, size_t *nout, uint32_t *in, size_t nin, const ac_static_model_t *const *models, size_t nmodels, const uint8_t *which, ac_model_fn next, void *ctx);
+void kencode_u32_u64(void **out, size_t *nout, uint64_t *in, size_t nin, const ac_static_model_t *const *models, size_t nmodels, const uint8_t *which, ac_model_fn next, void *ctx);
+
+void kdecode_u8_u32 (uint8_t  **out, size_t *nout, void *in, size_t nin, const ac_static_model_t *const *models, size_t nmodels, const uint8_t *which, ac_model_fn next, void *ctx);
+void kdecode_u16_u32(uint16_t **out, size_t *nout, void *in, size_t nin, const ac_static_model_t *const *models, size_t nmodels, const uint8_t *which, ac_model_fn next, void *ctx);
+void kdecode_u32_u32(uint32_t **out, size_t *nout, void *in, size_t nin, const ac_static_model_t *const *models, size_t nmodels, const uint8_t *which, ac_model_fn next, void *ctx);
+void kdecode_u64_u32(uint64_t **out, size_t *nout, void *in, size_t nin, const ac_static_model_t *const *models, size_t nmodels, const uint8_t *which, ac_model_fn next, void *ctx);
+#endif
 /// @}
 
+/// \defgroup Blocks Per-block configuration
+/// @{
+// ac_block_encode
+// - cuts a byte message into blocks of <block> bytes (0 for
+//   AC_BLOCK_SIZE) and codes each one with its own quantized model.  The
+//   output digit width and the model's precision are picked per block.
+// - for each candidate, the coded size is computed from the block's
+//   histogram (cross entropy against the quantized model, plus the model
+//   and the flush) and the time from a table of measured per-symbol costs.
+//   The fastest candidate whose size is within <budget> (e.g. 0.01 for 1%)
+//   of the smallest is used.  Storing the block as is counts as a
+//   candidate.
+// - the choice goes in the block's header and the model leads the block's
+//   coded digits, so decoding needs no settings.  The model is coded as
+//   the change from the previous block's, when that has the same
+//   precision.  A distribution that drifts slowly costs little per block,
+//   and each block still codes with a static model.  Blocks therefore
+//   decode in order.
+//
+// ac_block_decode
+// - decodes a whole message.
+//
+// ac_block_configs
+// - reads the choices back from an encoded message: one per block, at most
+//   <ncfg>.  Returns the number of blocks.  <width> is 0 for stored blocks.
+#define AC_BLOCK_SIZE (1<<16)
+
+typedef struct _ac_block_config_t
+{ unsigned width;  // bits per output digit, or 0 for a stored block
+  unsigned bits;   // the model's frequencies sum to 2^bits
+} ac_block_config_t;
+
+void   ac_block_encode (void **out, size_t *nout, const uint8_t *in, size_t nin, size_t block, double budget);
+void   ac_block_decode (uint8_t **out, size_t *nout, const void *in, size_t nin);
+size_t ac_block_configs(const void *in, size_t nin, ac_block_config_t *cfg, size_t ncfg);
+/// @}
+
+/// \defgroup Stepwise Stepwise encoding/decoding
+/// @{
+// ac_encoder_open
+// - codes one symbol at a time against <cdf>.  Output digits are <width>.
+// - there is no END symbol: the decoder has to know what to read next.
+//   The input alphabet gets the whole interval (as for lencode_*).
+//
+// ac_encode_bits / ac_decode_bits
+// - bypass bits: the low <n> bits of <v> (n<=64), high bit first, coded as
+//   equiprobable bits in the same stream.  Each bit halves the interval
+//   with a shift; there's no multiply and no model lookup.  Use for
+//   incompressible fields like hashes and low-order bits.
+//
+// ac_encode_uniform / ac_decode_uniform
+// - codes <s> in 0..m-1 with all values equally likely, 0<m<2^16.  The
+//   interval split is computed from <m>: no table, no search, and one
+//   division to decode.  Use for digits of a radix conversion, ASCII
+//   armoring and the like.
+//
+// ac_encode_uint / ac_decode_uint
+// - codes any 64-bit value without a CDF.  The value's bit length is coded
+//   with adaptive contexts held in <m>, the bits below its leading one as
+//   bypass bits.  Small values are cheap; large ones cost roughly their
+//   bit length.
+// - <m> learns as it codes.  Initialize with ac_uint_model_init() and use
+//   one model per kind of field (counts, offsets, ids...).  The decoder
+//   needs its own model, initialized the same way.
+//
+// ac_encode_param / ac_decode_param
+// - codes <s> against a parametric model (see param.h and mencode_*).  The
+//   model can be different for every call.
+//
+// ac_encoder_close
+// - flushes, returns the output buffer via <*out>,<*nout> and frees <e>.
+//   The caller frees <*out>.
+//
+// ac_encoder_flush / ac_decoder_sync
+// - a sync point, like zlib's Z_SYNC_FLUSH.  ac_encoder_flush settles the
+//   interval in two digits, pads to a byte and restarts the interval.  The
+//   message doesn't end, and models like <m> above keep what they learned.
+//   Everything coded so far decodes from the first <*nout> bytes of
+//   <*out>, which won't change again.  <*out> is the encoder's buffer and
+//   stays valid until the next call on <e>.
+// - the decoder calls ac_decoder_sync at the same point.  It moves to the
+//   start of the next segment, which is also returned, and primes again.
+//   <in>,<nin>, if <in> isn't NULL, replace the input: a bigger buffer
+//   holding the same bytes and whatever has arrived since.
+// - segments are independent.  A decoder opened at a returned offset reads
+//   from that sync point on, given the state of the models there.
+// - each flush costs two digits plus the padding.
+typedef enum _ac_width_t
+{ AC_u1, AC_u4, AC_u8, AC_u16,
+#ifdef AC_HAVE_U32_OUTPUT
+  AC_u32,
+#endif
+} ac_width_t;
+
+#define AC_UINT_CONTEXTS 128
+typedef struct _ac_uint_model_t
+{ uint16_t p[AC_UINT_CONTEXTS]; // probability of a 0 for each bin, out of 4096
+} ac_uint_model_t;
+
+void ac_uint_model_init(ac_uint_model_t *m);
+
+typedef struct _ac_encoder_t ac_encoder_t;
+typedef struct _ac_decoder_t ac_decoder_t;
+
+ac_encoder_t* ac_encoder_open (ac_width_t width, real *cdf, size_t nsym);
+void          ac_encode_symbol(ac_encoder_t *e, uint64_t s);
+void          ac_encode_bits  (ac_encoder_t *e, uint64_t v, unsigned n);
+void          ac_encode_uniform(ac_encoder_t *e, uint64_t s, uint64_t m);
+void          ac_encode_uint  (ac_encoder_t *e, ac_uint_model_t *m, uint64_t v);
+void          ac_encode_param (ac_encoder_t *e, const ac_param_t *m, uint64_t s);
+void          ac_encoder_flush(ac_encoder_t *e, const void **out, size_t *nout);
+void          ac_encoder_close(ac_encoder_t *e, void **out, size_t *nout);
+
+ac_decoder_t* ac_decoder_open (ac_width_t width, real *cdf, size_t nsym, void *in, size_t nin);
+uint64_t      ac_decode_symbol(ac_decoder_t *d);
+uint64_t      ac_decode_bits  (ac_decoder_t *d, unsigned n);
+uint64_t      ac_decode_uniform(ac_decoder_t *d, uint64_t m);
+uint64_t      ac_decode_uint  (ac_decoder_t *d, ac_uint_model_t *m);
+uint64_t      ac_decode_param (ac_decoder_t *d, const ac_param_t *m);
+size_t        ac_decoder_sync (ac_decoder_t *d, void *in, size_t nin);
+void          ac_decoder_close(ac_decoder_t *d);
+/// @}
+
+/// \defgroup Records Record encoding/decoding
+/// @{
+// ac_record_encode
+// - codes <nrec> records, <stride> bytes apart, without gathering fields
+//   into arrays first.  Each field in the schema is an unsigned integer of
+//   <bytes> (1,2,4 or 8) at <offset> in the record, coded with its own
+//   <cdf> over <nsym> symbols.  Bytes outside the fields aren't coded.
+// - <columns>=0 interleaves fields in one stream, in record order.
+//   <columns>=1 codes each field into its own sub-stream, so a column can
+//   be located without decoding the others.
+// - the record count and layout are stored up front.  The schema and the
+//   width are not: decode with the same ones.
+//
+// ac_record_count
+// - returns the number of records in an encoded stream.
+//
+// ac_record_decode
+// - writes fields back into records <stride> bytes apart.  Other bytes are
+//   left alone.  <nrec> is the capacity of <rec>.  Returns the number of
+//   records decoded.
+typedef struct _ac_field_t
+{ size_t offset;  // in bytes from the start of the record
+  size_t bytes;   // field width: 1,2,4 or 8
+  real  *cdf;     // nsym+1 values, as for encode_*
+  size_t nsym;
+} ac_field_t;
+
+void   ac_record_encode(ac_width_t width, int columns, void **out, size_t *nout,
+                        const void *rec, size_t stride, size_t nrec, const ac_field_t *fields, size_t nfields);
+size_t ac_record_count (const void *in, size_t nin);
+size_t ac_record_decode(ac_width_t width, void *rec, size_t stride, size_t nrec,
+                        const void *in, size_t nin, const ac_field_t *fields, size_t nfields);
+/// @}
+
+/// \defgroup Images Image encoding/decoding
+/// @{
+// ac_image_encode
+// - codes a <w>x<h> 16-bit image whose rows are <stride> pixels apart.
+//   Pixels are predicted from their neighbours (LOCO-I median predictor)
+//   and residuals are coded with adaptive models picked by the local
+//   gradient.  No CDF.
+// - stripes of 64 rows are coded independently.  When built with
+//   AC_THREADS they are spread over <nthreads> threads; otherwise
+//   <nthreads> is ignored.
+//
+// ac_image_size
+// - reads the width and height of an encoded image.
+//
+// ac_image_decode
+// - <w>,<h> must match the encoded image.  Only the <w> pixels of each row
+//   are written.
+void ac_image_encode(ac_width_t width, void **out, size_t *nout,
+                     const uint16_t *img, size_t w, size_t h, size_t stride, unsigned nthreads);
+void ac_image_size  (const void *in, size_t nin, size_t *w, size_t *h);
+void ac_image_decode(ac_width_t width, uint16_t *img, size_t w, size_t h, size_t stride,
+                     const void *in, size_t nin, unsigned nthreads);
+/// @}
+
+/// \defgroup Workspace Heap-free encoding/decoding
+/// @{
+// encode_<Tout>_<Tin>_ws, decode_<Tout>_<Tin>_ws
+// - never call malloc.  Meant for short messages where allocation dominates.
+// - <out>: caller's buffer.  <*nout> is its capacity on input (bytes for
+//   encode, symbols for decode) and the amount written on output.
+// - <ws>: workspace of at least ac_workspace_size(nsym) bytes, aligned for
+//   uint64_t.  May be NULL if nsym<=AC_WS_STACK_NSYM; the model is then kept
+//   on the stack.
+// - returns 0 on success, -1 if the output didn't fit.  The contents of
+//   <out> are undefined in that case.
+// - the coded bytes are the same as encode_<Tout>_<Tin>'s.
+#define AC_WS_STACK_NSYM 64
+size_t ac_workspace_size(size_t nsym);
+
+int encode_u1_u8_ws  (void *out, size_t *nout, uint8_t  *in, size_t nin, real *cdf, size_t nsym, void *ws);
+int encode_u1_u16_ws (void *out, size_t *nout, uint16_t *in, size_t nin, real *cdf, size_t nsym, void *ws);
+int encode_u1_u32_ws (void *out, size_t *nout, uint32_t *in, size_t nin, real *cdf, size_t nsym, void *ws);
+int encode_u1_u64_ws (void *out, size_t *nout, uint64_t *in, size_t nin, real *cdf, size_t nsym, void *ws);
+int encode_u4_u8_ws  (void *out, size_t *nout, uint8_t  *in, size_t nin, real *cdf, size_t nsym, void *ws);
+int encode_u4_u16_ws (void *out, size_t *nout, uint16_t *in, size_t nin, real *cdf, size_t nsym, void *ws);
+int encode_u4_u32_ws (void *out, size_t *nout, uint32_t *in, size_t nin, real *cdf, size_t nsym, void *ws);
+int encode_u4_u64_ws (void *out, size_t *nout, uint64_t *in, size_t nin, real *cdf, size_t nsym, void *ws);
+int encode_u8_u8_ws  (void *out, size_t *nout, uint8_t  *in, size_t nin, real *cdf, size_t nsym, void *ws);
+int encode_u8_u16_ws (void *out, size_t *nout, uint16_t *in, size_t nin, real *cdf, size_t nsym, void *ws);
+int encode_u8_u32_ws (void *out, size_t *nout, uint32_t *in, size_t nin, real *cdf, size_t nsym, void *ws);
+int encode_u8_u64_ws (void *out, size_t *nout, uint64_t *in, size_t nin, real *cdf, size_t nsym, void *ws);
+int encode_u16_u8_ws (void *out, size_t *nout, uint8_t  *in, size_t nin, real *cdf, size_t nsym, void *ws);
+int encode_u16_u16_ws(void *out, size_t *nout, uint16_t *in, size_t nin, real *cdf, size_t nsym, void *ws);
+int encode_u16_u32_ws(void *out, size_t *nout, uint32_t *in, size_t nin, real *cdf, size_t nsym, void *ws);
+int encode_u16_u64_ws(void *out, size_t *nout, uint64_t *in, size_t nin, real *cdf, size_t nsym, void *ws);
+
+int decode_u8_u1_ws  (uint8_t  *out, size_t *nout, void *in, size_t nin, real *cdf, size_t nsym, void *ws);
+int decode_u16_u1_ws (uint16_t *out, size_t *nout, void *in, size_t nin, real *cdf, size_t nsym, void *ws);
+int decode_u32_u1_ws (uint32_t *out, size_t *nout, void *in, size_t nin, real *cdf, size_t nsym, void *ws);
+int decode_u64_u1_ws (uint64_t *out, size_t *nout, void *in, size_t nin, real *cdf, size_t nsym, void *ws);
+int decode_u8_u4_ws  (uint8_t  *out, size_t *nout, void *in, size_t nin, real *cdf, size_t nsym, void *ws);
+int decode_u16_u4_ws (uint16_t *out, size_t *nout, void *in, size_t nin, real *cdf, size_t nsym, void *ws);
+int decode_u32_u4_ws (uint32_t *out, size_t *nout, void *in, size_t nin, real *cdf, size_t nsym, void *ws);
+int decode_u64_u4_ws (uint64_t *out, size_t *nout, void *in, size_t nin, real *cdf, size_t nsym, void *ws);
+int decode_u8_u8_ws  (uint8_t  *out, size_t *nout, void *in, size_t nin, real *cdf, size_t nsym, void *ws);
+int decode_u16_u8_ws (uint16_t *out, size_t *nout, void *in, size_t nin, real *cdf, size_t nsym, void *ws);
+int decode_u32_u8_ws (uint32_t *out, size_t *nout, void *in, size_t nin, real *cdf, size_t nsym, void *ws);
+int decode_u64_u8_ws (uint64_t *out, size_t *nout, void *in, size_t nin, real *cdf, size_t nsym, void *ws);
+int decode_u8_u16_ws (uint8_t  *out, size_t *nout, void *in, size_t nin, real *cdf, size_t nsym, void *ws);
+int decode_u16_u16_ws(uint16_t *out, size_t *nout, void *in, size_t nin, real *cdf, size_t nsym, void *ws);
+int decode_u32_u16_ws(uint32_t *out, size_t *nout, void *in, size_t nin, real *cdf, size_t nsym, void *ws);
+int decode_u64_u16_ws(uint64_t *out, size_t *nout, void *in, size_t nin, real *cdf, size_t nsym, void *ws);
+#ifdef AC_HAVE_U32_OUTPUT
+int encode_u32_u8_ws (void *out, size_t *nout, uint8_t  *in, size_t nin, real *cdf, size_t nsym, void *ws);
+int encode_u32_u16_ws(void *out, size_t *nout, uint16_t *in, size_t nin, real *cdf, size_t nsym, void *ws);
+int encode_u32_u32_ws(void *out, size_t *nout, uint32_t *in, size_t nin, real *cdf, size_t nsym, void *ws);
+int encode_u32_u64_ws(void *out, size_t *nout, uint64_t *in, size_t nin, real *cdf, size_t nsym, void *ws);
+
+int decode_u8_u32_ws (uint8_t  *out, size_t *nout, void *in, size_t nin, real *cdf, size_t nsym, void *ws);
+int decode_u16_u32_ws(uint16_t *out, size_t *nout, void *in, size_t nin, real *cdf, size_t nsym, void *ws);
+int decode_u32_u32_ws(uint32_t *out, size_t *nout, void *in, size_t nin, real *cdf, size_t nsym, void *ws);
+int decode_u64_u32_ws(uint64_t *out, size_t *nout, void *in, size_t nin, real *cdf, size_t nsym, void *ws);
+#endif
+/// @}
+
+/// \defgroup Scan Decoding without an output buffer
+/// @{
+// decode_scan_<Tin>
+// - decodes a message made by encode_*_<Tin>, handing each symbol to
+//   <fn> as it comes out instead of storing it.
+// - <fn> returns 0 to keep going, or anything else to stop.  Decoding
+//   stops there, so the rest of the message costs nothing.
+// - <ws>: as for the *_ws functions.  If it's NULL and the alphabet is
+//   bigger than AC_WS_STACK_NSYM, the model goes on the heap.
+// - returns the number of symbols handed to <fn>, counting the one it
+//   stopped on.
+typedef int (*ac_symbol_fn)(void *ctx, uint64_t sym);
+
+size_t decode_scan_u1 (void *in, size_t nin, real *cdf, size_t nsym, ac_symbol_fn fn, void *ctx, void *ws);
+size_t decode_scan_u4 (void *in, size_t nin, real *cdf, size_t nsym, ac_symbol_fn fn, void *ctx, void *ws);
+size_t decode_scan_u8 (void *in, size_t nin, real *cdf, size_t nsym, ac_symbol_fn fn, void *ctx, void *ws);
+size_t decode_scan_u16(void *in, size_t nin, real *cdf, size_t nsym, ac_symbol_fn fn, void *ctx, void *ws);
+#ifdef AC_HAVE_U32_OUTPUT
+size_t decode_scan_u32(void *in, size_t nin, real *cdf, size_t nsym, ac_symbol_fn fn, void *ctx, void *ws);
+#endif
+/// @}
 
 /// \defgroup Variable Variable alphabet codings
 /// @{
 //
 // Variably sized encoding alphabet
+// - the output digits are coded with a closed-form uniform model over
+//   <noutsym> symbols (see ac_encode_uniform).
 //
 
 void vencode_u8 (uint8_t  **out, size_t *nout, size_t noutsym, uint8_t  *in, size_t nin, size_t ninsym, real *cdf);
@@ -0,0 +1,382 @@
+/**
+   \file
+   Header-only arithmetic coder for C++.
+
+   Same algorithm and bitstream as ac.c: a message encoded with
+   \c ac::encode<OutDigit>() decodes with the matching \c decode_*() function
+   and vice versa.
+
+   The output digit type fixes the radix, precision and renormalization
+   thresholds at compile time (see \ref ac::params), so the per-symbol loops
+   see constants where ac.c loads fields of \c state_t.  The digit writer and
+   reader are inline as well, so the whole coder can be inlined into the
+   caller.
+
+   \code
+   std::vector<uint8_t> code = ac::encode<uint8_t>(in,nin,cdf,nsym);
+   std::vector<uint32_t> msg = ac::decode<uint8_t,uint32_t>(code.data(),code.size(),cdf,nsym);
+   \endcode
+ */
+#pragma once
+
+#include <stdint.h>
+#include <string.h>
+#include <stddef.h>
+#include <vector>
+#include <utility> // std::move
+#include <memory>   // lazy
+#include <iterator> // lazy
+
+namespace ac {
+
+/// \defgroup CppCoder Header-only C++ coder
+/// @{
+
+struct u1 {}; ///< Tag for 1-bit output digits (packed 8 per byte, high bit first).
+struct u4 {}; ///< Tag for 4-bit output digits (packed 2 per byte, high nibble first).
+
+template<class OutDigit> struct digit_traits;
+template<> struct digit_traits<u1>       { static constexpr unsigned bits =  1; };
+template<> struct digit_traits<u4>       { static constexpr unsigned bits =  4; };
+template<> struct digit_traits<uint8_t>  { static constexpr unsigned bits =  8; };
+template<> struct digit_traits<uint16_t> { static constexpr unsigned bits = 16; };
+#if defined(__SIZEOF_INT128__)
+template<> struct digit_traits<uint32_t> { static constexpr unsigned bits = 32; }; ///< 64-bit interval, 128-bit products
+#endif
+
+/// Compile-time coder constants.  Mirrors \c init_u1() ... \c init_u32() in ac.c.
+template<class OutDigit> struct params
+{ static constexpr unsigned bits  = digit_traits<OutDigit>::bits; ///< log2(D)
+  static constexpr unsigned shift = (bits<32)?32:64;              ///< log2(D^P)
+  static constexpr uint64_t D     = 1ULL<<bits;
+  static constexpr uint64_t mask  = (shift<64)?((1ULL<<(shift&63))-1):~0ULL;
+  static constexpr uint64_t lowl  = 1ULL<<(shift-bits);           ///< D^(P-1)
+
+  /// (a*b)>>shift.  The 64-bit interval needs a 128-bit product.
+  static inline uint64_t mulshift(uint64_t a, uint64_t b)
+  {
+#if defined(__SIZEOF_INT128__)
+    if(shift==64)
+      return (uint64_t)(((unsigned __int128)a*b)>>64);
+#endif
+    return (a*b)>>(shift&63);
+  }
+};
+
+/**
+  Input CDF scaled to the integer interval.  Includes the END symbol.
+
+  Built exactly as \c init_common() in ac.c builds \c state_t::cdf.
+*/
+template<class OutDigit> class model
+{ public:
+    typedef params<OutDigit> P;
+
+    model(const float *cdf, size_t nsym)
+      : c_(nsym+1)
+    { if(P::shift==64)                 // float can't hold the wide scale
+      { const uint64_t top = P::mask-P::D;
+        const double   s   = (double)top;
+        for(size_t i=0;i<nsym;++i)
+        { uint64_t c = (uint64_t)(s*cdf[i]);
+          c_[i] = (c<top)?c:top;
+        }
+        c_[nsym] = top;
+        return;
+      }
+      const float    s   = (float)(P::mask-P::D);
+      uint64_t       top = (uint64_t)s;
+      if(top>=P::mask)
+        top = P::mask-P::D;
+      for(size_t i=0;i<nsym;++i)
+      { uint64_t c = (uint64_t)(s*cdf[i]);
+        c_[i] = (c<top)?c:top;
+      }
+      c_[nsym] = top;
+    }
+
+    size_t          nsym() const { return c_.size(); } ///< including END
+    uint64_t        end()  const { return c_.size()-1; }
+    const uint64_t *cdf()  const { return c_.data(); }
+
+  private:
+    std::vector<uint64_t> c_;
+};
+
+/// Appends digits to a byte buffer using the same layout as the stream.h push_* functions.
+template<class OutDigit> class digit_writer
+{ public:
+    typedef params<OutDigit> P;
+
+    digit_writer(): ndigits_(0) {}
+
+    inline void push(uint64_t v)
+    { if(P::bits==32)
+      { uint32_t d = (uint32_t)v;
+        size_t   n = d_.size();
+        d_.resize(n+4);
+        memcpy(&d_[n],&d,4);
+      } else if(P::bits==16)
+      { uint16_t d = (uint16_t)v;
+        size_t   n = d_.size();
+        d_.resize(n+2);
+        memcpy(&d_[n],&d,2);
+      } else if(P::bits==8)
+      { d_.push_back((uint8_t)v);
+      } else
+      { const unsigned per = (P::bits<8)?8/P::bits:1,
+                       k   = ndigits_%per;
+        if(k==0)
+          d_.push_back(0);
+        d_.back() |= (uint8_t)(v<<(8-P::bits*(k+1)));
+      }
+      ++ndigits_;
+    }
+
+    /// Adds one to the last digit written, propagating toward the front.
+    inline void carry()
+    { if(P::bits==32)
+      { size_t n = ndigits_;
+        uint32_t d;
+        do
+        { --n;
+          memcpy(&d,&d_[4*n],4);
+          ++d;
+          memcpy(&d_[4*n],&d,4);
+        } while(d==0);
+      } else if(P::bits==16)
+      { size_t n = ndigits_;
+        uint16_t d;
+        do
+        { --n;
+          memcpy(&d,&d_[2*n],2);
+          ++d;
+          memcpy(&d_[2*n],&d,2);
+        } while(d==0);
+      } else
+      { const unsigned per = (P::bits<8)?8/P::bits:1,
+                       k   = (ndigits_-1)%per;
+        size_t   i = d_.size()-1;
+        unsigned c = d_[i] + (1u<<(8-P::bits*(k+1)));
+        d_[i] = (uint8_t)c;
+        while(c>0xff)
+          c = ++d_[--i]==0?0x100:0;
+      }
+    }
+
+    std::vector<uint8_t>& bytes() { return d_; }
+
+  private:
+    std::vector<uint8_t> d_;
+    size_t               ndigits_;
+};
+
+/// Reads digits with the same layout as the stream.h pop_* functions.  Reads past the end return 0.
+template<class OutDigit> class digit_reader
+{ public:
+    typedef params<OutDigit> P;
+
+    digit_reader(const void *d, size_t nbytes)
+      : d_((const uint8_t*)d), n_(nbytes), idigit_(0) {}
+
+    inline uint64_t pop()
+    { const size_t i = idigit_++;
+      if(P::bits==32)
+      { uint32_t v;
+        if(4*i+3>=n_) return 0;
+        memcpy(&v,d_+4*i,4);
+        return v;
+      } else if(P::bits==16)
+      { uint16_t v;
+        if(2*i>=n_) return 0;
+        if(2*i+1>=n_) return d_[2*i]; // partial digit, as pop_u16 reads it on little-endian
+        memcpy(&v,d_+2*i,2);
+        return v;
+      } else if(P::bits==8)
+      { return (i<n_)?d_[i]:0;
+      } else
+      { const unsigned per = (P::bits<8)?8/P::bits:1;
+        const size_t   b   = i/per;
+        const unsigned k   = i%per;
+        if(b>=n_) return 0;
+        return (d_[b]>>(8-P::bits*(k+1)))&(P::D-1);
+      }
+    }
+
+  private:
+    const uint8_t *d_;
+    size_t         n_,idigit_;
+};
+
+/// Stepwise encoder.  Feed symbols with put(), then call finish().
+template<class OutDigit, class InSym> class encoder
+{ public:
+    typedef params<OutDigit> P;
+
+    explicit encoder(const model<OutDigit> &m)
+      : m_(m), b_(0), l_(P::mask) {}
+
+    inline void put(InSym s) { step((uint64_t)s); }
+
+    /// Codes the END symbol and flushes the final digits.  \returns the encoded bytes.
+    std::vector<uint8_t>& finish()
+    { step(m_.end());
+      const uint64_t a = b_;
+      b_ = (b_+(1ULL<<(P::shift-P::bits-1)))&P::mask; // D^(P-1)/2
+      if(a>b_)
+        out_.carry();
+      for(int i=0;i<2;++i)
+      { out_.push(b_>>(P::shift-P::bits));
+        b_ = (b_<<P::bits)&P::mask;
+      }
+      return out_.bytes();
+    }
+
+  private:
+    inline void step(uint64_t s)
+    { const uint64_t *C = m_.cdf();
+      const uint64_t  a = b_;
+      uint64_t        x,y;
+      y = l_;
+      if(s!=m_.end())
+        y = P::mulshift(y,C[s+1]);
+      x  = P::mulshift(l_,C[s]);
+      b_ = (b_+x)&P::mask;
+      l_ = y-x;
+      if(a>b_)
+        out_.carry();
+      while(l_<P::lowl)
+      { out_.push(b_>>(P::shift-P::bits));
+        l_ = (l_<<P::bits)&P::mask;
+        b_ = (b_<<P::bits)&P::mask;
+      }
+    }
+
+    const model<OutDigit>  &m_;
+    uint64_t                b_,l_;
+    digit_writer<OutDigit>  out_;
+};
+
+/// Stepwise decoder.  Call get() until it reports the END symbol.
+template<class OutDigit, class InSym> class decoder
+{ public:
+    typedef params<OutDigit> P;
+
+    decoder(const model<OutDigit> &m, const void *in, size_t nbytes)
+      : m_(m), l_(P::mask), v_(0), in_(in,nbytes)
+    { for(unsigned i=P::bits;i<=P::shift;i+=P::bits)
+        v_ += (1ULL<<(P::shift-i))*in_.pop();
+    }
+
+    /// \returns false on END, otherwise writes the next symbol to \a *s.
+    inline bool get(InSym *s)
+    { const uint64_t *C = m_.cdf();
+      uint64_t lo=0,hi=m_.nsym(),x=0,y=l_;
+      while(hi-lo>1)
+      { const uint64_t m = (lo+hi)>>1,
+                       z = P::mulshift(l_,C[m]);
+        if(z>v_) hi=m,y=z;
+        else     lo=m,x=z;
+      }
+      v_ -= x;
+      l_  = y-x;
+      while(l_<P::lowl)
+      { v_ = ((v_<<P::bits)&P::mask)+in_.pop();
+        l_ = ( l_<<P::bits)&P::mask;
+      }
+      if(lo==m_.end())
+        return false;
+      *s = (InSym)lo;
+      return true;
+    }
+
+  private:
+    const model<OutDigit>  &m_;
+    uint64_t                l_,v_;
+    digit_reader<OutDigit>  in_;
+};
+
+/// Encodes \a nin symbols.  Equivalent to \c encode_<OutDigit>_<InSym>().
+template<class OutDigit, class InSym>
+std::vector<uint8_t> encode(const InSym *in, size_t nin, const float *cdf, size_t nsym)
+{ model<OutDigit> m(cdf,nsym);
+  encoder<OutDigit,InSym> e(m);
+  for(size_t i=0;i<nin;++i)
+    e.put(in[i]);
+  return std::move(e.finish()); // finish() hands back a reference to the encoder's buffer
+}
+
+/// Decodes a message.  Equivalent to \c decode_<InSym>_<OutDigit>().
+template<class OutDigit, class InSym>
+std::vector<InSym> decode(const void *in, size_t nbytes, const float *cdf, size_t nsym)
+{ model<OutDigit> m(cdf,nsym);
+  decoder<OutDigit,InSym> d(m,in,nbytes);
+  std::vector<InSym> out;
+  InSym s;
+  while(d.get(&s))
+    out.push_back(s);
+  return out;
+}
+
+/**
+  Decodes a message lazily.  Symbols come out one at a time as the iterator
+  advances, and nothing is decoded past the last one the caller looks at.
+
+  \code
+  ac::lazy<uint8_t,uint32_t> msg(code.data(),code.size(),cdf,nsym);
+  auto it = std::find(msg.begin(),msg.end(),42);
+  \endcode
+
+  The iterators are input iterators over one shared decoder: copies advance
+  together, and begin() can only be walked once.  The range must outlive
+  its iterators.
+*/
+template<class OutDigit, class InSym> class lazy
+{ public:
+    typedef decoder<OutDigit,InSym> decoder_type;
+
+    class iterator
+    { public:
+        typedef std::input_iterator_tag iterator_category;
+        typedef InSym                   value_type;
+        typedef ptrdiff_t               difference_type;
+        typedef const InSym*            pointer;
+        typedef const InSym&            reference;
+
+        iterator() {}                                           ///< end
+        explicit iterator(const std::shared_ptr<decoder_type> &d)
+          : d_(d)
+        { ++*this;
+        }
+
+        reference operator*()  const { return s_; }
+        pointer   operator->() const { return &s_; }
+        iterator& operator++()
+        { if(!d_->get(&s_))
+            d_.reset();
+          return *this;
+        }
+        iterator  operator++(int) { iterator t(*this); ++*this; return t; }
+
+        bool operator==(const iterator &o) const { return d_==o.d_; }
+        bool operator!=(const iterator &o) const { return d_!=o.d_; }
+
+      private:
+        std::shared_ptr<decoder_type> d_; ///< NULL at the end
+        InSym                         s_;
+    };
+
+    lazy(const void *in, size_t nbytes, const float *cdf, size_t nsym)
+      : m_(cdf,nsym), in_(in), n_(nbytes) {}
+
+    iterator begin() const { return iterator(std::make_shared<decoder_type>(m_,in_,n_)); }
+    iterator end()   const { return iterator(); }
+
+  private:
+    model<OutDigit> m_;
+    const void     *in_;
+    size_t          n_;
+};
+
+/// @}
+} // namespace ac
@@ -0,0 +1,39 @@
+#pragma once
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+
+//
+// Bit Helpers
+// - small integer maps shared by the coders and the transforms.  Internal:
+//   not part of the API.
+//
+// ZIGZAG / UNZIGZAG
+// -----------------
+// Map a signed residual to an unsigned one: 0,-1,1,-2,... -> 0,1,2,3,...
+// <T> is the unsigned type and <S> the signed type of the same width.  The
+// residual is taken modulo 2^bits of <T>.
+//
+// bitlen
+// ------
+// Number of significant bits in <v>.  0 for 0.
+//
+#define ZIGZAG(T,S,r)   ((T)(((T)(r)<<1)^(T)((S)(r)>>(8*sizeof(T)-1))))
+#define UNZIGZAG(T,z)   ((T)(((z)>>1)^(T)(0-((z)&1))))
+
+static inline unsigned bitlen(uint64_t v)
+{ unsigned n=0;
+  if(v>>32) { n+=32; v>>=32; }
+  if(v>>16) { n+=16; v>>=16; }
+  if(v>> 8) { n+= 8; v>>= 8; }
+  if(v>> 4) { n+= 4; v>>= 4; }
+  if(v>> 2) { n+= 2; v>>= 2; }
+  if(v>> 1) { n+= 1; v>>= 1; }
+  return n+(unsigned)v;
+}
+
+#ifdef __cplusplus
+}
+#endif
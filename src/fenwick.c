@@ -0,0 +1,91 @@
+/**
+   \file
+   Fenwick (binary indexed) tree over symbol frequencies.
+
+   tree[i] holds the sum of freq over the 1-based range (i-lowbit(i),i], so
+   prefix sums and updates walk O(log n) nodes.  fenwick_find() descends
+   from the largest power of two to find the symbol holding a cumulative
+   count without a binary search over prefix sums.
+ */
+#include "fenwick.h"
+#include <stdio.h>
+#include <string.h>
+
+#define ENDL "\n"
+#define TRY(e) \
+  do{ if(!(e)) {\
+    printf("%s(%d):"ENDL "\t%s"ENDL "\tExpression evaluated as false."ENDL, \
+        __FILE__,__LINE__,#e); \
+    goto Error; \
+  }} while(0)
+
+#define SAFE_FREE(e) if(e) { free(e); (e)=NULL; }
+
+/// Builds the partial sums from freq in O(n).
+static void build(fenwick_t *f)
+{ size_t i;
+  f->total=0;
+  memset(f->tree,0,sizeof(*f->tree)*(f->n+1));
+  for(i=1;i<=f->n;++i)
+  { size_t j=i+(i&(0-i));
+    f->tree[i] += f->freq[i-1];
+    f->total   += f->freq[i-1];
+    if(j<=f->n)
+      f->tree[j] += f->tree[i];
+  }
+}
+
+void fenwick_init(fenwick_t *f, size_t n)
+{ size_t i;
+  memset(f,0,sizeof(*f));
+  TRY(n>0);
+  f->n=n;
+  TRY( f->freq=malloc(sizeof(*f->freq)*n) );
+  TRY( f->tree=malloc(sizeof(*f->tree)*(n+1)) );
+  for(i=0;i<n;++i)
+    f->freq[i]=1;
+  for(f->top=1;(f->top<<1)<=n;f->top<<=1);
+  build(f);
+  return;
+Error:
+  abort();
+}
+
+void fenwick_free(fenwick_t *f)
+{ SAFE_FREE(f->freq);
+  SAFE_FREE(f->tree);
+}
+
+void fenwick_add(fenwick_t *f, size_t s, uint32_t d)
+{ size_t i;
+  f->freq[s] += d;
+  f->total   += d;
+  for(i=s+1;i<=f->n;i+=i&(0-i))
+    f->tree[i] += d;
+}
+
+uint64_t fenwick_prefix(const fenwick_t *f, size_t s)
+{ uint64_t c=0;
+  for(;s>0;s-=s&(0-s))
+    c += f->tree[s];
+  return c;
+}
+
+size_t fenwick_find(const fenwick_t *f, uint64_t t, uint64_t *cum)
+{ size_t   pos=0,step;
+  uint64_t c=0;
+  for(step=f->top;step;step>>=1)  // descend: largest pos with prefix(pos)<=t
+    if(pos+step<=f->n && c+f->tree[pos+step]<=t)
+    { pos += step;
+      c   += f->tree[pos];
+    }
+  *cum=c;
+  return pos;
+}
+
+void fenwick_halve(fenwick_t *f)
+{ size_t i;
+  for(i=0;i<f->n;++i)
+    f->freq[i]=(f->freq[i]+1)>>1;
+  build(f);
+}
@@ -0,0 +1,45 @@
+#pragma once
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include <stdlib.h>
+
+//
+// Fenwick Tree Frequency Model
+// - integer frequencies over n symbols with O(log n) update, cumulative
+//   lookup and search.  Used by the adaptive coders (aencode_*/adecode_*).
+// - every symbol starts with a frequency of 1 and never drops below 1.
+//
+// fenwick_prefix
+// --------------
+// Returns freq[0]+...+freq[s-1].
+//
+// fenwick_find
+// ------------
+// Returns the symbol s with prefix(s) <= t < prefix(s+1), and prefix(s) via
+// <cum>.  Requires t < total.
+//
+// fenwick_halve
+// -------------
+// Halves every frequency, rounding up, and rebuilds the tree.  O(n).
+//
+typedef struct _fenwick_t
+{ size_t    n;      // number of symbols
+  size_t    top;    // largest power of 2 <= n
+  uint32_t *freq;   // n frequencies
+  uint32_t *tree;   // n+1 partial sums, 1-based
+  uint64_t  total;  // sum of freq
+} fenwick_t;
+
+void     fenwick_init  (fenwick_t *f, size_t n);
+void     fenwick_free  (fenwick_t *f);
+void     fenwick_add   (fenwick_t *f, size_t s, uint32_t d);
+uint64_t fenwick_prefix(const fenwick_t *f, size_t s);
+size_t   fenwick_find  (const fenwick_t *f, uint64_t t, uint64_t *cum);
+void     fenwick_halve (fenwick_t *f);
+
+#ifdef __cplusplus
+}
+#endif
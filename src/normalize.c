@@ -0,0 +1,69 @@
+#include "normalize.h"
+#include <stdio.h>
+
+#define ENDL "\n"
+#define TRY(e) \
+  do{ if(!(e)) {\
+    printf("%s(%d):"ENDL "\t%s"ENDL "\tExpression evaluated as false."ENDL, \
+        __FILE__,__LINE__,#e); \
+    goto Error; \
+  }} while(0)
+
+/// Moves the rounding error in \a freq (which sums to \a sum) to the most
+/// probable symbol until the frequencies sum to \a M.
+static void fix_rounding(uint32_t *freq, long long sum, size_t nsym, uint32_t M)
+{ size_t i;
+  while(sum!=M)
+  { size_t imax=0;
+    long long d;
+    for(i=1;i<nsym;++i)
+      if(freq[i]>freq[imax])
+        imax=i;
+    d = (long long)M-sum;
+    if(d<0 && -d>=freq[imax])            // can only take freq-1 from one symbol
+      d = 1-(long long)freq[imax];
+    TRY(d!=0);
+    freq[imax] += d;
+    sum += d;
+  }
+  return;
+Error:
+  abort();
+}
+
+void normalize_cdf(uint32_t *freq, const float *cdf, size_t nsym, unsigned bits)
+{ const uint32_t M = 1u<<bits;
+  long long sum=0;
+  size_t i;
+  TRY(nsym>0 && nsym<=M);
+  for(i=0;i<nsym;++i)
+  { double   p = cdf[i+1]-cdf[i];
+    uint32_t f = (uint32_t)(p*M+0.5);
+    if(p>0.0 && f==0)
+      f=1;
+    freq[i] = f;
+    sum += f;
+  }
+  fix_rounding(freq,sum,nsym,M);
+  return;
+Error:
+  abort();
+}
+
+void normalize_counts(uint32_t *freq, const uint64_t *counts, size_t nsym, uint64_t total, unsigned bits)
+{ const uint32_t M = 1u<<bits;
+  long long sum=0;
+  size_t i;
+  TRY(nsym>0 && nsym<=M && total>0);
+  for(i=0;i<nsym;++i)
+  { uint32_t f = (uint32_t)((double)counts[i]*M/total+0.5);
+    if(counts[i] && f==0)
+      f=1;
+    freq[i] = f;
+    sum += f;
+  }
+  fix_rounding(freq,sum,nsym,M);
+  return;
+Error:
+  abort();
+}
@@ -0,0 +1,24 @@
+#pragma once
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include <stdlib.h>
+
+//
+// CDF Quantization
+// - converts a real-valued CDF with nsym+1 entries (normalize_cdf, used by
+//   the table based coders rans.c and tans.c) or nsym symbol counts that add
+//   up to total (normalize_counts, used by ac_block_encode) into nsym integer
+//   frequencies that sum to exactly 2^bits.
+// - symbols with non-zero probability get a frequency of at least 1.
+//   The rounding error is taken from (or given to) the most probable symbol.
+// - requires nsym <= 2^bits.
+//
+void normalize_cdf   (uint32_t *freq, const float    *cdf,    size_t nsym, unsigned bits);
+void normalize_counts(uint32_t *freq, const uint64_t *counts, size_t nsym, uint64_t total, unsigned bits);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,245 @@
+/**
+   \file
+   Parametric models.
+
+   Each model is a continuous CDF F.  Symbol k covers [k-0.5,k+0.5), and the
+   symbol CDF is (F(k-0.5)-F(-0.5))/(F(nsym-0.5)-F(-0.5)).
+
+   The coder's intervals come from F, so F is evaluated in 32.32 fixed
+   point with integer arithmetic: 2^-y from a table of 2^(-j/64) and the
+   normal tail from a table over steps of 1/32 standard deviation, both
+   interpolated linearly.  Interpolating a decreasing table keeps F
+   monotone.  The parameters are converted once, in ac_param_init(), with
+   correctly rounded floating point operations and exact scalings.  No
+   libm function touches the intervals, so encoder and decoder agree
+   across platforms.
+
+   The inverses are only the decoder's first guess, so they use libm.  The
+   Gaussian's inverse uses the rational approximation 26.2.23 of
+   Abramowitz and Stegun[1] (|error|<4.5e-4).  The decoder corrects the
+   guess against the fixed point CDF.
+
+   \section References
+   \verbatim
+   [1]: Abramowitz, M. and Stegun, I. A. "Handbook of Mathematical
+        Functions." (1964).
+   \endverbatim
+ */
+#include "param.h"
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+
+#define ENDL "\n"
+#define TRY(e) \
+  do{ if(!(e)) {\
+    printf("%s(%d):"ENDL "\t%s"ENDL "\tExpression evaluated as false."ENDL, \
+        __FILE__,__LINE__,#e); \
+    goto Error; \
+  }} while(0)
+
+#define ONE       AC_PARAM_ONE
+#define CENTER_BITS (8)        ///< Fraction bits of the model's center
+#define TAIL_STEP   (27)       ///< log2 of the tail table's step (1/32) in 32.32 fixed point
+#define TAIL_N      (209)      ///< Tail table entries: 0 to 6.5 standard deviations
+
+/// 2^(-j/64) for j=0..64, in units of 2^-32.
+static const uint64_t exp2_table[65]={
+  4294967296,4248701965,4202935003,4157661043,4112874773,4068570940,
+  4024744348,3981389855,3938502376,3896076880,3854108391,3812591987,
+  3771522796,3730896002,3690706840,3650950594,3611622603,3572718252,
+  3534232978,3496162267,3458501653,3421246719,3384393094,3347936457,
+  3311872529,3276197082,3240905930,3205994934,3171459999,3137297074,
+  3103502151,3070071267,3037000500,3004285971,2971923842,2939910317,
+  2908241642,2876914102,2845924021,2815267765,2784941738,2754942382,
+  2725266179,2695909648,2666869345,2638141863,2609723834,2581611923,
+  2553802834,2526293303,2499080105,2472160047,2445529972,2419186755,
+  2393127307,2367348571,2341847524,2316621173,2291666561,2266980759,
+  2242560872,2218404036,2194507417,2170868212,2147483648
+};
+
+/// Upper tail of the standard normal, 1-Phi(j/32) for j=0..208, in units of 2^-32.
+static const uint64_t tail_table[TAIL_N]={
+  2147483648,2093947235,2040463074,1987083264,1933859599,1880843416,1828085449,1775635683,
+  1723543207,1671856086,1620621219,1569884217,1519689280,1470079085,1421094676,1372775364,
+  1325158638,1278280082,1232173297,1186869836,1142399148,1098788533,1056063096,1014245725,
+  973357067,933415517,894437218,856436066,819423723,783409645,748401109,714403254,
+  681419127,649449733,618494098,588549330,559610690,531671668,504724062,478758059,
+  453762323,429724081,406629220,384462372,363207012,342845553,323359439,304729240,
+  286934745,269955053,253768671,238353592,223687392,209747308,196510323,183953242,
+  172052769,160785577,150128378,140057987,130551380,121585752,113138573,105187629,
+  97711073,90687463,84095798,77915552,72126702,66709752,61645758,56916343,
+  52503710,48390661,44560598,40997531,37686084,34611490,31759596,29116852,
+  26670309,24407614,22316991,20387241,18607724,16968345,15459542,14072270,
+  12797986,11628628,10556605,9574774,8676424,7855260,7105383,6421272,
+  5797768,5230057,4713651,4244372,3818335,3431933,3081821,2764900,
+  2478304,2219383,1985695,1774985,1585180,1414372,1260811,1122889,
+  999134,888201,788856,699978,620540,549609,486337,429950,
+  379749,335100,295426,260207,228975,201304,176813,155157,
+  136027,119145,104260,91150,79615,69474,60568,52755,
+  45907,39910,34664,30080,26077,22586,19544,16896,
+  14593,12592,10855,9349,8044,6915,5939,5096,
+  4368,3741,3201,2736,2337,1994,1699,1447,
+  1231,1046,889,754,639,541,458,387,
+  327,276,232,196,164,138,116,97,
+  82,68,57,48,40,33,28,23,
+  19,16,13,11,9,8,6,5,
+  4,3,3,2,2,2,1,1,
+  1,1,1,0,0,0,0,0,
+  0
+};
+
+/// 2^-y for y in 32.32 fixed point, in units of 2^-32.  Non-increasing in y.
+static uint64_t exp2neg(uint64_t y)
+{ const uint64_t i=y>>32,
+                 f=y&0xffffffff,
+                 j=f>>26,
+                 r=f&((1<<26)-1),
+                 a=exp2_table[j],
+                 b=exp2_table[j+1];
+  if(i>32)
+    return 0;
+  return (a-(((a-b)*r)>>26))>>i;
+}
+
+/// 1-Phi(z) for z in 32.32 fixed point, in units of 2^-32.  Non-increasing in z.
+static uint64_t normal_tail(uint64_t z)
+{ const uint64_t j=z>>TAIL_STEP,
+                 r=z&((1<<TAIL_STEP)-1);
+  uint64_t a,b;
+  if(j>=TAIL_N-1)
+    return 0;
+  a=tail_table[j];
+  b=tail_table[j+1];
+  return a-(((a-b)*r)>>TAIL_STEP);
+}
+
+/**
+  log2(q) for q>=1 in 32.32 fixed point.  The normalization only scales by
+  powers of two, so it's exact; the fraction bits come from repeated
+  squaring in integer arithmetic.
+*/
+static uint64_t log2_fixed(double q)
+{ uint64_t e=0,x,g;
+  int i;
+  if(!(q<1e300))
+    return UINT64_MAX;
+  while(q>=2.0)
+  { q*=0.5;
+    ++e;
+  }
+  x=(uint64_t)(q*2147483648.0);       // 1.31 fixed point in [1,2)
+  g=e<<32;
+  for(i=31;i>=0;--i)
+  { x=(x*x)>>31;
+    if(x>=((uint64_t)1<<32))
+    { x>>=1;
+      g|=(uint64_t)1<<i;
+    }
+  }
+  return g;
+}
+
+/// \a x converted to 32.32 fixed point, rounded and saturated.  Scaling by a power of two is exact.
+static uint64_t to_fixed(double x)
+{ x=x*4294967296.0+0.5;
+  return (x>=18446744073709551615.0)?UINT64_MAX:(x>0.0)?(uint64_t)x:0;
+}
+
+/// a*b/2^CENTER_BITS, saturated anywhere past the tables' range.
+static uint64_t scale_distance(uint64_t a, uint64_t b)
+{ if(a && b>(UINT64_MAX>>1)/a)
+    return UINT64_MAX;
+  return (a*b)>>CENTER_BITS;
+}
+
+/// Continuous CDF of the model at k-0.5, in units of 2^-32.  Non-decreasing in \a k.
+static uint64_t F(const ac_param_t *m, size_t k)
+{ const int64_t  x=(int64_t)k<<CENTER_BITS;
+  const uint64_t d=(x<m->c)?(uint64_t)(m->c-x):(uint64_t)(x-m->c);
+  uint64_t t;
+  switch(m->kind)
+  { case AC_PARAM_GEOMETRIC:
+      return ONE-exp2neg((m->r && k>UINT64_MAX/m->r)?UINT64_MAX:k*m->r);
+    case AC_PARAM_LAPLACE:
+      t=exp2neg(scale_distance(d,m->r))>>1;
+      break;
+    default:
+      t=normal_tail(scale_distance(d,m->r));
+  }
+  return (x<m->c)?t:ONE-t;
+}
+
+/// Standard normal quantile for 0<p<1.  Abramowitz and Stegun 26.2.23.
+static double normal_quantile(double p)
+{ const double q=(p<0.5)?p:1.0-p,
+               t=sqrt(-2.0*log(q)),
+               x=t-(2.515517+t*(0.802853+t*0.010328))/(1.0+t*(1.432788+t*(0.189269+t*0.001308)));
+  return (p<0.5)?-x:x;
+}
+
+/// Approximate inverse of F() for 0<f<1, as a position on the real line.
+static double Finv(const ac_param_t *m, double f)
+{ switch(m->kind)
+  { case AC_PARAM_GEOMETRIC:
+      return (m->t>0.0)?log(1.0-f)/log(m->t)-0.5:0.0;
+    case AC_PARAM_LAPLACE:
+      return (f<0.5)?m->mean+m->scale*log(2.0*f):m->mean-m->scale*log(2.0*(1.0-f));
+    default:
+      return m->mean+m->scale*normal_quantile(f);
+  }
+}
+
+void ac_param_init(ac_param_t *m, ac_param_kind_t kind, size_t nsym, double mean, double scale)
+{ double c;
+  memset(m,0,sizeof(*m));
+  TRY(nsym>0 && (uint64_t)nsym<=ONE);
+  TRY(kind==AC_PARAM_GEOMETRIC || scale>0.0);
+  TRY(kind!=AC_PARAM_GEOMETRIC || mean>=0.0);
+  m->kind  = kind;
+  m->nsym  = nsym;
+  m->mean  = mean;
+  m->scale = scale;
+  m->t     = mean/(1.0+mean);
+  c=(mean+0.5)*(1<<CENTER_BITS)+0.5;
+  m->c = (c>=4611686018427387904.0)?INT64_C(4611686018427387904)
+        :(c<=-4611686018427387904.0)?-INT64_C(4611686018427387904)
+        :(int64_t)floor(c);
+  switch(kind)
+  { case AC_PARAM_GEOMETRIC: m->r=(mean>0.0)?log2_fixed((1.0+mean)/mean):UINT64_MAX; break;
+    case AC_PARAM_LAPLACE:   m->r=to_fixed(1.44269504088896340736/scale); break; // log2(e)
+    default:                 m->r=to_fixed(1.0/scale);
+  }
+  m->lo    = F(m,0);
+  m->z     = F(m,nsym)-m->lo;
+  return;
+Error:
+  abort();
+}
+
+uint64_t ac_param_cum(const ac_param_t *m, size_t k)
+{ uint64_t d;
+  if(k>=m->nsym)
+    return ONE;
+  if(m->z==0)
+    return ((uint64_t)k<<32)/m->nsym;
+  d=F(m,k)-m->lo;
+  return (d>=m->z)?ONE:(d<<32)/m->z;
+}
+
+double ac_param_cdf(const ac_param_t *m, size_t k)
+{ return ac_param_cum(m,k)/(double)ONE;
+}
+
+size_t ac_param_quantile(const ac_param_t *m, double u)
+{ double f,x;
+  if(m->z==0)
+    x = u*m->nsym;
+  else
+  { f = (m->lo+u*m->z)/(double)ONE;
+    if(!(f>0.0 && f<1.0))
+      return (f<=0.0)?0:m->nsym-1;
+    x = Finv(m,f)+0.5;
+  }
+  return (x<=0.0)?0:(x>=m->nsym-1.0)?m->nsym-1:(size_t)x;
+}
@@ -0,0 +1,69 @@
+#pragma once
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include <stdlib.h>
+
+//
+// Parametric Models
+// - distributions over the symbols 0..nsym-1 that are described by a mean
+//   and a scale instead of a table.  Cumulative probabilities are computed
+//   when they're needed, so a model takes a few bytes and changing its
+//   parameters costs nothing.
+// - symbol k gets the mass the continuous distribution puts on
+//   [k-0.5,k+0.5), renormalized over [-0.5,nsym-0.5).
+//     AC_PARAM_GEOMETRIC  P(k) ~ t^k with t=mean/(1+mean).  <scale> unused.
+//                         For magnitudes, e.g. zigzagged residuals.
+//     AC_PARAM_LAPLACE    two-sided exponential around <mean>, with scale
+//                         <scale>.
+//     AC_PARAM_GAUSSIAN   normal around <mean>, standard deviation <scale>.
+// - if the distribution puts (numerically) no mass on 0..nsym-1, the model
+//   falls back to uniform.
+// - the cumulative counts are computed in fixed point with integer
+//   arithmetic and small constant tables, so every platform codes the same
+//   intervals.  The parameters are rounded once by ac_param_init(): the
+//   center to 1/256 of a symbol, the rate to 2^-32.  At most 2^32 symbols.
+//
+// ac_param_cum
+// ------------
+// Returns P(symbol<k) in units of 2^-32 (AC_PARAM_ONE): 0 for k=0,
+// AC_PARAM_ONE for k=nsym.  This is what the coder uses.
+//
+// ac_param_cdf
+// ------------
+// ac_param_cum as a probability.
+//
+// ac_param_quantile
+// -----------------
+// Approximate inverse of ac_param_cdf.  Returns the symbol whose interval
+// holds <u>, clamped to 0..nsym-1.  Used as the decoder's first guess.
+//
+typedef enum _ac_param_kind_t
+{ AC_PARAM_GEOMETRIC,
+  AC_PARAM_LAPLACE,
+  AC_PARAM_GAUSSIAN,
+} ac_param_kind_t;
+
+#define AC_PARAM_ONE ((uint64_t)1<<32)
+
+typedef struct _ac_param_t
+{ ac_param_kind_t kind;
+  size_t nsym;
+  double mean,scale;
+  double t;     // geometric ratio, for the quantile
+  int64_t  c;   // mean+0.5 in 1/256ths of a symbol
+  uint64_t r;   // 32.32 fixed point: -log2(t), log2(e)/scale or 1/scale
+  uint64_t lo;  // F(-0.5) in units of 2^-32
+  uint64_t z;   // F(nsym-0.5)-F(-0.5); 0 for the uniform fallback
+} ac_param_t;
+
+void     ac_param_init    (ac_param_t *m, ac_param_kind_t kind, size_t nsym, double mean, double scale);
+uint64_t ac_param_cum     (const ac_param_t *m, size_t k);
+double   ac_param_cdf     (const ac_param_t *m, size_t k);
+size_t   ac_param_quantile(const ac_param_t *m, double u);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,133 @@
+/**
+   \file
+   Predictive transforms for integer sequences.
+
+   Each transform predicts x[i] from x[i-1] and x[i-2] and emits the
+   residual.  All arithmetic is unsigned, modulo 2^bits, so the inverse
+   recovers the input exactly even when the prediction overflows.
+
+   The forward loops read only the input, and the restrict pointers tell
+   the compiler the output doesn't alias it, so iterations are independent
+   and vectorize.  The inverses need the previous output and run serially.
+ */
+#include "predict.h"
+#include "bits.h"
+#include <math.h>
+#include <string.h>
+
+typedef uint16_t  u16;
+typedef uint32_t  u32;
+typedef int16_t   i16;
+typedef int32_t   i32;
+
+#define countof(e) (sizeof(e)/sizeof(*(e)))
+
+/// Predictions from the previous two values.
+#define PRED_DELTA(T,S,x1,x2)   (x1)
+#define PRED_DELTA2(T,S,x1,x2)  ((T)(2*(x1)-(x2)))
+#define PRED_LINEAR(T,S,x1,x2)  ((T)((x1)+(T)((S)((T)((x1)-(x2)))>>1)))
+
+#define DEFN_PREDICT(T,S) \
+void predict_##T(T *restrict res, const T *restrict in, size_t n, ac_pred_t p) \
+{ size_t i;                                                                  \
+  T x1=0,x2=0;                                                               \
+  switch(p)                                                                  \
+  { case AC_PRED_DELTA:                                                      \
+      if(n) res[0]=ZIGZAG(T,S,in[0]);                                        \
+      for(i=1;i<n;++i)                                                       \
+        res[i]=ZIGZAG(T,S,in[i]-in[i-1]);                                    \
+      return;                                                                \
+    case AC_PRED_DELTA2:                                                     \
+    case AC_PRED_LINEAR:                                                     \
+      for(i=0;i<n && i<2;++i)                                                \
+      { T q=(p==AC_PRED_DELTA2)?PRED_DELTA2(T,S,x1,x2):PRED_LINEAR(T,S,x1,x2); \
+        res[i]=ZIGZAG(T,S,in[i]-q);                                          \
+        x2=x1; x1=in[i];                                                     \
+      }                                                                      \
+      if(p==AC_PRED_DELTA2)                                                  \
+        for(;i<n;++i)                                                        \
+          res[i]=ZIGZAG(T,S,in[i]-PRED_DELTA2(T,S,in[i-1],in[i-2]));         \
+      else                                                                   \
+        for(;i<n;++i)                                                        \
+          res[i]=ZIGZAG(T,S,in[i]-PRED_LINEAR(T,S,in[i-1],in[i-2]));         \
+      return;                                                                \
+    case AC_PRED_XOR:                                                        \
+      if(n) res[0]=in[0];                                                    \
+      for(i=1;i<n;++i)                                                       \
+        res[i]=in[i]^in[i-1];                                                \
+      return;                                                                \
+    default:                                                                 \
+      if(res!=in)                                                            \
+        memcpy(res,in,n*sizeof(T));                                          \
+  }                                                                          \
+}                                                                            \
+                                                                             \
+void unpredict_##T(T *out, const T *res, size_t n, ac_pred_t p)             \
+{ size_t i;                                                                  \
+  T x1=0,x2=0;                                                               \
+  switch(p)                                                                  \
+  { case AC_PRED_DELTA:                                                      \
+      for(i=0;i<n;++i)                                                       \
+        out[i]=x1=(T)(x1+UNZIGZAG(T,res[i]));                                \
+      return;                                                                \
+    case AC_PRED_DELTA2:                                                     \
+      for(i=0;i<n;++i)                                                       \
+      { out[i]=(T)(PRED_DELTA2(T,S,x1,x2)+UNZIGZAG(T,res[i]));               \
+        x2=x1; x1=out[i];                                                    \
+      }                                                                      \
+      return;                                                                \
+    case AC_PRED_LINEAR:                                                     \
+      for(i=0;i<n;++i)                                                       \
+      { out[i]=(T)(PRED_LINEAR(T,S,x1,x2)+UNZIGZAG(T,res[i]));               \
+        x2=x1; x1=out[i];                                                    \
+      }                                                                      \
+      return;                                                                \
+    case AC_PRED_XOR:                                                        \
+      for(i=0;i<n;++i)                                                       \
+        out[i]=x1=(T)(x1^res[i]);                                            \
+      return;                                                                \
+    default:                                                                 \
+      if(out!=res)                                                           \
+        memcpy(out,res,n*sizeof(T));                                         \
+  }                                                                          \
+}
+DEFN_PREDICT(u16,i16);
+DEFN_PREDICT(u32,i32);
+
+/// Estimated bits to code \a n residuals with bit length histogram \a h.  See predict_choose_u16().
+static double cost(const size_t *h, size_t nh, size_t n)
+{ double c=0.0;
+  size_t k;
+  for(k=0;k<nh;++k)
+    if(h[k])
+      c += h[k]*(log2((double)n/h[k]) + (k?k-1:0));
+  return c;
+}
+
+#define PREDICT_CHUNK 1024 ///< Residuals are estimated a chunk at a time in a stack buffer.
+
+#define DEFN_PREDICT_CHOOSE(T) \
+ac_pred_t predict_choose_##T(const T *in, size_t n)                          \
+{ T t[PREDICT_CHUNK+2];                                                      \
+  ac_pred_t p,best=AC_PRED_NONE;                                             \
+  double    cbest=0.0;                                                       \
+  for(p=AC_PRED_NONE;p<AC_PRED_COUNT;p=(ac_pred_t)(p+1))                     \
+  { size_t h[8*sizeof(T)+1]={0},i,j;                                         \
+    double c;                                                                \
+    for(i=0;i<n;i+=PREDICT_CHUNK)                                            \
+    { const size_t m=(n-i<PREDICT_CHUNK)?(n-i):PREDICT_CHUNK,                \
+                   o=i?2:0;  /* rerun the two values before in[i] */         \
+      predict_##T(t,in+i-o,m+o,p);                                           \
+      for(j=0;j<m;++j)                                                       \
+        h[bitlen(t[o+j])]++;                                                 \
+    }                                                                        \
+    c=cost(h,countof(h),n);                                                  \
+    if(p==AC_PRED_NONE || c<cbest)                                           \
+    { best=p;                                                                \
+      cbest=c;                                                               \
+    }                                                                        \
+  }                                                                          \
+  return best;                                                               \
+}
+DEFN_PREDICT_CHOOSE(u16);
+DEFN_PREDICT_CHOOSE(u32);
@@ -0,0 +1,51 @@
+#pragma once
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include <stdlib.h>
+
+//
+// Predictive Transforms
+// - reversible maps from an integer sequence to prediction residuals.
+//   Smooth data gives residuals near zero: a small, skewed alphabet that
+//   codes well and needs a small model.
+// - residuals are taken modulo 2^bits, so every transform is exact for any
+//   input.  Signed residuals are zigzag mapped (0,-1,1,-2,... -> 0,1,2,3...)
+//   so small magnitudes become small symbols.  AC_PRED_XOR residuals are
+//   already unsigned and aren't mapped.
+// - each call is independent: the values before in[0] are taken as zero.
+//   Transform blocks separately to choose a different transform per block.
+// - the forward transforms are straight loops with no carried state, and
+//   src/predict.c is built with -O3 (see CMakeLists.txt), so they
+//   vectorize.  <res> and <in> must not overlap.  The inverses are prefix
+//   sums and may run in place.
+//
+// predict_choose
+// --------------
+// Returns the transform whose residuals have the lowest estimated
+// entropy.  The estimate is the cost of coding each residual as its bit
+// length, with the bit lengths' empirical entropy, plus the bits below
+// the leading one.
+//
+typedef enum _ac_pred_t
+{ AC_PRED_NONE,   // r = x
+  AC_PRED_DELTA,  // r = zigzag(x - x1)
+  AC_PRED_DELTA2, // r = zigzag(x - (2*x1-x2))
+  AC_PRED_LINEAR, // r = zigzag(x - (x1+(x1-x2)/2)), a damped extrapolation
+  AC_PRED_XOR,    // r = x ^ x1
+  AC_PRED_COUNT,
+  AC_PRED_AUTO = AC_PRED_COUNT // choose per block.  See pencode_*() in ac.h.
+} ac_pred_t;
+
+void      predict_u16       (uint16_t *res, const uint16_t *in,  size_t n, ac_pred_t p);
+void      predict_u32       (uint32_t *res, const uint32_t *in,  size_t n, ac_pred_t p);
+void      unpredict_u16     (uint16_t *out, const uint16_t *res, size_t n, ac_pred_t p);
+void      unpredict_u32     (uint32_t *out, const uint32_t *res, size_t n, ac_pred_t p);
+ac_pred_t predict_choose_u16(const uint16_t *in, size_t n);
+ac_pred_t predict_choose_u32(const uint32_t *in, size_t n);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,226 @@
+/**
+   \file
+   rANS entropy coder.
+
+   A range variant of Jarek Duda's asymmetric numeral systems[1], following
+   Fabian Giesen's byte-wise implementation[2].  It takes the same CDF and
+   element types as the arithmetic coder in ac.c so the two can be swapped.
+
+   The state \a x is kept in [L,256L) with L=2^23.  Coding symbol \a s with
+   frequency \a f and cumulative frequency \a c out of M=2^scale_bits is
+
+   \verbatim
+     encode:  x' = (x/f)*M + (x mod f) + c
+     decode:  s  = sym[x mod M]
+              x  = f*(x/M) + (x mod M) - c
+   \endverbatim
+
+   Decoding pops symbols in the reverse order they were pushed, so the
+   encoder walks the message backwards and writes bytes from the end of its
+   buffer toward the front.  The decoder then reads everything forwards.
+
+   The division in the encoder is replaced by a multiply with a precomputed
+   reciprocal (see rans_esym_t).  The decoder needs no division at all since
+   M is a power of two.
+
+   \section References
+   \verbatim
+   [1]: Duda, J. "Asymmetric numeral systems: entropy coding combining speed
+        of Huffman coding with compression rate of arithmetic coding."
+        arXiv:1311.2540 (2013).
+   [2]: Giesen, F. "Interleaved entropy coders." arXiv:1402.3392 (2014).
+        https://github.com/rygorous/ryg_rans
+   \endverbatim
+ */
+#include "rans.h"
+#include "stream.h"
+#include "normalize.h"
+#include <stdio.h>
+#include <string.h>
+
+typedef uint8_t   u8;
+typedef uint16_t  u16;
+typedef uint32_t  u32;
+typedef uint64_t  u64;
+
+#define ENDL "\n"
+#define TRY(e) \
+  do{ if(!(e)) {\
+    printf("%s(%d):"ENDL "\t%s"ENDL "\tExpression evaluated as false."ENDL, \
+        __FILE__,__LINE__,#e); \
+    goto Error; \
+  }} while(0)
+
+#define SAFE_FREE(e) if(e) { free(e); (e)=NULL; }
+
+/**
+    \defgroup rANS rANS Internals
+    @{
+ */
+
+#define RANS_L      (1u<<23) ///< Lower bound of the normalized state interval.
+#define RANS_MINBITS 12      ///< Smallest quantization, log2(M).
+#define RANS_MAXBITS 16      ///< Largest quantization.  Byte-wise renorm with a 32-bit state requires <= 16.
+
+/// Encoder symbol.  Precomputed so that encoding needs no division.
+typedef struct _rans_esym_t
+{ u32 xmax;   ///< Renormalize while x>=xmax: ((L>>scale_bits)<<8)*freq
+  u32 rcp;    ///< Fixed point reciprocal of freq
+  u32 bias;   ///< Added to x after the reciprocal multiply
+  u16 cmpl;   ///< M-freq
+  u16 shift;  ///< Post-shift for the reciprocal multiply
+} rans_esym_t;
+
+/// Quantized model.  Shared by the encoder and decoder.
+typedef struct _rans_model_t
+{ u32   bits;  ///< log2(M)
+  u32   nsym;
+  u32  *freq;  ///< nsym frequencies summing to M
+  u32  *cum;   ///< nsym+1 cumulative frequencies
+} rans_model_t;
+
+static void rans_model_free(rans_model_t *m)
+{ SAFE_FREE(m->freq);
+  SAFE_FREE(m->cum);
+}
+
+/// Quantizes the CDF to 2^bits, using more bits for bigger alphabets.
+static void rans_model_init(rans_model_t *m, real *cdf, size_t nsym)
+{ size_t i;
+  memset(m,0,sizeof(*m));
+  m->bits = RANS_MINBITS;
+  while(m->bits<RANS_MAXBITS && (1ULL<<m->bits)<4*nsym)
+    m->bits++;
+  m->nsym = (u32)nsym;
+  TRY( m->freq=malloc(sizeof(u32)*nsym) );
+  TRY( m->cum =malloc(sizeof(u32)*(nsym+1)) );
+  normalize_cdf(m->freq,cdf,nsym,m->bits);
+  m->cum[0]=0;
+  for(i=0;i<nsym;++i)
+    m->cum[i+1] = m->cum[i]+m->freq[i];
+  return;
+Error:
+  abort();
+}
+
+static void rans_esym_init(rans_esym_t *e, u32 start, u32 freq, u32 bits)
+{ e->xmax = ((RANS_L>>bits)<<8)*freq;
+  e->cmpl = (u16)((1u<<bits)-freq);
+  if(freq<2)                              // x/1 == x: make the multiply a no-op
+  { e->rcp   = ~0u;
+    e->shift = 0;
+    e->bias  = start+(1u<<bits)-1;
+  } else
+  { u32 s=0;
+    while(freq>(1u<<s))
+      s++;
+    e->rcp   = (u32)(((1ULL<<(s+31))+freq-1)/freq);
+    e->shift = (u16)(s-1);
+    e->bias  = start;
+  }
+}
+
+/// Pushes one symbol.  Renormalization output goes to *p, growing down.
+static inline void rans_put(u32 *x, u8 **p, const rans_esym_t *e)
+{ u32 v = *x;
+  while(v>=e->xmax)
+  { *--(*p) = (u8)v;
+    v >>= 8;
+  }
+  { u32 q = (u32)(((u64)v*e->rcp)>>32)>>e->shift;
+    *x = v+e->bias+q*e->cmpl;
+  }
+}
+
+#define DEFN_RANS_ENCODE(TIN) \
+void rans_encode_u8_##TIN(void **out, size_t *nout, TIN *in, size_t nin, real *cdf, size_t nsym) \
+{ rans_model_t m;                                            \
+  rans_esym_t *esym=NULL;                                    \
+  u8 *buf=NULL,*p;                                           \
+  size_t i,cap;                                              \
+  u32 x=RANS_L;                                              \
+  rans_model_init(&m,cdf,nsym);                              \
+  TRY( esym=malloc(sizeof(*esym)*nsym) );                    \
+  for(i=0;i<nsym;++i)                                        \
+    rans_esym_init(esym+i,m.cum[i],m.freq[i],m.bits);        \
+  cap = 2*nin+4;                /* at most 2 bytes/symbol */ \
+  TRY( buf=malloc(cap) );                                    \
+  p = buf+cap;                                               \
+  for(i=nin;i>0;--i)                                         \
+  { TRY(in[i-1]<nsym && m.freq[in[i-1]]);                    \
+    rans_put(&x,&p,esym+in[i-1]);                            \
+  }                                                          \
+  p-=4;                                                      \
+  p[0]=(u8)x; p[1]=(u8)(x>>8); p[2]=(u8)(x>>16); p[3]=(u8)(x>>24); \
+  { stream_t d={0};                                          \
+    attach(&d,*out,*nout);                                   \
+    push_varint(&d,nin);                                     \
+    push_bytes(&d,p,buf+cap-p);                              \
+    detach(&d,out,nout);                                     \
+  }                                                          \
+  free(buf);                                                 \
+  free(esym);                                                \
+  rans_model_free(&m);                                       \
+  return;                                                    \
+Error:                                                       \
+  abort();                                                   \
+}
+DEFN_RANS_ENCODE(u8);
+DEFN_RANS_ENCODE(u16);
+DEFN_RANS_ENCODE(u32);
+DEFN_RANS_ENCODE(u64);
+
+/// Builds the slot to symbol lookup table for the decoder.
+static u16* rans_slots(rans_model_t *m)
+{ u16 *t=NULL;
+  u32 s,i;
+  TRY( t=malloc(sizeof(*t)<<m->bits) );
+  for(s=0;s<m->nsym;++s)
+    for(i=m->cum[s];i<m->cum[s+1];++i)
+      t[i]=(u16)s;
+  return t;
+Error:
+  abort();
+}
+
+#define DEFN_RANS_DECODE(TOUT) \
+void rans_decode_##TOUT##_u8(TOUT **out, size_t *nout, void *in, size_t nin, real *cdf, size_t nsym) \
+{ rans_model_t m;                                            \
+  stream_t d={0};                                            \
+  u16 *slot=NULL;                                            \
+  const u8 *p,*end;                                          \
+  u64 i,n;                                                   \
+  u32 x,mask;                                                \
+  rans_model_init(&m,cdf,nsym);                              \
+  slot = rans_slots(&m);                                     \
+  mask = (1u<<m.bits)-1;                                     \
+  attach(&d,in,nin);                                         \
+  n = pop_varint(&d);                                        \
+  TRY(d.ibyte+4<=nin);                                       \
+  p   = d.d+d.ibyte;                                         \
+  end = (const u8*)in+nin;                                   \
+  detach(&d,NULL,NULL);                                      \
+  if(*nout<n)                                                \
+    TRY( *out=realloc(*out,sizeof(TOUT)*n) );                \
+  x = p[0]|(p[1]<<8)|(p[2]<<16)|((u32)p[3]<<24);             \
+  p += 4;                                                    \
+  for(i=0;i<n;++i)                                           \
+  { u32 s = slot[x&mask];                                    \
+    out[0][i] = (TOUT)s;                                     \
+    x = m.freq[s]*(x>>m.bits)+(x&mask)-m.cum[s];             \
+    while(x<RANS_L)                                          \
+      x = (x<<8)|((p<end)?*p++:0);                           \
+  }                                                          \
+  *nout = n;                                                 \
+  free(slot);                                                \
+  rans_model_free(&m);                                       \
+  return;                                                    \
+Error:                                                       \
+  abort();                                                   \
+}
+DEFN_RANS_DECODE(u8);
+DEFN_RANS_DECODE(u16);
+DEFN_RANS_DECODE(u32);
+DEFN_RANS_DECODE(u64);
+
+/** @} */ //end addtogroup rANS
@@ -0,0 +1,38 @@
+#pragma once
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include <stdlib.h>
+#include "ac.h"    // for real
+
+//
+// rANS Coder
+// - Same inputs as encode_u8_<Tin>/decode_<Tout>_u8 (see ac.h): a CDF over
+//   nsym symbols given as nsym+1 reals, and an output buffer that is
+//   reallocated as necessary.
+// - The CDF is quantized to 2^12..2^16 (more bits for bigger alphabets).
+//   Every symbol with non-zero probability gets at least one slot.  That
+//   costs a little compression relative to the arithmetic coder.
+// - 32-bit state, byte-wise renormalization.  The encoder runs over the
+//   message in reverse and uses a reciprocal multiply instead of a divide.
+//   The decoder runs forward with a table lookup per symbol.
+// - No END symbol.  The symbol count is stored at the front of the stream
+//   as a varint, so the decoder allocates its output once.
+// - Not compatible with the arithmetic coder's bitstream.
+//
+
+void rans_encode_u8_u8 (void **out, size_t *nout, uint8_t  *in, size_t nin, real *cdf, size_t nsym);
+void rans_encode_u8_u16(void **out, size_t *nout, uint16_t *in, size_t nin, real *cdf, size_t nsym);
+void rans_encode_u8_u32(void **out, size_t *nout, uint32_t *in, size_t nin, real *cdf, size_t nsym);
+void rans_encode_u8_u64(void **out, size_t *nout, uint64_t *in, size_t nin, real *cdf, size_t nsym);
+
+void rans_decode_u8_u8 (uint8_t  **out, size_t *nout, void *in, size_t nin, real *cdf, size_t nsym);
+void rans_decode_u16_u8(uint16_t **out, size_t *nout, void *in, size_t nin, real *cdf, size_t nsym);
+void rans_decode_u32_u8(uint32_t **out, size_t *nout, void *in, size_t nin, real *cdf, size_t nsym);
+void rans_decode_u64_u8(uint64_t **out, size_t *nout, void *in, size_t nin, real *cdf, size_t nsym);
+
+#ifdef __cplusplus
+}
+#endif
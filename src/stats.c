@@ -0,0 +1,33 @@
+#include "stats.h"
+#include <stdio.h>
+
+#define ENDL "\n"
+
+double ac_stats_bits_per_symbol(const ac_stats_t *stats)
+{ if(!stats || !stats->nsymbols) return 0.0;
+  return stats->nbits/(double)stats->nsymbols;
+}
+
+void ac_stats_print(const ac_stats_t *stats)
+{ if(!stats) return;
+#ifndef AC_STATS
+  printf("Stats: not collected (compile with AC_STATS)"ENDL);
+#else
+  typedef unsigned long long ull;
+  printf("Stats:"ENDL
+         "\tsymbols        %llu"ENDL
+         "\trenorms        %llu (%.3f/symbol)"ENDL
+         "\tcarries        %llu (longest: %llu bytes)"ENDL
+         "\treallocs       %llu (%llu bytes copied)"ENDL
+         "\tprobes         %llu (%.3f/symbol)"ENDL
+         "\tbits/symbol    %.4f (ideal: %.4f, model entropy: %.4f)"ENDL,
+         (ull)stats->nsymbols,
+         (ull)stats->nrenorm, stats->nsymbols?stats->nrenorm/(double)stats->nsymbols:0.0,
+         (ull)stats->ncarry, (ull)stats->maxcarry,
+         (ull)stats->nrealloc, (ull)stats->ncopied,
+         (ull)stats->nprobe, stats->nsymbols?stats->nprobe/(double)stats->nsymbols:0.0,
+         ac_stats_bits_per_symbol(stats),
+         stats->nsymbols?stats->ideal/stats->nsymbols:0.0,
+         stats->entropy);
+#endif
+}
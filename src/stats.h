@@ -0,0 +1,44 @@
+#pragma once
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+
+//
+// Coder Statistics
+// - opt-in.  Counters are only collected when the library is compiled with
+//   AC_STATS defined (cmake -DAC_STATS=ON).  Otherwise the STAT() hooks
+//   compile to nothing and the hot paths are unchanged.
+// - pass an ac_stats_t to one of the *_stats variants of encode/decode.
+//   The struct is zeroed on entry and filled on exit.
+// - without AC_STATS the struct is zeroed but otherwise left untouched.
+//
+
+typedef struct _ac_stats_t
+{ uint64_t nsymbols;   // symbols coded, including the END symbol
+  uint64_t nrenorm;    // renormalization iterations (one per output digit)
+  uint64_t ncarry;     // carries propagated into the output stream
+  uint64_t maxcarry;   // longest carry chain, in bytes touched by carry_*
+  uint64_t nrealloc;   // number of reallocs in the stream's maybe_resize
+  uint64_t ncopied;    // bytes moved by those reallocs (upper bound)
+  uint64_t nprobe;     // bisection probes in dselect
+  uint64_t nbits;      // size of the encoded message in bits
+  double   ideal;      // -sum(log2 p(s)) over coded symbols under the model
+  double   entropy;    // entropy of the model in bits/symbol
+} ac_stats_t;
+
+// achieved bits/symbol: nbits/nsymbols
+double ac_stats_bits_per_symbol(const ac_stats_t *stats);
+// prints a summary to stdout
+void   ac_stats_print(const ac_stats_t *stats);
+
+#ifdef AC_STATS
+#define STAT(st,...) do{ ac_stats_t *stat_=(st); if(stat_) { __VA_ARGS__; } } while(0)
+#else
+#define STAT(st,...)
+#endif
+
+#ifdef __cplusplus
+}
+#endif
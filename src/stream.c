@@ -1,4 +1,5 @@
 #include "stream.h"
+#include "stats.h"
 
 #include <stdint.h> // for fixed width integer types
 #include <stdlib.h> // for size_t
@@ -39,10 +40,39 @@ void attach(stream_t *self, void* d, size_t n)
 { if(self->own) SAFE_FREE(self->d);
   self->d = (u8*)d;
   self->own = 0;
+  self->fixed = 0;
   self->nbytes = n;
   maybe_init(self);
 }
 
+/// Redirects further pushes to the spill buffer.  The first half stays
+/// zeroed so a carry out of a spilled digit stops inside it.
+///
+/// Called when a push fills the fixed buffer, before anything is lost, so
+/// overflowed() also checks whether anything was written after the move.
+static void spill(stream_t *s)
+{ s->overflow++;
+  s->d        = s->spill;
+  s->nbytes   = sizeof(s->spill);
+  s->ibyte    = sizeof(s->spill)/2;
+  memset(s->spill,0,sizeof(s->spill));
+}
+
+void attach_fixed(stream_t *self, void* d, size_t n)
+{ if(self->own) SAFE_FREE(self->d);
+  memset(self,0,sizeof(*self));
+  self->d      = (u8*)d;
+  self->nbytes = n;
+  self->fixed  = 1;
+  if(!n)
+    spill(self);                 // nowhere to put the first push
+}
+
+int overflowed(const stream_t *self)
+{ return self->overflow>1
+      || (self->overflow && (self->ibyte>sizeof(self->spill)/2 || self->ibit));
+}
+
 void detach(stream_t *self, void **d, size_t *n)
 { if(d) *d = self->d;
   if(n) *n = self->ibyte;
@@ -51,7 +81,13 @@ void detach(stream_t *self, void **d, size_t *n)
 
 static void maybe_resize(stream_t *s)
 { if(s->ibyte>=s->nbytes)
+  { if(s->fixed)
+    { spill(s);
+      return;
+    }
+    STAT(s->stats, stat_->nrealloc++; stat_->ncopied+=s->nbytes);
     TRY(s->d = realloc(s->d,s->nbytes=(1.2*s->ibyte+50)));
+  }
   return;
 Error:
   abort();
@@ -113,9 +149,9 @@ void push_u4(stream_t *self, u8 v)
 
 #define DEFN_POP(T) \
   T pop_##T(stream_t *self) \
-  { T v; \
-    if(self->ibyte>=self->nbytes) return 0; \
-    v = *(T*)(self->d+self->ibyte); \
+  { T v=0; \
+    if(self->ibyte<self->nbytes) /* past the end reads 0, but still counts */ \
+      v = *(T*)(self->d+self->ibyte); \
     self->ibyte+=sizeof(T); \
     return v; \
   }
@@ -157,18 +193,112 @@ u8 pop_u4(stream_t *self)
   return v;
 }
 
+void push_bits(stream_t *self, u32 v, unsigned n)
+{ while(n)
+  { unsigned room = 8-self->ibit,
+             k    = (n<room)?n:room;
+    u8 *w = self->d+self->ibyte,
+        m = (u8)(((1u<<k)-1)<<(room-k)),
+        b = (u8)(v>>(n-k))<<(room-k);
+    *w = (*w & ~m) | (b & m);
+    self->mask = 1<<(room-k);   // last bit written, for carry_u1
+    n -= k;
+    self->ibit += k;
+    if(self->ibit==8)
+    { self->ibit=0;
+      self->ibyte++;
+      maybe_resize(self);
+    }
+  }
+}
+
+u32 pop_bits(stream_t *self, unsigned n)
+{ u32 v=0;
+  while(n)
+  { unsigned room = 8-self->ibit,
+             k    = (n<room)?n:room;
+    u8 b = (self->ibyte<self->nbytes)?self->d[self->ibyte]:0;
+    v = (v<<k)|((b>>(room-k))&((1u<<k)-1));
+    n -= k;
+    self->ibit += k;
+    if(self->ibit==8)
+    { self->ibit=0;
+      self->ibyte++;
+    }
+  }
+  return v;
+}
+
+void pad_bits(stream_t *self)
+{ if(self->ibit)
+  { self->d[self->ibyte] &= 0xff<<(8-self->ibit);
+    self->ibit=0;
+    self->ibyte++;
+    maybe_resize(self);
+  }
+}
+
+void push_varint(stream_t *self, u64 v)
+{ while(v>=0x80)
+  { push_u8(self,(u8)(v|0x80));
+    v>>=7;
+  }
+  push_u8(self,(u8)v);
+}
+
+u64 pop_varint(stream_t *self)
+{ u64 v=0;
+  int s=0;
+  u8  b;
+  do
+  { b  = pop_u8(self);
+    v |= (u64)(b&0x7f)<<s;
+    s += 7;
+  } while((b&0x80) && s<64);
+  return v;
+}
+
+void push_bytes(stream_t *self, const void *d, size_t n)
+{ if(self->fixed)
+  { if(self->ibyte+n>self->nbytes)
+    { spill(self);
+      self->overflow++;          // the bytes are lost
+      return;
+    }
+  } else if(self->ibyte+n>=self->nbytes)
+  { STAT(self->stats, stat_->nrealloc++; stat_->ncopied+=self->nbytes);
+    TRY(self->d = realloc(self->d,self->nbytes=(1.2*(self->ibyte+n)+50)));
+  }
+  memcpy(self->d+self->ibyte,d,n);
+  self->ibyte+=n;
+  return;
+Error:
+  abort();
+}
+
 #define MAX_TYPE(T) static const T max_##T = (T)(-1)
 MAX_TYPE(u8);
 MAX_TYPE(u16);
 MAX_TYPE(u32);
 MAX_TYPE(u64);
 
+#ifdef AC_STATS
+static void stat_carry(stream_t *self, size_t nbytes)
+{ ac_stats_t *st=self->stats;
+  if(!st) return;
+  st->ncarry++;
+  if(nbytes>st->maxcarry)
+    st->maxcarry=nbytes;
+}
+#endif
+
 #define DEFN_CARRY(T) \
 void carry_##T(stream_t *self)          \
 { size_t n = (self->ibyte-1)/sizeof(T); \
   while( ((T*)(self->d))[n]==max_##T )  \
     ((T*)(self->d))[n--]=0;             \
   ((T*)(self->d))[n]++;                 \
+  STAT(self->stats, stat_carry(self,((self->ibyte-1)/sizeof(T)-n+1)*sizeof(T))); \
 }
 DEFN_CARRY(u8);
 DEFN_CARRY(u16);
@@ -184,9 +314,13 @@ void carry_u1(stream_t *self)
   s=c<d[ibyte];                  // overflow test
   d[ibyte]=c;
   if(s)                          // need to keep carrying
-  { while(d[--ibyte]==255)
-      d[ibyte]=0;                // compliment all bits
-    d[ibyte] += 1;               // finish carrying
+  { size_t n=ibyte;
+    while(d[--n]==255)
+      d[n]=0;                    // compliment all bits
+    d[n] += 1;                   // finish carrying
+    STAT(self->stats, stat_carry(self,ibyte-n+1));
+  } else
+  { STAT(self->stats, stat_carry(self,1));
   }
 }
 void carry_u4(stream_t *self)
@@ -199,8 +333,12 @@ void carry_u4(stream_t *self)
   s=c<d[ibyte];                  // overflow test
   d[ibyte]=c;
   if(s)                          // need to keep carrying
-  { while(d[--ibyte]==255)
-      d[ibyte]=0;                // compliment all bits
-    d[ibyte] += 1;               // finish carrying
+  { size_t n=ibyte;
+    while(d[--n]==255)
+      d[n]=0;                    // compliment all bits
+    d[n] += 1;                   // finish carrying
+    STAT(self->stats, stat_carry(self,ibyte-n+1));
+  } else
+  { STAT(self->stats, stat_carry(self,1));
   }
 }
@@ -6,6 +6,8 @@ extern "C" {
 #include <stdint.h>
 #include <stdlib.h> // for size_t
 
+struct _ac_stats_t; // see stats.h
+
 //
 // Bit Stream
 // - will realloc to resize if necessary
@@ -28,6 +30,10 @@ typedef struct _stream_t
   uint8_t  mask;   //bit is set in the position of the last write
   uint8_t *d;      //data
   int      own;    //ownship flag: should this object be responsible for freeing d [??:used]
+  struct _ac_stats_t *stats; //optional counters (see stats.h).  Set after attach.
+  int      fixed;    //the buffer belongs to the caller and never grows (see attach_fixed)
+  int      overflow; //number of times a fixed buffer moved to spill.  Test with overflowed()
+  uint8_t  spill[16];//scratch that absorbs pushes after an overflow
 } stream_t;
 
 // Attach
@@ -43,8 +49,18 @@ typedef struct _stream_t
 // The stream, disowns (but does not free) the buffer, returning the stream
 // to an empty state.
 //
-void attach  (stream_t *s, void *d, size_t n);
-void detach  (stream_t *s, void **d, size_t *n);
+// Attach Fixed
+// ------------
+// Like attach, but <d> is never reallocated or freed and must not be NULL.
+// The stream never touches the heap.  Pushes past the end of <d> are
+// discarded and overflowed() returns 1; the contents of <d> are then
+// undefined.  <n> should be a multiple of the size of the pushed elements so
+// that a push never straddles the end.
+//
+void attach      (stream_t *s, void *d, size_t n);
+void attach_fixed(stream_t *s, void *d, size_t n);
+void detach      (stream_t *s, void **d, size_t *n);
+int  overflowed  (const stream_t *s);
 
 void push_u1 (stream_t *s, uint8_t  v);
 void push_u4 (stream_t *s, uint8_t  v);
@@ -68,6 +84,31 @@ uint64_t pop_u64 (stream_t *s);
  int32_t pop_i32 (stream_t *s);
  int64_t pop_i64 (stream_t *s);
 
+// Bits
+// ----
+// push_bits appends the low <n> bits of <v>, high bit first, packed like
+// push_u1.  pop_bits reads them back.  0<=n<=32.  Reads past the end
+// return 0's.
+//
+// pad_bits zeros the unused low bits of a partially written byte and moves
+// to the next byte boundary, so the partial byte is included by detach.
+void     push_bits(stream_t *s, uint32_t v, unsigned n);
+uint32_t pop_bits (stream_t *s, unsigned n);
+void     pad_bits (stream_t *s);
+
+// Varint
+// ------
+// Unsigned LEB128: 7 bits per byte, low bits first, high bit set on all but
+// the last byte.  At most 10 bytes for a 64-bit value.  Byte aligned: only
+// use on u8 streams or at a byte boundary (ibit==0).
+//
+// Push Bytes
+// ----------
+// Appends <n> bytes from <d>, growing the buffer once if necessary.
+void     push_varint(stream_t *s, uint64_t v);
+uint64_t pop_varint (stream_t *s);
+void     push_bytes (stream_t *s, const void *d, size_t n);
+
 void carry_u1 (stream_t* s);
 void carry_u4 (stream_t* s);
 void carry_u8 (stream_t* s);
@@ -0,0 +1,238 @@
+/**
+   \file
+   Tabled ANS (tANS) coder for small alphabets.
+
+   The ANS state \a x takes one of L=2^R values.  Each state is assigned a
+   symbol by spreading the symbols over the table in proportion to their
+   quantized frequencies.  Decoding a symbol is then
+
+   \verbatim
+     e = table[x]
+     s = e.sym
+     x = e.next + read(e.nbits)
+   \endverbatim
+
+   which needs no multiply.  Like rANS, the encoder must run over the
+   message backwards.  It saves the bits it would emit for each symbol and
+   writes them out in forward order once the final state is known.
+
+   \section Format
+   \verbatim
+     "tANS"         4 bytes magic
+     version        u8
+     R              u8, log2 of the table size
+     nsym           varint
+     freq[nsym]     varint each, sums to 2^R
+     count          varint, number of symbols in the message
+     state          R bits
+     bits...        per symbol, packed high bit first
+   \endverbatim
+
+   \section References
+   \verbatim
+   [1]: Duda, J. "Asymmetric numeral systems: entropy coding combining speed
+        of Huffman coding with compression rate of arithmetic coding."
+        arXiv:1311.2540 (2013).
+   [2]: Collet, Y. "Finite State Entropy."  https://github.com/Cyan4973/FiniteStateEntropy
+   \endverbatim
+ */
+#include "tans.h"
+#include "stream.h"
+#include "normalize.h"
+#include <stdio.h>
+#include <string.h>
+
+typedef uint8_t   u8;
+typedef uint16_t  u16;
+typedef uint32_t  u32;
+typedef uint64_t  u64;
+
+#define ENDL "\n"
+#define TRY(e) \
+  do{ if(!(e)) {\
+    printf("%s(%d):"ENDL "\t%s"ENDL "\tExpression evaluated as false."ENDL, \
+        __FILE__,__LINE__,#e); \
+    goto Error; \
+  }} while(0)
+
+#define SAFE_FREE(e) if(e) { free(e); (e)=NULL; }
+
+/**
+    \defgroup tANS tANS Internals
+    @{
+ */
+
+#define TANS_MAGIC   "tANS"
+#define TANS_VERSION 1
+#define TANS_LOG     11   ///< log2 of the table size used by the encoder
+#define TANS_MAXLOG  15   ///< largest table the decoder accepts (next must fit a u16)
+#define TANS_MAXSYM  256
+
+/// Decoder table entry.
+typedef struct _tans_dentry_t
+{ u16 next;   ///< Base of the next state.  Add the bits read.
+  u8  sym;    ///< Decoded symbol.
+  u8  nbits;  ///< Number of bits to read.
+} tans_dentry_t;
+
+/// \returns floor(log2(v)) for v>0
+static unsigned highbit(u32 v)
+{ unsigned r=0;
+  while(v>>=1)
+    ++r;
+  return r;
+}
+
+/// Assigns a symbol to each state.  Scatters each symbol's states over the table.
+static void tans_spread(u8 *spread, const u32 *freq, size_t nsym, unsigned R)
+{ const u32 L=1u<<R,
+            mask=L-1,
+            step=(L>>1)+(L>>3)+3; // odd, so it visits every state
+  u32 pos=0;
+  size_t s,j;
+  for(s=0;s<nsym;++s)
+    for(j=0;j<freq[s];++j)
+    { spread[pos]=(u8)s;
+      pos=(pos+step)&mask;
+    }
+}
+
+/// Builds the model when no cdf is given: histogram of the message.
+static real* tans_histogram(u8 *in, size_t nin, size_t *nsym)
+{ real *cdf=NULL;
+  size_t i,n=1;
+  for(i=0;i<nin;++i)
+    if(in[i]>=n) n=in[i]+1;
+  TRY( cdf=calloc(n+1,sizeof(*cdf)) );
+  for(i=0;i<nin;++i)
+    cdf[in[i]+1]++;
+  if(!nin)
+    cdf[1]=1;
+  for(i=1;i<=n;++i)
+    cdf[i]+=cdf[i-1];
+  for(i=1;i<=n;++i)
+    cdf[i]/=cdf[n];
+  *nsym=n;
+  return cdf;
+Error:
+  abort();
+}
+
+void tans_encode_u8(void **out, size_t *nout, u8 *in, size_t nin, real *cdf, size_t nsym)
+{ const unsigned R=TANS_LOG;
+  const u32 L=1u<<R;
+  u32  freq[TANS_MAXSYM],cum[TANS_MAXSYM+1],seen[TANS_MAXSYM]={0};
+  u8   nb0[TANS_MAXSYM];
+  u8   spread[1<<TANS_LOG];
+  u16  etab[1<<TANS_LOG];   // L+x for the states of each symbol, grouped by symbol
+  u32 *chunk=NULL,X=L;
+  real *hist=NULL;
+  size_t i;
+  stream_t d={0};
+
+  if(!cdf)
+    cdf = hist = tans_histogram(in,nin,&nsym);
+  TRY(nsym>0 && nsym<=TANS_MAXSYM);
+  normalize_cdf(freq,cdf,nsym,R);
+  cum[0]=0;
+  for(i=0;i<nsym;++i)
+  { cum[i+1]=cum[i]+freq[i];
+    nb0[i]=(u8)(freq[i]?R-highbit(freq[i]):0);
+  }
+  tans_spread(spread,freq,nsym,R);
+  for(i=0;i<L;++i)
+  { u8 s=spread[i];
+    etab[cum[s]+seen[s]++]=(u16)(L+i);
+  }
+
+  TRY( chunk=malloc(sizeof(*chunk)*(nin?nin:1)) );
+  for(i=nin;i>0;--i)          // backwards.  X in [L,2L)
+  { const u8  s=in[i-1];
+    const u32 f=freq[s];
+    unsigned  nb;
+    TRY(s<nsym && f);
+    nb = nb0[s]-((X>>nb0[s])<f);
+    chunk[i-1] = ((X&((1u<<nb)-1))<<8)|nb;
+    X = etab[cum[s]+(X>>nb)-f];
+  }
+
+  attach(&d,*out,*nout);
+  push_bytes(&d,TANS_MAGIC,4);
+  push_u8(&d,TANS_VERSION);
+  push_u8(&d,R);
+  push_varint(&d,nsym);
+  for(i=0;i<nsym;++i)
+    push_varint(&d,freq[i]);
+  push_varint(&d,nin);
+  push_bits(&d,X-L,R);
+  for(i=0;i<nin;++i)
+    push_bits(&d,chunk[i]>>8,chunk[i]&0xff);
+  pad_bits(&d);
+  detach(&d,out,nout);
+
+  free(chunk);
+  SAFE_FREE(hist);
+  return;
+Error:
+  abort();
+}
+
+int tans_is_tans(const void *in, size_t nin)
+{ const u8 *p=(const u8*)in;
+  return nin>=6 && !memcmp(p,TANS_MAGIC,4) && p[4]==TANS_VERSION;
+}
+
+void tans_decode_u8(u8 **out, size_t *nout, void *in, size_t nin)
+{ u32 freq[TANS_MAXSYM],next[TANS_MAXSYM];
+  tans_dentry_t *tab=NULL;
+  u8   *spread=NULL;
+  u64   i,n,nsym,sum=0;
+  unsigned R;
+  u32   x,L;
+  stream_t d={0};
+
+  TRY(tans_is_tans(in,nin));
+  attach(&d,in,nin);
+  d.ibyte=5;
+  R = pop_u8(&d);
+  TRY(R>0 && R<=TANS_MAXLOG);
+  L = 1u<<R;
+  nsym = pop_varint(&d);
+  TRY(nsym>0 && nsym<=TANS_MAXSYM);
+  for(i=0;i<nsym;++i)
+  { freq[i]=next[i]=(u32)pop_varint(&d);
+    sum+=freq[i];
+  }
+  TRY(sum==L);
+  n = pop_varint(&d);
+
+  TRY( spread=malloc(L) );
+  TRY( tab=malloc(sizeof(*tab)*L) );
+  tans_spread(spread,freq,nsym,R);
+  for(i=0;i<L;++i)
+  { const u8  s=spread[i];
+    const u32 k=next[s]++;                    // in [freq,2freq)
+    const unsigned nb=R-highbit(k);
+    tab[i].sym   = s;
+    tab[i].nbits = (u8)nb;
+    tab[i].next  = (u16)((k<<nb)-L);
+  }
+
+  if(*nout<n)
+    TRY( *out=realloc(*out,n) );
+  x = pop_bits(&d,R);
+  for(i=0;i<n;++i)
+  { const tans_dentry_t e=tab[x];
+    out[0][i] = e.sym;
+    x = e.next+pop_bits(&d,e.nbits);
+  }
+  *nout = n;
+  detach(&d,NULL,NULL);
+  free(tab);
+  free(spread);
+  return;
+Error:
+  abort();
+}
+
+/** @} */ //end addtogroup tANS
@@ -0,0 +1,32 @@
+#pragma once
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include <stdlib.h>
+#include "ac.h"    // for real
+
+//
+// Tabled ANS Coder
+// - for u8 messages over small alphabets (nsym<=256).
+// - encode takes the same CDF as encode_u8_u8 (see ac.h).  If <cdf> is
+//   NULL, it's built from the message's histogram.
+// - the output is self-identifying: it starts with a magic number and
+//   carries the quantized model and the symbol count.  Decoding doesn't need
+//   the CDF.
+// - decoding is one table lookup and one bit read per symbol.  The table is
+//   built once per message from the stored model.
+// - bits are written and read with the stream_t bit ops (push_bits/pop_bits).
+//
+// tans_is_tans
+// ------------
+// Returns 1 if <in> starts with a tANS header, 0 otherwise.
+//
+void tans_encode_u8(void **out, size_t *nout, uint8_t *in, size_t nin, real *cdf, size_t nsym);
+void tans_decode_u8(uint8_t **out, size_t *nout, void *in, size_t nin);
+int  tans_is_tans  (const void *in, size_t nin);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,476 @@
+#include <gtest/gtest.h>
+#include <string.h>
+#include <vector>
+#include "ac.h"
+#include "helpers.h"
+
+///// PREP
+
+// The demo message from app/test.c: runs of 0 with a few other symbols.
+class CoderTest : public ::testing::Test
+{ protected:
+    virtual void SetUp()
+    { pattern_message(msg_,countof(msg_));
+      pattern_cdf(cdf_);
+    }
+  uint8_t msg_[19*40];
+  real    cdf_[5];
+};
+
+///// Round trips
+
+TEST_F(CoderTest,RoundTripU8)
+{ void    *buf=NULL;
+  uint8_t *dec=NULL;
+  size_t   nbuf=0,ndec=0;
+  encode_u8_u8(&buf,&nbuf,msg_,countof(msg_),cdf_,4);
+  EXPECT_GT(nbuf,0);
+  EXPECT_LT(nbuf,countof(msg_));
+  decode_u8_u8(&dec,&ndec,buf,nbuf,cdf_,4);
+  ASSERT_EQ(countof(msg_),ndec);
+  EXPECT_EQ(0,memcmp(msg_,dec,ndec));
+  free(buf);
+  free(dec);
+}
+
+///// Statistics
+
+#ifdef AC_STATS
+TEST_F(CoderTest,Stats)
+{ void    *buf=NULL;
+  uint8_t *dec=NULL;
+  size_t   nbuf=0,ndec=0;
+  ac_stats_t es,ds;
+  encode_u8_u8_stats(&buf,&nbuf,msg_,countof(msg_),cdf_,4,&es);
+  decode_u8_u8_stats(&dec,&ndec,buf,nbuf,cdf_,4,&ds);
+  ASSERT_EQ(countof(msg_),ndec);
+  EXPECT_EQ(countof(msg_)+1,es.nsymbols); // +1 for END
+  EXPECT_EQ(es.nsymbols,ds.nsymbols);
+  EXPECT_EQ(8*nbuf,es.nbits);
+  EXPECT_EQ(nbuf,es.nrenorm);             // one renorm per output byte
+  EXPECT_GT(ds.nprobe,0);
+  EXPECT_EQ(0,es.nprobe);
+  EXPECT_GE(es.maxcarry,es.ncarry?1u:0u);
+  EXPECT_NEAR(es.ideal,ds.ideal,1e-6);
+  // coded size is within a few bytes of the ideal code length
+  EXPECT_LT(es.nbits,es.ideal+64);
+  EXPECT_GT(es.entropy,1.0);
+  EXPECT_LT(es.entropy,2.0);
+  free(buf);
+  free(dec);
+}
+
+TEST_F(CoderTest,StatsCountsReallocs)
+{ void       *buf=NULL;
+  uint8_t    *dec=NULL;
+  size_t      nbuf=0,ndec=0;
+  ac_stats_t  ds;
+  encode_u8_u8(&buf,&nbuf,msg_,countof(msg_),cdf_,4);
+  decode_u8_u8_stats(&dec,&ndec,buf,nbuf,cdf_,4,&ds); // output starts at 4096 bytes
+  EXPECT_EQ(0,ds.nrealloc);
+  free(dec); dec=NULL; ndec=16;
+  dec=(uint8_t*)malloc(ndec);
+  decode_u8_u8_stats(&dec,&ndec,buf,nbuf,cdf_,4,&ds);
+  EXPECT_GT(ds.nrealloc,0);
+  EXPECT_GE(ds.ncopied,16);
+  free(buf);
+  free(dec);
+}
+#else
+// Without AC_STATS the struct is only zeroed.
+TEST_F(CoderTest,StatsZeroedWhenOff)
+{ void    *buf=NULL;
+  uint8_t *dec=NULL;
+  size_t   nbuf=0,ndec=0;
+  ac_stats_t es,ds,zero;
+  memset(&es,0xff,sizeof(es));
+  memset(&ds,0xff,sizeof(ds));
+  memset(&zero,0,sizeof(zero));
+  encode_u8_u8_stats(&buf,&nbuf,msg_,countof(msg_),cdf_,4,&es);
+  decode_u8_u8_stats(&dec,&ndec,buf,nbuf,cdf_,4,&ds);
+  ASSERT_EQ(countof(msg_),ndec);
+  EXPECT_EQ(0,memcmp(msg_,dec,ndec));
+  EXPECT_EQ(0,memcmp(&zero,&es,sizeof(es)));
+  EXPECT_EQ(0,memcmp(&zero,&ds,sizeof(ds)));
+  free(buf);
+  free(dec);
+}
+#endif
+
+///// Wide (u32 output) coder
+
+#ifdef AC_HAVE_U32_OUTPUT
+TEST(WideCoder,SmallProbability)
+{ // symbol 0 has p=2^-28, below the 2^-24 limit of the u8 coder
+  real     cdf[] = {0.0f,1.0f/(1<<28),0.5f,1.0f};
+  uint32_t msg[1000];
+  uint32_t *dec=NULL;
+  void     *buf=NULL;
+  size_t    i,nbuf=0,ndec=0;
+  for(i=0;i<countof(msg);++i)
+    msg[i] = (i%100==7)?0:(1+(i*7919)%2);
+  encode_u32_u32(&buf,&nbuf,msg,countof(msg),cdf,3);
+  EXPECT_EQ(0,nbuf%4);
+  decode_u32_u32(&dec,&ndec,buf,nbuf,cdf,3);
+  ASSERT_EQ(countof(msg),ndec);
+  EXPECT_EQ(0,memcmp(msg,dec,sizeof(msg)));
+  free(buf);
+  free(dec);
+}
+
+#ifdef AC_STATS
+TEST_F(CoderTest,WideRenormsLessOften)
+{ void       *buf=NULL;
+  size_t      nbuf=0;
+  ac_stats_t  s8,s32;
+  encode_u8_u8_stats(&buf,&nbuf,msg_,countof(msg_),cdf_,4,&s8);
+  encode_u32_u8_stats(&buf,&nbuf,msg_,countof(msg_),cdf_,4,&s32);
+  EXPECT_LE(4*s32.nrenorm,s8.nrenorm+8);
+  free(buf);
+}
+#endif
+#endif
+
+///// Batch
+
+// Slices the demo message into messages of 0..40 symbols.
+TEST_F(CoderTest,BatchMatchesSingle)
+{ uint8_t *in[32],*dec=NULL;
+  size_t   nin[32],off[33],doff[33];
+  void    *buf=NULL,*one=NULL;
+  size_t   i,j=0,nbuf=0,ndec=0,none=0;
+  for(i=0;i<countof(in);++i)
+  { in[i]  = msg_+j;
+    nin[i] = (i*37)%41;
+    j     += nin[i];
+  }
+  ASSERT_LE(j,countof(msg_));
+  encode_batch_u8_u8(&buf,&nbuf,off,in,nin,countof(in),cdf_,4);
+  EXPECT_EQ(nbuf,off[countof(in)]);
+  for(i=0;i<countof(in);++i)
+  { encode_u8_u8(&one,&none,in[i],nin[i],cdf_,4);
+    ASSERT_EQ(none,off[i+1]-off[i]);
+    EXPECT_EQ(0,memcmp(one,(uint8_t*)buf+off[i],none));
+  }
+  decode_batch_u8_u8(&dec,&ndec,doff,buf,off,countof(in),cdf_,4);
+  EXPECT_EQ(j,ndec);
+  for(i=0;i<countof(in);++i)
+  { ASSERT_EQ(nin[i],doff[i+1]-doff[i]);
+    EXPECT_EQ(0,memcmp(in[i],dec+doff[i],nin[i]));
+  }
+  free(one);
+  free(buf);
+  free(dec);
+}
+
+TEST_F(CoderTest,BatchU1)
+{ uint8_t  *in[8],*dec=NULL;
+  size_t    nin[8],off[9],doff[9];
+  void     *buf=NULL;
+  size_t    i,nbuf=0,ndec=0;
+  for(i=0;i<countof(in);++i)
+  { in[i]  = msg_+19*i;
+    nin[i] = 3+5*i;
+  }
+  encode_batch_u1_u8(&buf,&nbuf,off,in,nin,countof(in),cdf_,4);
+  decode_batch_u8_u1(&dec,&ndec,doff,buf,off,countof(in),cdf_,4);
+  for(i=0;i<countof(in);++i)
+  { ASSERT_EQ(nin[i],doff[i+1]-doff[i]);
+    EXPECT_EQ(0,memcmp(in[i],dec+doff[i],nin[i]));
+  }
+  free(buf);
+  free(dec);
+}
+
+///// Length-prefixed
+
+TEST_F(CoderTest,LengthPrefixedRoundTrip)
+{ void    *buf=NULL;
+  uint8_t *dec=NULL;
+  size_t   nbuf,ndec,n;
+  for(n=0;n<=countof(msg_);n+=n+1)
+  { nbuf=ndec=0;
+#define CHECK(TOUT) \
+    lencode_##TOUT##_u8(&buf,&nbuf,msg_,n,cdf_,4);   \
+    ldecode_u8_##TOUT(&dec,&ndec,buf,nbuf,cdf_,4);   \
+    ASSERT_EQ(n,ndec) << #TOUT;                      \
+    EXPECT_EQ(0,memcmp(msg_,dec,n)) << #TOUT;        \
+    free(buf); buf=NULL; nbuf=0;                     \
+    free(dec); dec=NULL; ndec=0;
+    CHECK(u1);
+    CHECK(u4);
+    CHECK(u8);
+    CHECK(u16);
+#ifdef AC_HAVE_U32_OUTPUT
+    CHECK(u32);
+#endif
+#undef CHECK
+  }
+}
+
+TEST_F(CoderTest,LengthPrefixedSkipsEnd)
+{ void  *a=NULL,*b=NULL;
+  size_t na=0,nb=0;
+  encode_u1_u8(&a,&na,msg_,countof(msg_),cdf_,4);
+  lencode_u1_u8(&b,&nb,msg_,countof(msg_),cdf_,4);
+  EXPECT_LE(nb,na+1); // END costs about as much as the 2-byte count
+  free(a);
+  free(b);
+}
+
+TEST(LengthPrefixed,CertainSymbolIsFree)
+{ uint8_t  msg[1000],*dec=NULL;
+  real     cdf[] = {0.0f,1.0f};
+  void    *buf=NULL;
+  size_t   nbuf=0,ndec=0;
+  memset(msg,0,sizeof(msg));
+  lencode_u8_u8(&buf,&nbuf,msg,countof(msg),cdf,1);
+  EXPECT_LE(nbuf,4); // count + final digits
+  ldecode_u8_u8(&dec,&ndec,buf,nbuf,cdf,1);
+  ASSERT_EQ(countof(msg),ndec);
+  EXPECT_EQ(0,memcmp(msg,dec,ndec));
+  free(buf);
+  free(dec);
+}
+
+///// Variable output alphabet
+
+TEST_F(CoderTest,VariableAlphabetRoundTrip)
+{ const size_t D[] = {2,10,94,255};
+  size_t k;
+  for(k=0;k<countof(D);++k)
+  { uint8_t *out=NULL,*dec=NULL;
+    size_t   nout=0,ndec=0,i;
+    vencode_u8(&out,&nout,D[k],msg_,countof(msg_),4,cdf_);
+    for(i=0;i<nout;++i)
+      ASSERT_LT(out[i],D[k]);
+    vdecode_u8(&dec,&ndec,4,out,nout,D[k],cdf_);
+    ASSERT_EQ(countof(msg_),ndec) << "D=" << D[k];
+    EXPECT_EQ(0,memcmp(msg_,dec,ndec)) << "D=" << D[k];
+    free(out);
+    free(dec);
+  }
+}
+
+TEST(Adaptive,LargeAlphabetRoundTrip)
+{ const size_t nsym=4096,n=50000;
+  std::vector<uint16_t> msg(n);
+  unsigned x=1;
+  for(size_t i=0;i<n;++i)             // skewed: most symbols from a few
+  { lcg(&x);
+    msg[i] = (uint16_t)(((x>>16)%8)?((x>>20)%16)*7:(x>>12)%nsym);
+  }
+  { void     *buf=NULL;
+    uint16_t *dec=NULL;
+    size_t    nbuf=0,ndec=0;
+    aencode_u8_u16(&buf,&nbuf,msg.data(),n,nsym);
+    EXPECT_LT(nbuf,n);                // well under 12 bits/symbol
+    adecode_u16_u8(&dec,&ndec,buf,nbuf,nsym);
+    ASSERT_EQ(n,ndec);
+    EXPECT_EQ(0,memcmp(msg.data(),dec,n*sizeof(uint16_t)));
+    free(buf);
+    free(dec);
+  }
+  { void     *buf=NULL;
+    uint16_t *dec=NULL;
+    size_t    nbuf=0,ndec=0;
+    aencode_u1_u16(&buf,&nbuf,msg.data(),n,nsym);
+    adecode_u16_u1(&dec,&ndec,buf,nbuf,nsym);
+    ASSERT_EQ(n,ndec);
+    EXPECT_EQ(0,memcmp(msg.data(),dec,n*sizeof(uint16_t)));
+    free(buf);
+    free(dec);
+  }
+}
+
+TEST(Adaptive,FullU16Alphabet)
+{ const size_t nsym=1<<16,n=20000;
+  std::vector<uint16_t> msg(n);
+  unsigned x=7;
+  for(size_t i=0;i<n;++i)
+  { lcg(&x);
+    msg[i] = (uint16_t)(x>>8);
+  }
+  void     *buf=NULL;
+  uint16_t *dec=NULL;
+  size_t    nbuf=0,ndec=0;
+  aencode_u8_u16(&buf,&nbuf,msg.data(),n,nsym);
+  adecode_u16_u8(&dec,&ndec,buf,nbuf,nsym);
+  ASSERT_EQ(n,ndec);
+  EXPECT_EQ(0,memcmp(msg.data(),dec,n*sizeof(uint16_t)));
+  free(buf);
+  free(dec);
+}
+
+TEST(Adaptive,SmallAlphabetU16Output)
+{ const size_t n=10000;
+  std::vector<uint32_t> msg(n);
+  unsigned x=3;
+  for(size_t i=0;i<n;++i)
+  { lcg(&x);
+    msg[i] = ((x>>16)%4)?3:(x>>20)%300;
+  }
+  void     *buf=NULL;
+  uint32_t *dec=NULL;
+  size_t    nbuf=0,ndec=0;
+  aencode_u16_u32(&buf,&nbuf,msg.data(),n,300);
+  adecode_u32_u16(&dec,&ndec,buf,nbuf,300);
+  ASSERT_EQ(n,ndec);
+  EXPECT_EQ(0,memcmp(msg.data(),dec,n*sizeof(uint32_t)));
+  free(buf);
+  free(dec);
+}
+
+TEST(Integers,RoundTrip)
+{ const size_t n=20000;
+  std::vector<uint64_t> msg(n);
+  uint64_t x=88172645463325252ULL;
+  for(size_t i=0;i<n;++i)             // mostly small counters, some wide ids
+  { x^=x<<13; x^=x>>7; x^=x<<17;
+    msg[i] = (x&3)?(x>>8)%40:x;
+  }
+  { void     *buf=NULL;
+    uint64_t *dec=NULL;
+    size_t    nbuf=0,ndec=0;
+    iencode_u8_u64(&buf,&nbuf,msg.data(),n);
+    EXPECT_LT(nbuf,n*3);              // vs 8 bytes/value raw
+    idecode_u64_u8(&dec,&ndec,buf,nbuf);
+    ASSERT_EQ(n,ndec);
+    EXPECT_EQ(0,memcmp(msg.data(),dec,n*sizeof(uint64_t)));
+    free(buf);
+    free(dec);
+  }
+  { std::vector<uint32_t> m32(msg.begin(),msg.end());
+    void     *buf=NULL;
+    uint32_t *dec=NULL;
+    size_t    nbuf=0,ndec=0;
+    iencode_u16_u32(&buf,&nbuf,m32.data(),n);
+    idecode_u32_u16(&dec,&ndec,buf,nbuf);
+    ASSERT_EQ(n,ndec);
+    EXPECT_EQ(0,memcmp(m32.data(),dec,n*sizeof(uint32_t)));
+    free(buf);
+    free(dec);
+  }
+}
+
+TEST(RunLength,SparseRoundTrip)
+{ const size_t n=100000;
+  std::vector<uint8_t> msg(n);
+  real cdf[]={0.0f,0.97f,0.98f,0.99f,1.0f};
+  unsigned x=1;
+  for(size_t i=0;i<n;++i)
+  { lcg(&x);
+    msg[i] = ((x>>16)%100<97)?0:1+(x>>8)%3;
+  }
+  void    *lbuf=NULL,*buf=NULL;
+  uint8_t *dec=NULL;
+  size_t   nl=0,nbuf=0,ndec=0;
+  lencode_u8_u8(&lbuf,&nl,msg.data(),n,cdf,4);
+  rencode_u8_u8(&buf,&nbuf,msg.data(),n,cdf,4);
+  EXPECT_LT(nbuf,nl*11/10);           // about as small as coding every symbol
+  rdecode_u8_u8(&dec,&ndec,buf,nbuf,cdf,4);
+  ASSERT_EQ(n,ndec);
+  EXPECT_EQ(0,memcmp(msg.data(),dec,n));
+  free(lbuf);
+  free(buf);
+  free(dec);
+}
+
+TEST(RunLength,DominantNotFirst)
+{ uint32_t msg[]={2,2,2,2,0,2,2,1,1,2,2,2,2,2,2,2,2,2,0};
+  const size_t n=sizeof(msg)/sizeof(*msg);
+  real cdf[]={0.0f,0.1f,0.2f,1.0f};
+  void     *buf=NULL;
+  uint32_t *dec=NULL;
+  size_t    nbuf=0,ndec=0;
+  rencode_u1_u32(&buf,&nbuf,msg,n,cdf,3);
+  rdecode_u32_u1(&dec,&ndec,buf,nbuf,cdf,3);
+  ASSERT_EQ(n,ndec);
+  EXPECT_EQ(0,memcmp(msg,dec,sizeof(msg)));
+  free(buf);
+  free(dec);
+}
+
+TEST(RunLength,SingleSymbol)
+{ std::vector<uint16_t> msg(5000,0);
+  real cdf[]={0.0f,1.0f};
+  void     *buf=NULL;
+  uint16_t *dec=NULL;
+  size_t    nbuf=0,ndec=0;
+  rencode_u16_u16(&buf,&nbuf,msg.data(),msg.size(),cdf,1);
+  EXPECT_LT(nbuf,16u);
+  rdecode_u16_u16(&dec,&ndec,buf,nbuf,cdf,1);
+  ASSERT_EQ(msg.size(),ndec);
+  EXPECT_EQ(0,memcmp(msg.data(),dec,ndec*sizeof(uint16_t)));
+  free(buf);
+  free(dec);
+}
+
+TEST(Extension,RoundTripAutoK)
+{ const size_t n=30001;               // not a multiple of k
+  std::vector<uint32_t> msg(n);
+  real cdf[]={0.0f,0.85f,0.9f,0.95f,1.0f};
+  unsigned x=1;
+  for(size_t i=0;i<n;++i)
+  { lcg(&x);
+    msg[i] = ((x>>16)%100<85)?0:1+(x>>8)%3;
+  }
+  void     *lbuf=NULL,*buf=NULL;
+  uint32_t *dec=NULL;
+  size_t    nl=0,nbuf=0,ndec=0;
+  lencode_u8_u32(&lbuf,&nl,msg.data(),n,cdf,4);
+  xencode_u8_u32(&buf,&nbuf,msg.data(),n,cdf,4,0);
+  EXPECT_LT(nbuf,nl+8);               // same model, so about the same size
+  xdecode_u32_u8(&dec,&ndec,buf,nbuf,cdf,4);
+  ASSERT_EQ(n,ndec);
+  EXPECT_EQ(0,memcmp(msg.data(),dec,n*sizeof(uint32_t)));
+  free(lbuf);
+  free(buf);
+  free(dec);
+}
+
+TEST(Extension,ExplicitKAndWidths)
+{ uint8_t msg[1000];
+  real cdf[]={0.0f,0.7f,1.0f};
+  unsigned x=3;
+  for(size_t i=0;i<sizeof(msg);++i)
+  { lcg(&x);
+    msg[i] = ((x>>16)%10<7)?0:1;
+  }
+  for(unsigned k=1;k<=12;++k)
+  { void    *buf=NULL;
+    uint8_t *dec=NULL;
+    size_t   nbuf=0,ndec=0;
+    xencode_u1_u8(&buf,&nbuf,msg,sizeof(msg),cdf,2,k);
+    xdecode_u8_u1(&dec,&ndec,buf,nbuf,cdf,2);
+    ASSERT_EQ(sizeof(msg),ndec) << k;
+    EXPECT_EQ(0,memcmp(msg,dec,ndec)) << k;
+    free(buf);
+    free(dec);
+  }
+}
+
+// An explicit k too big for the rare symbol's precision is lowered, not
+// coded with empty intervals.
+TEST(Extension,ExplicitKWithSkewedCdf)
+{ uint8_t msg[2000];
+  real cdf[]={0.0f,0.999f,0.9999f,1.0f};
+  const unsigned ks[]={3,4,5,7};
+  unsigned x=7;
+  for(size_t i=0;i<sizeof(msg);++i)
+  { lcg(&x);
+    msg[i] = ((x>>16)%1000)?0:1+(x>>8)%2;
+  }
+  memset(msg,2,8);                    // the least likely tuple
+  for(size_t j=0;j<countof(ks);++j)
+  { void    *buf=NULL;
+    uint8_t *dec=NULL;
+    size_t   nbuf=0,ndec=0;
+    xencode_u8_u8(&buf,&nbuf,msg,sizeof(msg),cdf,3,ks[j]);
+    xdecode_u8_u8(&dec,&ndec,buf,nbuf,cdf,3);
+    ASSERT_EQ(sizeof(msg),ndec) << ks[j];
+    EXPECT_EQ(0,memcmp(msg,dec,ndec)) << ks[j];
+    free(buf);
+    free(dec);
+  }
+}
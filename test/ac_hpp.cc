@@ -0,0 +1,131 @@
+#include <gtest/gtest.h>
+#include <string.h>
+#include <algorithm>
+#include "ac.h"
+#include "ac.hpp"
+#include "helpers.h"
+
+///// PREP
+
+// templated calls to the C api for comparison
+template<class TOut,class TIn> void c_encode(void **out, size_t *nout, TIn *in, size_t nin, real *cdf, size_t nsym);
+template<class TOut,class TIn> void c_decode(TIn **out, size_t *nout, void *in, size_t nin, real *cdf, size_t nsym);
+#define DEFN_C(tout,ttag,tin,tname) \
+  template<> void c_encode<ttag,tin>(void **out, size_t *nout, tin *in, size_t nin, real *cdf, size_t nsym) \
+  { encode_##tout##_##tname(out,nout,in,nin,cdf,nsym); } \
+  template<> void c_decode<ttag,tin>(tin **out, size_t *nout, void *in, size_t nin, real *cdf, size_t nsym) \
+  { decode_##tname##_##tout(out,nout,in,nin,cdf,nsym); }
+#define DEFN_C_OUTS(tin,tname) \
+  DEFN_C(u1 ,ac::u1  ,tin,tname) \
+  DEFN_C(u4 ,ac::u4  ,tin,tname) \
+  DEFN_C(u8 ,uint8_t ,tin,tname) \
+  DEFN_C(u16,uint16_t,tin,tname)
+DEFN_C_OUTS(uint8_t ,u8)
+DEFN_C_OUTS(uint32_t,u32)
+#ifdef AC_HAVE_U32_OUTPUT
+DEFN_C(u32,uint32_t,uint8_t ,u8)
+DEFN_C(u32,uint32_t,uint32_t,u32)
+#endif
+
+template<class TOut,class TIn> struct Coder { typedef TOut out; typedef TIn in; };
+
+typedef testing::Types<
+  Coder<ac::u1   ,uint8_t>,
+  Coder<ac::u4   ,uint8_t>,
+  Coder<uint8_t  ,uint8_t>,
+  Coder<uint16_t ,uint8_t>,
+  Coder<ac::u1   ,uint32_t>,
+  Coder<ac::u4   ,uint32_t>,
+  Coder<uint8_t  ,uint32_t>,
+  Coder<uint16_t ,uint32_t>
+#ifdef AC_HAVE_U32_OUTPUT
+  ,Coder<uint32_t,uint8_t>
+  ,Coder<uint32_t,uint32_t>
+#endif
+  > CoderTypes;
+
+template<class T> class TemplateCoderTest : public ::testing::Test
+{ protected:
+    virtual void SetUp()
+    { skewed_message(msg_,sizeof(msg_)/sizeof(*msg_));
+      skewed_cdf(cdf_);
+    }
+  typename T::in msg_[5000];
+  real           cdf_[6];
+};
+TYPED_TEST_CASE(TemplateCoderTest,CoderTypes);
+
+///// Tests
+
+TYPED_TEST(TemplateCoderTest,MatchesC)
+{ typedef typename TypeParam::out TOut;
+  typedef typename TypeParam::in  TIn;
+  const size_t n = sizeof(this->msg_)/sizeof(*this->msg_);
+  void  *buf=NULL;
+  size_t nbuf=0;
+  c_encode<TOut,TIn>(&buf,&nbuf,this->msg_,n,this->cdf_,5);
+  std::vector<uint8_t> code = ac::encode<TOut>(this->msg_,n,this->cdf_,5);
+  ASSERT_EQ(nbuf,code.size());
+  EXPECT_EQ(0,memcmp(buf,code.data(),nbuf));
+  free(buf);
+}
+
+TYPED_TEST(TemplateCoderTest,RoundTrip)
+{ typedef typename TypeParam::out TOut;
+  typedef typename TypeParam::in  TIn;
+  const size_t n = sizeof(this->msg_)/sizeof(*this->msg_);
+  std::vector<uint8_t> code = ac::encode<TOut>(this->msg_,n,this->cdf_,5);
+  std::vector<TIn>     msg  = ac::decode<TOut,TIn>(code.data(),code.size(),this->cdf_,5);
+  ASSERT_EQ(n,msg.size());
+  EXPECT_EQ(0,memcmp(this->msg_,msg.data(),n*sizeof(TIn)));
+}
+
+TYPED_TEST(TemplateCoderTest,DecodesC)
+{ typedef typename TypeParam::out TOut;
+  typedef typename TypeParam::in  TIn;
+  const size_t n = sizeof(this->msg_)/sizeof(*this->msg_);
+  void  *buf=NULL;
+  TIn   *dec=NULL;
+  size_t nbuf=0,ndec=0;
+  c_encode<TOut,TIn>(&buf,&nbuf,this->msg_,n,this->cdf_,5);
+  std::vector<TIn> msg = ac::decode<TOut,TIn>(buf,nbuf,this->cdf_,5);
+  ASSERT_EQ(n,msg.size());
+  EXPECT_EQ(0,memcmp(this->msg_,msg.data(),n*sizeof(TIn)));
+  c_decode<TOut,TIn>(&dec,&ndec,buf,nbuf,this->cdf_,5);
+  ASSERT_EQ(n,ndec);
+  EXPECT_EQ(0,memcmp(this->msg_,dec,n*sizeof(TIn)));
+  free(buf);
+  free(dec);
+}
+
+TYPED_TEST(TemplateCoderTest,LazyMatchesDecode)
+{ typedef typename TypeParam::out TOut;
+  typedef typename TypeParam::in  TIn;
+  const size_t n = sizeof(this->msg_)/sizeof(*this->msg_);
+  std::vector<uint8_t> code = ac::encode<TOut>(this->msg_,n,this->cdf_,5);
+  ac::lazy<TOut,TIn> msg(code.data(),code.size(),this->cdf_,5);
+  size_t i=0;
+  for(typename ac::lazy<TOut,TIn>::iterator it=msg.begin();it!=msg.end();++it,++i)
+    ASSERT_EQ(this->msg_[i],*it) << i;
+  EXPECT_EQ(n,i);
+}
+
+TEST(Lazy,StopsEarly)
+{ uint8_t msg[1000]={0};
+  real    cdf[]={0.0f,0.9f,0.95f,1.0f};
+  msg[3]=2;
+  std::vector<uint8_t> code = ac::encode<uint8_t>(msg,1000,cdf,3);
+  ac::lazy<uint8_t,uint8_t> m(code.data(),code.size(),cdf,3);
+  ac::lazy<uint8_t,uint8_t>::iterator it=std::find(m.begin(),m.end(),2);
+  ASSERT_TRUE(it!=m.end());
+  EXPECT_EQ(2,*it);
+  EXPECT_EQ(0,*++it);
+}
+
+TEST(Lazy,EmptyMessage)
+{ uint8_t msg[1]={0};
+  real    cdf[]={0.0f,0.5f,1.0f};
+  std::vector<uint8_t> code = ac::encode<uint8_t>(msg,0,cdf,2);
+  ac::lazy<uint8_t,uint8_t> m(code.data(),code.size(),cdf,2);
+  EXPECT_TRUE(m.begin()==m.end());
+}
@@ -0,0 +1,162 @@
+#include <gtest/gtest.h>
+#include <string.h>
+#include <math.h>
+#include <algorithm>
+#include <vector>
+#include "ac.h"
+#include "helpers.h"
+
+///// PREP
+
+// Blocks of different character: text-like, flat random bytes, one repeated
+// byte, and a heavily skewed source with a long tail of rare symbols.
+class BlockTest : public ::testing::Test
+{ protected:
+    virtual void SetUp()
+    { unsigned x=11;
+      size_t i;
+      for(i=0;i<B;++i)
+      { unsigned r=lcg15(&x)&0xff;
+        msg_.push_back((r<40)?' ':(r<250)?(uint8_t)('a'+r%26):(uint8_t)r);
+      }
+      for(i=0;i<B;++i)
+        msg_.push_back((uint8_t)lcg15(&x));
+      for(i=0;i<B;++i)
+        msg_.push_back('x');
+      for(i=0;i<B+123;++i)  // the last block is short
+        msg_.push_back((lcg15(&x)%1000)?0:(uint8_t)(1+lcg15(&x)%200));
+    }
+  enum {B=1<<14};
+  std::vector<uint8_t> msg_;
+};
+
+///// Tests
+
+TEST_F(BlockTest,RoundTrip)
+{ const double budgets[]={0.0,0.01,0.5};
+  for(size_t j=0;j<3;++j)
+  { void    *buf=NULL;
+    uint8_t *dec=NULL;
+    size_t   nbuf=0,ndec=0;
+    ac_block_encode(&buf,&nbuf,&msg_[0],msg_.size(),B,budgets[j]);
+    EXPECT_EQ(5u,ac_block_configs(buf,nbuf,NULL,0));
+    ac_block_decode(&dec,&ndec,buf,nbuf);
+    ASSERT_EQ(msg_.size(),ndec) << "budget " << budgets[j];
+    EXPECT_EQ(0,memcmp(&msg_[0],dec,ndec)) << "budget " << budgets[j];
+    EXPECT_LT(nbuf,msg_.size()/2);
+    free(buf);
+    free(dec);
+  }
+}
+
+TEST_F(BlockTest,ChoicesFollowTheData)
+{ void  *buf=NULL;
+  size_t nbuf=0;
+  ac_block_config_t c[5];
+  unsigned widest=16;
+#ifdef AC_HAVE_U32_OUTPUT
+  widest=32;
+#endif
+
+  ac_block_encode(&buf,&nbuf,&msg_[0],msg_.size(),B,0.0);
+  ASSERT_EQ(5u,ac_block_configs(buf,nbuf,c,5));
+  EXPECT_EQ(0u,c[1].width);           // random bytes are stored
+  EXPECT_NE(0u,c[2].width);           // a run codes to a few bytes
+  EXPECT_NE(0u,c[3].width);
+
+  ac_block_encode(&buf,&nbuf,&msg_[0],msg_.size(),B,0.5);
+  ASSERT_EQ(5u,ac_block_configs(buf,nbuf,c,5));
+  EXPECT_EQ(0u,c[1].width);
+  EXPECT_EQ(widest,c[0].width);       // with room to spare, the fastest digit
+  EXPECT_EQ(widest,c[3].width);
+  free(buf);
+}
+
+// A long block that is almost all zeros: the cost of the rare symbols'
+// slots in a coarse model outweighs the bigger header of a fine one.
+TEST(Block,FineModelWhenItPays)
+{ std::vector<uint8_t> msg(1<<18,0);
+  void  *buf=NULL;
+  size_t nbuf=0;
+  ac_block_config_t c;
+  unsigned widest=8;                  // u16 models stop at 2^13
+#ifdef AC_HAVE_U32_OUTPUT
+  widest=32;
+#endif
+  for(size_t i=7;i<msg.size();i+=20011)
+    msg[i]=(uint8_t)(1+(i/20011)%10);
+  ac_block_encode(&buf,&nbuf,&msg[0],msg.size(),msg.size(),0.0);
+  ASSERT_EQ(1u,ac_block_configs(buf,nbuf,&c,1));
+  EXPECT_EQ(18u,c.bits);
+  ac_block_encode(&buf,&nbuf,&msg[0],msg.size(),msg.size(),0.5);
+  ASSERT_EQ(1u,ac_block_configs(buf,nbuf,&c,1));
+  EXPECT_EQ(18u,c.bits);
+  EXPECT_EQ(widest,c.width);
+  free(buf);
+}
+
+TEST_F(BlockTest,Empty)
+{ void    *buf=NULL;
+  uint8_t *dec=NULL;
+  size_t   nbuf=0,ndec=0;
+  ac_block_encode(&buf,&nbuf,NULL,0,0,0.01);
+  EXPECT_EQ(0u,ac_block_configs(buf,nbuf,NULL,0));
+  ac_block_decode(&dec,&ndec,buf,nbuf);
+  EXPECT_EQ(0u,ndec);
+  free(buf);
+  free(dec);
+}
+
+// Blocks with the same counts in a different order: after the first one,
+// each model is coded as "no change".
+TEST(Block,RepeatedModelIsNearlyFree)
+{ std::vector<uint8_t> one,many;
+  void  *a=NULL,*b=NULL;
+  size_t na=0,nb=0;
+  unsigned x=5;
+  for(size_t i=0;i<1024;++i)                  // 13 common symbols and 180 rare ones
+    one.push_back((uint8_t)((i%7)?i%13:13+i%180));
+  for(size_t k=0;k<16;++k)
+  { for(size_t i=one.size();i>1;--i)          // shuffle
+      std::swap(one[i-1],one[lcg15(&x)%i]);
+    many.insert(many.end(),one.begin(),one.end());
+  }
+  ac_block_encode(&a,&na,&one[0],one.size(),1024,0.0);
+  ac_block_encode(&b,&nb,&many[0],many.size(),1024,0.0);
+  EXPECT_LT(nb,16*(na-50));                   // the first model is over 50 bytes
+  { uint8_t *dec=NULL;
+    size_t   ndec=0;
+    ac_block_decode(&dec,&ndec,b,nb);
+    ASSERT_EQ(many.size(),ndec);
+    EXPECT_EQ(0,memcmp(&many[0],dec,ndec));
+    free(dec);
+  }
+  free(a);
+  free(b);
+}
+
+// A source whose distribution drifts across the message codes in less than
+// its overall entropy.
+TEST(Block,DriftingSource)
+{ std::vector<uint8_t> msg;
+  double h[256]={0},bits=0.0;
+  void    *buf=NULL;
+  uint8_t *dec=NULL;
+  size_t   nbuf=0,ndec=0;
+  unsigned x=9;
+  for(size_t i=0;i<(1<<18);++i)
+  { const unsigned center=(unsigned)(i>>10); // moves by one every 1024 symbols
+    msg.push_back((uint8_t)(center+lcg15(&x)%8+lcg15(&x)%8));
+    h[msg.back()]++;
+  }
+  for(size_t i=0;i<256;++i)
+    if(h[i])
+      bits-=h[i]*log2(h[i]/msg.size());
+  ac_block_encode(&buf,&nbuf,&msg[0],msg.size(),4096,0.01);
+  EXPECT_LT(8.0*nbuf,0.6*bits);
+  ac_block_decode(&dec,&ndec,buf,nbuf);
+  ASSERT_EQ(msg.size(),ndec);
+  EXPECT_EQ(0,memcmp(&msg[0],dec,ndec));
+  free(buf);
+  free(dec);
+}
@@ -0,0 +1,49 @@
+#include <gtest/gtest.h>
+#include <vector>
+#include "fenwick.h"
+#include "helpers.h"
+
+///// PREP
+
+// Checks prefix() and find() against sums over freq.
+static void check(const fenwick_t *f)
+{ uint64_t c=0;
+  for(size_t s=0;s<f->n;++s)
+  { uint64_t cum;
+    ASSERT_EQ(c,fenwick_prefix(f,s));
+    ASSERT_EQ(s,fenwick_find(f,c,&cum));
+    ASSERT_EQ(c,cum);
+    ASSERT_EQ(s,fenwick_find(f,c+f->freq[s]-1,&cum));
+    c += f->freq[s];
+  }
+  ASSERT_EQ(c,f->total);
+}
+
+///// Tests
+
+TEST(Fenwick,StartsUniform)
+{ fenwick_t f;
+  fenwick_init(&f,1000);
+  EXPECT_EQ(1000u,f.total);
+  check(&f);
+  fenwick_free(&f);
+}
+
+TEST(Fenwick,AddAndHalve)
+{ const size_t ns[]={1,2,3,7,8,100,257};
+  for(size_t k=0;k<sizeof(ns)/sizeof(*ns);++k)
+  { fenwick_t f;
+    unsigned x=1;
+    fenwick_init(&f,ns[k]);
+    for(int i=0;i<2000;++i)
+    { lcg(&x);
+      fenwick_add(&f,(x>>16)%ns[k],(x>>8)&0x3f);
+    }
+    check(&f);
+    fenwick_halve(&f);
+    check(&f);
+    for(size_t s=0;s<f.n;++s)
+      EXPECT_LE(1u,f.freq[s]);
+    fenwick_free(&f);
+  }
+}
@@ -0,0 +1,57 @@
+#pragma once
+// Shared test data.  A header, so the test/*.cc glob doesn't build it alone.
+#include <gtest/gtest.h>
+#include <stddef.h>
+#include <string.h>
+#include "ac.h"
+
+#define countof(e) (sizeof(e)/sizeof(*(e)))
+
+/// One step of the tests' pseudo-random generator (the C library's LCG).  Returns the new state.
+static inline unsigned lcg(unsigned *x)
+{ return *x = *x*1103515245+12345;
+}
+
+/// 15 pseudo-random bits from the high half of the next state.
+static inline unsigned lcg15(unsigned *x)
+{ return (lcg(x)>>16)&0x7fff;
+}
+
+/// Skewed message over 5 symbols, mostly 0, with some long runs to force carries.  Matches skewed_cdf().
+template<class T> void skewed_message(T *msg, size_t n)
+{ unsigned x=1;
+  for(size_t i=0;i<n;++i)
+  { lcg(&x);
+    msg[i] = (T)(((x>>16)%7<4)?0:(x>>20)%5);
+  }
+}
+
+/// A cdf over the 5 symbols of skewed_message().
+static inline void skewed_cdf(real cdf[6])
+{ const real c[] = {0.0f,0.55f,0.65f,0.8f,0.9f,1.0f};
+  memcpy(cdf,c,sizeof(c));
+}
+
+/// Fixture with a skewed_message() of 10000 u8 symbols and its cdf.  Shared by the entropy coder backends.
+class SkewedTest : public ::testing::Test
+{ protected:
+    virtual void SetUp()
+    { skewed_message(msg_,countof(msg_));
+      skewed_cdf(cdf_);
+    }
+  uint8_t msg_[10000];
+  real    cdf_[6];
+};
+
+/// The demo message from app/test.c, repeated to fill \a n: runs of 0 with a few other symbols.  Matches pattern_cdf().
+static inline void pattern_message(uint8_t *msg, size_t n)
+{ static const uint8_t pattern[] = {2,1,0,0,0,0,0,0,0,0,0,0,3,3,2,3,2,1,0};
+  for(size_t i=0;i<n;++i)
+    msg[i] = pattern[i%countof(pattern)];
+}
+
+/// The symbol frequencies of pattern_message() as a cdf over its 4 symbols.
+static inline void pattern_cdf(real cdf[5])
+{ const real c[] = {0.0,11/19.0, 13/19.0, 16/19.0, 1.0};
+  memcpy(cdf,c,sizeof(c));
+}
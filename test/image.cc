@@ -0,0 +1,77 @@
+#include <gtest/gtest.h>
+#include <math.h>
+#include <string.h>
+#include <vector>
+#include "ac.h"
+#include "helpers.h"
+
+///// PREP
+
+// Smooth blobs plus a little noise.  Rows have padding past the image width.
+class ImageTest : public ::testing::TestWithParam<ac_width_t>
+{ protected:
+    enum { W=200, H=150, STRIDE=208 };
+    virtual void SetUp()
+    { unsigned x=1;
+      img_.assign(STRIDE*H,0xffff);         // padding is 0xffff
+      for(size_t r=0;r<H;++r)
+        for(size_t c=0;c<W;++c)
+        { lcg(&x);
+          img_[r*STRIDE+c] = (uint16_t)(1000+800*sin(r*0.05)*cos(c*0.07)+((x>>16)%8));
+        }
+    }
+  std::vector<uint16_t> img_;
+};
+
+///// Tests
+
+TEST_P(ImageTest,RoundTrip)
+{ void  *buf=NULL;
+  size_t nbuf=0,w,h;
+  std::vector<uint16_t> dec(STRIDE*H,0);
+  ac_image_encode(GetParam(),&buf,&nbuf,&img_[0],W,H,STRIDE,1);
+  EXPECT_LT(nbuf,W*H*3/4);                   // under 6 bits/pixel; the noise alone is 3
+  ac_image_size(buf,nbuf,&w,&h);
+  ASSERT_EQ((size_t)W,w);
+  ASSERT_EQ((size_t)H,h);
+  ac_image_decode(GetParam(),&dec[0],W,H,STRIDE,buf,nbuf,1);
+  for(size_t r=0;r<H;++r)
+  { ASSERT_EQ(0,memcmp(&img_[r*STRIDE],&dec[r*STRIDE],W*sizeof(uint16_t))) << r;
+    ASSERT_EQ(0,dec[r*STRIDE+W]) << r;       // padding untouched
+  }
+  free(buf);
+}
+
+INSTANTIATE_TEST_CASE_P(Widths,ImageTest,::testing::Values(AC_u1,AC_u4,AC_u8,AC_u16
+#ifdef AC_HAVE_U32_OUTPUT
+  ,AC_u32
+#endif
+  ));
+
+TEST_F(ImageTest,ThreadsGiveSameStream)
+{ void  *a=NULL,*b=NULL;
+  size_t na=0,nb=0;
+  std::vector<uint16_t> dec(STRIDE*H,0);
+  ac_image_encode(AC_u8,&a,&na,&img_[0],W,H,STRIDE,1);
+  ac_image_encode(AC_u8,&b,&nb,&img_[0],W,H,STRIDE,3);
+  ASSERT_EQ(na,nb);
+  EXPECT_EQ(0,memcmp(a,b,na));
+  ac_image_decode(AC_u8,&dec[0],W,H,STRIDE,b,nb,3);
+  for(size_t r=0;r<H;++r)
+    ASSERT_EQ(0,memcmp(&img_[r*STRIDE],&dec[r*STRIDE],W*sizeof(uint16_t))) << r;
+  free(a);
+  free(b);
+}
+
+TEST(Image,Extremes)
+{ uint16_t img[3*5]={0,0xffff,0,0xffff,0,
+                     0xffff,0,0xffff,0,0xffff,
+                     1,2,3,0xfffe,0x8000};
+  uint16_t dec[3*5];
+  void  *buf=NULL;
+  size_t nbuf=0;
+  ac_image_encode(AC_u16,&buf,&nbuf,img,5,3,5,1);
+  ac_image_decode(AC_u16,dec,5,3,5,buf,nbuf,1);
+  EXPECT_EQ(0,memcmp(img,dec,sizeof(img)));
+  free(buf);
+}
@@ -0,0 +1,112 @@
+#include <gtest/gtest.h>
+#include <math.h>
+#include <string.h>
+#include <vector>
+#include "ac.h"
+#include "param.h"
+#include "helpers.h"
+
+///// PREP
+
+// Geometric magnitudes with mean ~8, like zigzagged residuals, over a 16-bit
+// alphabet.
+class ParamTest : public ::testing::TestWithParam<ac_width_t>
+{ protected:
+    virtual void SetUp()
+    { unsigned x=1;
+      msg_.resize(20000);
+      for(size_t i=0;i<msg_.size();++i)
+      { lcg(&x);
+        double u=((x>>8)+0.5)/16777216.0;       // (0,1)
+        msg_[i] = (uint16_t)(-8.0*log(u));      // geometric, mean ~8
+      }
+    }
+  std::vector<uint16_t> msg_;
+};
+
+///// Tests
+
+TEST(Param,CdfIsMonotoneAndQuantileInverts)
+{ const ac_param_kind_t kinds[]={AC_PARAM_GEOMETRIC,AC_PARAM_LAPLACE,AC_PARAM_GAUSSIAN};
+  for(size_t j=0;j<3;++j)
+  { ac_param_t m;
+    ac_param_init(&m,kinds[j],300,20.0,6.0);
+    EXPECT_EQ(0.0,ac_param_cdf(&m,0));
+    EXPECT_EQ(1.0,ac_param_cdf(&m,300));
+    for(size_t k=0;k<300;++k)
+    { double a=ac_param_cdf(&m,k),b=ac_param_cdf(&m,k+1);
+      ASSERT_LE(a,b) << j << " " << k;
+      if(b-a>1e-6)                              // guesses are close where there's mass
+      { size_t q=ac_param_quantile(&m,0.5*(a+b));
+        EXPECT_LE((q>k)?q-k:k-q,1u) << j << " " << k;
+      }
+    }
+  }
+}
+
+// The counts come from integer arithmetic, so they are pinned: a stream
+// coded anywhere decodes anywhere.
+TEST(Param,CountsArePortable)
+{ const ac_param_kind_t kinds[]={AC_PARAM_GEOMETRIC,AC_PARAM_LAPLACE,AC_PARAM_GAUSSIAN};
+  const uint64_t expect[3][3]={{576922124,2730346158,3667455338},
+                               {45835344,2181567023,4201153452},
+                               {6175333,2202751136,4291424941}};
+  for(size_t j=0;j<3;++j)
+  { ac_param_t m;
+    ac_param_init(&m,kinds[j],300,20.3,6.1);
+    EXPECT_EQ(expect[j][0],ac_param_cum(&m,3))  << j;
+    EXPECT_EQ(expect[j][1],ac_param_cum(&m,21)) << j;
+    EXPECT_EQ(expect[j][2],ac_param_cum(&m,40)) << j;
+  }
+}
+
+TEST(Param,FarMeanFallsBackToUniform)
+{ ac_param_t m;
+  ac_param_init(&m,AC_PARAM_GAUSSIAN,10,1e6,1.0);
+  EXPECT_DOUBLE_EQ(0.5,ac_param_cdf(&m,5));
+}
+
+TEST_P(ParamTest,RoundTrip)
+{ const ac_param_kind_t kinds[]={AC_PARAM_GEOMETRIC,AC_PARAM_LAPLACE,AC_PARAM_GAUSSIAN};
+  for(size_t j=0;j<3;++j)
+  { ac_param_t m;
+    ac_encoder_t *e;
+    ac_decoder_t *d;
+    void  *buf=NULL;
+    size_t i,nbuf=0;
+    ac_param_init(&m,kinds[j],(GetParam()==AC_u16)?16384:65536,8.0,8.0);
+    e=ac_encoder_open(GetParam(),NULL,0);
+    for(i=0;i<msg_.size();++i)
+      ac_encode_param(e,&m,msg_[i]);
+    ac_encoder_close(e,&buf,&nbuf);
+    d=ac_decoder_open(GetParam(),NULL,0,buf,nbuf);
+    for(i=0;i<msg_.size();++i)
+      ASSERT_EQ(msg_[i],ac_decode_param(d,&m)) << j << " " << i;
+    ac_decoder_close(d);
+    free(buf);
+  }
+}
+
+INSTANTIATE_TEST_CASE_P(Widths,ParamTest,::testing::Values(AC_u1,AC_u4,AC_u8,AC_u16
+#ifdef AC_HAVE_U32_OUTPUT
+  ,AC_u32
+#endif
+  ));
+
+TEST_F(ParamTest,NearTheEntropy)
+{ ac_param_t m;
+  void     *buf=NULL;
+  uint16_t *dec=NULL;
+  size_t    nbuf=0,ndec=0;
+  double    ideal=0.0;
+  ac_param_init(&m,AC_PARAM_GEOMETRIC,65536,8.0,0.0);
+  for(size_t i=0;i<msg_.size();++i)
+    ideal-=log2(ac_param_cdf(&m,msg_[i]+1)-ac_param_cdf(&m,msg_[i]));
+  mencode_u8_u16(&buf,&nbuf,msg_.data(),msg_.size(),&m);
+  EXPECT_LT(8.0*nbuf,ideal*1.01+64);
+  mdecode_u16_u8(&dec,&ndec,buf,nbuf,&m);
+  ASSERT_EQ(msg_.size(),ndec);
+  EXPECT_EQ(0,memcmp(msg_.data(),dec,ndec*sizeof(uint16_t)));
+  free(buf);
+  free(dec);
+}
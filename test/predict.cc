@@ -0,0 +1,94 @@
+#include <gtest/gtest.h>
+#include <math.h>
+#include <string.h>
+#include <vector>
+#include "ac.h"
+#include "predict.h"
+#include "helpers.h"
+
+///// PREP
+
+// Smooth series: a slow sine plus a little noise, around the u16 midpoint.
+class PredictTest : public ::testing::Test
+{ protected:
+    virtual void SetUp()
+    { unsigned x=1;
+      msg_.resize(20000);
+      for(size_t i=0;i<msg_.size();++i)
+      { lcg(&x);
+        msg_[i] = (uint16_t)(32768+20000*sin(i*0.001)+((x>>16)%9)-4);
+      }
+    }
+  std::vector<uint16_t> msg_;
+};
+
+///// Tests
+
+TEST(Predict,RoundTripsAllTransforms)
+{ const uint32_t in[]={0,0xffffffffu,1,0x80000000u,0x7fffffffu,5,5,6,0,3};
+  const size_t   n=sizeof(in)/sizeof(*in);
+  for(int p=AC_PRED_NONE;p<AC_PRED_COUNT;++p)
+  { uint32_t r[n],o[n];
+    predict_u32(r,in,n,(ac_pred_t)p);
+    unpredict_u32(o,r,n,(ac_pred_t)p);
+    EXPECT_EQ(0,memcmp(in,o,sizeof(in))) << p;
+    memcpy(o,r,sizeof(r));              // in place
+    unpredict_u32(o,o,n,(ac_pred_t)p);
+    EXPECT_EQ(0,memcmp(in,o,sizeof(in))) << p;
+  }
+}
+
+TEST(Predict,Zigzag)
+{ const uint16_t in[]={10,9,11,7};
+  uint16_t r[4];
+  predict_u16(r,in,4,AC_PRED_DELTA);
+  EXPECT_EQ(20,r[0]);
+  EXPECT_EQ(1,r[1]);                    // -1
+  EXPECT_EQ(4,r[2]);                    // +2
+  EXPECT_EQ(7,r[3]);                    // -4
+}
+
+TEST_F(PredictTest,ChoosesAPredictor)
+{ EXPECT_NE(AC_PRED_NONE,predict_choose_u16(msg_.data(),msg_.size()));
+  std::vector<uint16_t> ramp(1000),walk(1000);
+  unsigned x=7;
+  ramp[0]=walk[0]=100;
+  for(size_t i=1;i<ramp.size();++i)
+  { lcg(&x);
+    ramp[i] = (uint16_t)(ramp[i-1]+37);
+    walk[i] = (uint16_t)(walk[i-1]+((x>>16)%64)-32);
+  }
+  EXPECT_EQ(AC_PRED_DELTA2,predict_choose_u16(ramp.data(),ramp.size()));
+  EXPECT_EQ(AC_PRED_DELTA ,predict_choose_u16(walk.data(),walk.size()));
+}
+
+TEST_F(PredictTest,CodesSmallerThanRaw)
+{ void     *raw=NULL,*buf=NULL;
+  uint16_t *dec=NULL;
+  size_t    nraw=0,nbuf=0,ndec=0;
+  std::vector<uint32_t> m32(msg_.begin(),msg_.end());
+  iencode_u8_u32(&raw,&nraw,m32.data(),m32.size());
+  pencode_u8_u16(&buf,&nbuf,msg_.data(),msg_.size(),AC_PRED_AUTO);
+  EXPECT_LT(2*nbuf,nraw);
+  pdecode_u16_u8(&dec,&ndec,buf,nbuf);
+  ASSERT_EQ(msg_.size(),ndec);
+  EXPECT_EQ(0,memcmp(msg_.data(),dec,ndec*sizeof(uint16_t)));
+  free(raw);
+  free(buf);
+  free(dec);
+}
+
+TEST_F(PredictTest,FixedModes)
+{ std::vector<uint32_t> m32(msg_.begin(),msg_.end());
+  for(int p=AC_PRED_NONE;p<AC_PRED_COUNT;++p)
+  { void     *buf=NULL;
+    uint32_t *dec=NULL;
+    size_t    nbuf=0,ndec=0;
+    pencode_u1_u32(&buf,&nbuf,m32.data(),m32.size(),(ac_pred_t)p);
+    pdecode_u32_u1(&dec,&ndec,buf,nbuf);
+    ASSERT_EQ(m32.size(),ndec) << p;
+    EXPECT_EQ(0,memcmp(m32.data(),dec,ndec*sizeof(uint32_t))) << p;
+    free(buf);
+    free(dec);
+  }
+}
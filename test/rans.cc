@@ -0,0 +1,83 @@
+#include <gtest/gtest.h>
+#include <math.h>
+#include <string.h>
+#include "rans.h"
+#include "helpers.h"
+
+///// PREP
+
+class RansTest : public SkewedTest {};
+
+///// Round trips
+
+TEST_F(RansTest,RoundTripU8)
+{ void    *buf=NULL;
+  uint8_t *dec=NULL;
+  size_t   nbuf=0,ndec=0;
+  rans_encode_u8_u8(&buf,&nbuf,msg_,countof(msg_),cdf_,5);
+  rans_decode_u8_u8(&dec,&ndec,buf,nbuf,cdf_,5);
+  ASSERT_EQ(countof(msg_),ndec);
+  EXPECT_EQ(0,memcmp(msg_,dec,ndec));
+  free(buf);
+  free(dec);
+}
+
+TEST_F(RansTest,RoundTripU32)
+{ uint32_t  in[countof(msg_)];
+  uint32_t *dec=NULL;
+  void     *buf=NULL;
+  size_t    i,nbuf=0,ndec=0;
+  for(i=0;i<countof(in);++i)
+    in[i]=msg_[i];
+  rans_encode_u8_u32(&buf,&nbuf,in,countof(in),cdf_,5);
+  rans_decode_u32_u8(&dec,&ndec,buf,nbuf,cdf_,5);
+  ASSERT_EQ(countof(in),ndec);
+  EXPECT_EQ(0,memcmp(in,dec,sizeof(in)));
+  free(buf);
+  free(dec);
+}
+
+TEST_F(RansTest,NearEntropy)
+{ void  *buf=NULL;
+  size_t i,nbuf=0;
+  double h=0.0;
+  for(i=0;i<5;++i)
+  { double p=cdf_[i+1]-cdf_[i];
+    h-=p*log2(p);
+  }
+  rans_encode_u8_u8(&buf,&nbuf,msg_,countof(msg_),cdf_,5);
+  EXPECT_LT(8.0*nbuf,1.02*h*countof(msg_)+64);
+  free(buf);
+}
+
+TEST(Rans,Empty)
+{ real     cdf[] = {0.0f,0.5f,1.0f};
+  void    *buf=NULL;
+  uint8_t *dec=NULL;
+  size_t   nbuf=0,ndec=0;
+  rans_encode_u8_u8(&buf,&nbuf,NULL,0,cdf,2);
+  EXPECT_EQ(5,nbuf); // 1 byte count + 4 byte state
+  rans_decode_u8_u8(&dec,&ndec,buf,nbuf,cdf,2);
+  EXPECT_EQ(0,ndec);
+  free(buf);
+  free(dec);
+}
+
+TEST(Rans,LargeAlphabet)
+{ const size_t nsym=4000;
+  real     *cdf=(real*)malloc(sizeof(real)*(nsym+1));
+  uint16_t  in[20000],*dec=NULL;
+  void     *buf=NULL;
+  size_t    i,nbuf=0,ndec=0;
+  for(i=0;i<=nsym;++i)
+    cdf[i]=i/(real)nsym;
+  for(i=0;i<countof(in);++i)
+    in[i]=(uint16_t)((i*7919)%nsym);
+  rans_encode_u8_u16(&buf,&nbuf,in,countof(in),cdf,nsym);
+  rans_decode_u16_u8(&dec,&ndec,buf,nbuf,cdf,nsym);
+  ASSERT_EQ(countof(in),ndec);
+  EXPECT_EQ(0,memcmp(in,dec,sizeof(in)));
+  free(buf);
+  free(dec);
+  free(cdf);
+}
@@ -0,0 +1,176 @@
+#include <gtest/gtest.h>
+#include <string.h>
+#include <vector>
+#include "ac.h"
+#include "test_model.h" // generated by mkmodel from README.md, see CMakeLists.txt
+#include "helpers.h"
+
+///// PREP
+
+// Text-like bytes: mostly lower case and spaces, with the odd symbol the
+// samples may never have seen.
+class StaticTest : public ::testing::Test
+{ protected:
+    virtual void SetUp()
+    { unsigned x=7;
+      msg_.resize(30000);
+      for(size_t i=0;i<msg_.size();++i)
+      { lcg(&x);
+        unsigned r=(x>>16)&0xff;
+        msg_[i] = (r<40)?' ':(r<250)?(uint8_t)('a'+r%26):(uint8_t)r;
+      }
+    }
+  std::vector<uint8_t> msg_;
+};
+
+///// Tests
+
+TEST_F(StaticTest,GeneratedModelMatchesGenericCoder)
+{ void    *a=NULL,*b=NULL;
+  uint8_t *dec=NULL;
+  size_t   na=0,nb=0,ndec=0;
+  real     cdf[257];
+  memcpy(cdf,test_model_cdf,sizeof(cdf));
+  encode_u8_u8(&a,&na,&msg_[0],msg_.size(),cdf,256);
+  sencode_u8_u8(&b,&nb,&msg_[0],msg_.size(),&test_model_u8);
+  ASSERT_EQ(na,nb);
+  EXPECT_EQ(0,memcmp(a,b,na));
+  sdecode_u8_u8(&dec,&ndec,b,nb,&test_model_u8);
+  ASSERT_EQ(msg_.size(),ndec);
+  EXPECT_EQ(0,memcmp(&msg_[0],dec,ndec));
+  free(a);
+  free(b);
+  free(dec);
+}
+
+TEST_F(StaticTest,GeneratedWidthsRoundTrip)
+{ const ac_static_model_t *ms[]={&test_model_u1,&test_model_u16};
+  for(size_t j=0;j<2;++j)
+  { void     *buf=NULL;
+    uint16_t *dec=NULL;
+    size_t    nbuf=0,ndec=0;
+    if(ms[j]->width==1)
+    { sencode_u1_u8(&buf,&nbuf,&msg_[0],msg_.size(),ms[j]);
+      sdecode_u16_u1(&dec,&ndec,buf,nbuf,ms[j]);
+    } else
+    { sencode_u16_u8(&buf,&nbuf,&msg_[0],msg_.size(),ms[j]);
+      sdecode_u16_u16(&dec,&ndec,buf,nbuf,ms[j]);
+    }
+    ASSERT_EQ(msg_.size(),ndec);
+    for(size_t i=0;i<ndec;++i)
+      ASSERT_EQ(msg_[i],dec[i]) << "width " << ms[j]->width << " at " << i;
+    free(buf);
+    free(dec);
+  }
+}
+
+// Run-time built models decode the generic coder's output.
+TEST_F(StaticTest,BuiltModelDecodesGenericStream)
+{ real cdf[257];
+  memcpy(cdf,test_model_cdf,sizeof(cdf));
+  const unsigned widths[]={1,4,8,16
+#ifdef AC_HAVE_U32_OUTPUT
+    ,32
+#endif
+  };
+  for(size_t j=0;j<sizeof(widths)/sizeof(*widths);++j)
+  { ac_static_model_t m;
+    void    *buf=NULL;
+    uint8_t *dec=NULL;
+    size_t   nbuf=0,ndec=0;
+    ac_static_model_build(&m,widths[j],cdf,256);
+    switch(widths[j])
+    { case 1:  encode_u1_u8 (&buf,&nbuf,&msg_[0],msg_.size(),cdf,256); sdecode_u8_u1 (&dec,&ndec,buf,nbuf,&m); break;
+      case 4:  encode_u4_u8 (&buf,&nbuf,&msg_[0],msg_.size(),cdf,256); sdecode_u8_u4 (&dec,&ndec,buf,nbuf,&m); break;
+      case 8:  encode_u8_u8 (&buf,&nbuf,&msg_[0],msg_.size(),cdf,256); sdecode_u8_u8 (&dec,&ndec,buf,nbuf,&m); break;
+      case 16: encode_u16_u8(&buf,&nbuf,&msg_[0],msg_.size(),cdf,256); sdecode_u8_u16(&dec,&ndec,buf,nbuf,&m); break;
+#ifdef AC_HAVE_U32_OUTPUT
+      case 32: encode_u32_u8(&buf,&nbuf,&msg_[0],msg_.size(),cdf,256); sdecode_u8_u32(&dec,&ndec,buf,nbuf,&m); break;
+#endif
+    }
+    ASSERT_EQ(msg_.size(),ndec) << "width " << widths[j];
+    EXPECT_EQ(0,memcmp(&msg_[0],dec,ndec)) << "width " << widths[j];
+    ac_static_model_free(&m);
+    free(buf);
+    free(dec);
+  }
+}
+
+TEST_F(StaticTest,DecodesWithoutGuide)
+{ ac_static_model_t m=test_model_u8;
+  void    *buf=NULL;
+  uint8_t *dec=NULL;
+  size_t   nbuf=0,ndec=0;
+  m.guide=NULL;
+  sencode_u8_u8(&buf,&nbuf,&msg_[0],msg_.size(),&m);
+  sdecode_u8_u8(&dec,&ndec,buf,nbuf,&m);
+  ASSERT_EQ(msg_.size(),ndec);
+  EXPECT_EQ(0,memcmp(&msg_[0],dec,ndec));
+  free(buf);
+  free(dec);
+}
+
+///// Model switching
+
+// Records of a tag (0..2) and a payload whose distribution depends on the tag.
+// A two state machine: even positions are tags, odd ones payloads.
+static size_t field_model(void *ctx, size_t i, uint64_t prev)
+{ (void)ctx;
+  if((i&1)==0)
+    return 0;             // tag
+  return 1+(size_t)prev;  // payload, by the tag just coded
+}
+
+TEST(Switching,CallbackAndIndexRoundTrip)
+{ real tags[]={0.0f,0.7f,0.9f,1.0f},
+       p0[]  ={0.0f,0.9f,0.95f,0.97f,1.0f},
+       p1[]  ={0.0f,0.02f,0.04f,0.5f,1.0f},
+       p2[]  ={0.0f,0.25f,0.5f,0.75f,1.0f};
+  real  *cdfs[]={tags,p0,p1,p2};
+  size_t nsyms[]={3,4,4,4};
+  const unsigned widths[]={8,16};
+  std::vector<uint8_t> msg,which;
+  unsigned x=3;
+  for(size_t i=0;i<4000;++i)
+  { lcg(&x);
+    unsigned r=(x>>16)%100;
+    uint8_t  t=(r<70)?0:(r<90)?1:2;
+    lcg(&x);
+    r=(x>>16)%100;
+    msg.push_back(t);
+    which.push_back(0);
+    msg.push_back(t==0?(r<90?0:3):t==1?(r<50?3:2):(uint8_t)(r%4));
+    which.push_back(1+t);
+  }
+  for(size_t w=0;w<2;++w)
+  { ac_static_model_t m[4];
+    const ac_static_model_t *ms[4];
+    for(size_t k=0;k<4;++k)
+    { ac_static_model_build(m+k,widths[w],cdfs[k],nsyms[k]);
+      ms[k]=m+k;
+    }
+    { void    *buf=NULL,*buf2=NULL;
+      uint8_t *dec=NULL;
+      size_t   nbuf=0,nbuf2=0,ndec=0;
+      if(widths[w]==8)
+      { kencode_u8_u8(&buf,&nbuf,&msg[0],msg.size(),ms,4,NULL,field_model,NULL);
+        kencode_u8_u8(&buf2,&nbuf2,&msg[0],msg.size(),ms,4,&which[0],NULL,NULL);
+        kdecode_u8_u8(&dec,&ndec,buf,nbuf,ms,4,NULL,field_model,NULL);
+      } else
+      { kencode_u16_u8(&buf,&nbuf,&msg[0],msg.size(),ms,4,NULL,field_model,NULL);
+        kencode_u16_u8(&buf2,&nbuf2,&msg[0],msg.size(),ms,4,&which[0],NULL,NULL);
+        kdecode_u8_u16(&dec,&ndec,buf,nbuf,ms,4,&which[0],NULL,NULL);
+      }
+      ASSERT_EQ(nbuf,nbuf2);                        // same choices, same stream
+      EXPECT_EQ(0,memcmp(buf,buf2,nbuf));
+      ASSERT_EQ(msg.size(),ndec);
+      EXPECT_EQ(0,memcmp(&msg[0],dec,ndec)) << "width " << widths[w];
+      EXPECT_LT(8*nbuf,3*msg.size()/2);             // under 3 bits a record
+      free(buf);
+      free(buf2);
+      free(dec);
+    }
+    for(size_t k=0;k<4;++k)
+      ac_static_model_free(m+k);
+  }
+}
@@ -0,0 +1,185 @@
+#include <gtest/gtest.h>
+#include <string.h>
+#include <math.h>
+#include <vector>
+#include "ac.h"
+#include "helpers.h"
+
+///// PREP
+
+// Records of a modeled tag followed by a raw field of tag*16 bits.
+class StepwiseTest : public ::testing::TestWithParam<ac_width_t>
+{ protected:
+    virtual void SetUp()
+    { uint64_t x=88172645463325252ULL;
+      size_t i;
+      for(i=0;i<countof(tag_);++i)
+      { x^=x<<13; x^=x>>7; x^=x<<17;           // xorshift64
+        tag_[i] = (x&7)<5?0:(x>>3)%5;
+        raw_[i] = tag_[i]?(x>>(64-16*tag_[i])):0;
+      }
+      real c[] = {0.0f,0.6f,0.7f,0.8f,0.9f,1.0f};
+      memcpy(cdf_,c,sizeof(c));
+    }
+  uint8_t  tag_[2000];
+  uint64_t raw_[2000];
+  real     cdf_[6];
+};
+
+///// Tests
+
+TEST_P(StepwiseTest,MixedSymbolsAndBits)
+{ ac_encoder_t *e;
+  ac_decoder_t *d;
+  void   *buf=NULL;
+  size_t  i,nbuf=0,nraw=0;
+  e=ac_encoder_open(GetParam(),cdf_,5);
+  for(i=0;i<countof(tag_);++i)
+  { ac_encode_symbol(e,tag_[i]);
+    ac_encode_bits(e,raw_[i],16*tag_[i]);
+    nraw+=16*tag_[i];
+  }
+  ac_encoder_close(e,&buf,&nbuf);
+  // raw bits cost about one bit each
+  EXPECT_LT(8*nbuf,nraw+2*countof(tag_)+64);
+
+  d=ac_decoder_open(GetParam(),cdf_,5,buf,nbuf);
+  for(i=0;i<countof(tag_);++i)
+  { uint64_t t=ac_decode_symbol(d);
+    ASSERT_EQ(tag_[i],t) << i;
+    ASSERT_EQ(raw_[i],ac_decode_bits(d,16*tag_[i])) << i;
+  }
+  ac_decoder_close(d);
+  free(buf);
+}
+
+INSTANTIATE_TEST_CASE_P(Widths,StepwiseTest,::testing::Values(AC_u1,AC_u4,AC_u8,AC_u16
+#ifdef AC_HAVE_U32_OUTPUT
+  ,AC_u32
+#endif
+  ));
+
+TEST(Stepwise,BitsOnly)
+{ ac_encoder_t *e;
+  ac_decoder_t *d;
+  real    cdf[]={0.0f,1.0f};
+  void   *buf=NULL;
+  size_t  nbuf=0;
+  e=ac_encoder_open(AC_u8,cdf,1);
+  ac_encode_bits(e,1,1);
+  ac_encode_bits(e,0xdeadbeefcafef00dULL,64);
+  ac_encode_bits(e,5,3);
+  ac_encoder_close(e,&buf,&nbuf);
+  EXPECT_LE(nbuf,11);
+  d=ac_decoder_open(AC_u8,cdf,1,buf,nbuf);
+  EXPECT_EQ(1u,ac_decode_bits(d,1));
+  EXPECT_EQ(0xdeadbeefcafef00dULL,ac_decode_bits(d,64));
+  EXPECT_EQ(5u,ac_decode_bits(d,3));
+  ac_decoder_close(d);
+  free(buf);
+}
+
+TEST_P(StepwiseTest,Uniform)
+{ ac_encoder_t *e;
+  ac_decoder_t *d;
+  void   *buf=NULL;
+  size_t  i,nbuf=0;
+  double  ideal=0.0;
+  e=ac_encoder_open(GetParam(),cdf_,5);
+  for(i=0;i<countof(raw_);++i)
+  { uint64_t m=1+(raw_[i]^i)%65535;   // 1..65535
+    ac_encode_uniform(e,i%m,m);
+    ideal+=log2((double)m);
+  }
+  ac_encoder_close(e,&buf,&nbuf);
+  EXPECT_LT(8*nbuf,ideal+64);
+  d=ac_decoder_open(GetParam(),cdf_,5,buf,nbuf);
+  for(i=0;i<countof(raw_);++i)
+  { uint64_t m=1+(raw_[i]^i)%65535;
+    ASSERT_EQ(i%m,ac_decode_uniform(d,m)) << i;
+  }
+  ac_decoder_close(d);
+  free(buf);
+}
+
+TEST_P(StepwiseTest,Uint)
+{ ac_encoder_t   *e;
+  ac_decoder_t   *d;
+  ac_uint_model_t mtag,mraw;
+  void   *buf=NULL;
+  size_t  i,nbuf=0;
+  const uint64_t edge[]={0,1,2,3,0xffffffffULL,0x100000000ULL,~0ULL};
+  ac_uint_model_init(&mtag);
+  ac_uint_model_init(&mraw);
+  e=ac_encoder_open(GetParam(),cdf_,5);
+  for(i=0;i<countof(tag_);++i)
+  { ac_encode_uint(e,&mtag,tag_[i]);
+    ac_encode_uint(e,&mraw,raw_[i]);
+  }
+  for(i=0;i<countof(edge);++i)
+    ac_encode_uint(e,&mraw,edge[i]);
+  ac_encoder_close(e,&buf,&nbuf);
+
+  ac_uint_model_init(&mtag);
+  ac_uint_model_init(&mraw);
+  d=ac_decoder_open(GetParam(),cdf_,5,buf,nbuf);
+  for(i=0;i<countof(tag_);++i)
+  { ASSERT_EQ(tag_[i],ac_decode_uint(d,&mtag)) << i;
+    ASSERT_EQ(raw_[i],ac_decode_uint(d,&mraw)) << i;
+  }
+  for(i=0;i<countof(edge);++i)
+    ASSERT_EQ(edge[i],ac_decode_uint(d,&mraw)) << i;
+  ac_decoder_close(d);
+  free(buf);
+}
+
+// Flushed prefixes decode on their own, the decoder resyncs, and adaptive models carry across.
+TEST_P(StepwiseTest,SyncFlush)
+{ const size_t nseg=5,per=countof(tag_)/nseg;
+  ac_encoder_t   *e;
+  ac_decoder_t   *d;
+  ac_uint_model_t me,md,at3;
+  size_t          off[nseg+1]={0},i,j,nbuf=0;
+  void           *buf=NULL;
+  const void     *p;
+  std::vector<uint8_t> sent;  // what a peer has received so far
+  ac_uint_model_init(&me);
+  ac_uint_model_init(&md);
+  e=ac_encoder_open(GetParam(),cdf_,5);
+  for(j=0;j<nseg;++j)
+  { if(j==3)
+      at3=me;
+    for(i=j*per;i<(j+1)*per;++i)
+    { ac_encode_symbol(e,tag_[i]);
+      ac_encode_uint(e,&me,raw_[i]>>40);
+    }
+    ac_encoder_flush(e,&p,off+j+1);
+    ASSERT_GE(off[j+1],off[j]);
+    sent.insert(sent.end(),(const uint8_t*)p+sent.size(),(const uint8_t*)p+off[j+1]);
+    if(j==0)              // first segment decodes before anything else is written
+    { d=ac_decoder_open(GetParam(),cdf_,5,&sent[0],sent.size());
+      for(i=0;i<per;++i)
+      { ASSERT_EQ(tag_[i],ac_decode_symbol(d)) << i;
+        ASSERT_EQ(raw_[i]>>40,ac_decode_uint(d,&md)) << i;
+      }
+    } else
+    { ASSERT_EQ(off[j],ac_decoder_sync(d,&sent[0],sent.size()));
+      for(i=j*per;i<(j+1)*per;++i)
+      { ASSERT_EQ(tag_[i],ac_decode_symbol(d)) << i;
+        ASSERT_EQ(raw_[i]>>40,ac_decode_uint(d,&md)) << i;
+      }
+    }
+  }
+  ac_decoder_close(d);
+  ac_encoder_close(e,&buf,&nbuf);
+  EXPECT_EQ(0,memcmp(buf,&sent[0],sent.size()));
+
+  // A fresh decoder can start at any sync point.
+  d=ac_decoder_open(GetParam(),cdf_,5,(uint8_t*)buf+off[3],nbuf-off[3]);
+  for(i=3*per;i<4*per;++i)
+  { ASSERT_EQ(tag_[i],ac_decode_symbol(d)) << i;
+    ASSERT_EQ(raw_[i]>>40,ac_decode_uint(d,&at3)) << i;
+  }
+  ac_decoder_close(d);
+  free(buf);
+}
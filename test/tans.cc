@@ -0,0 +1,90 @@
+#include <gtest/gtest.h>
+#include <string.h>
+#include "tans.h"
+#include "stream.h"
+#include "helpers.h"
+
+///// PREP
+
+class TansTest : public SkewedTest {};
+
+///// Round trips
+
+TEST_F(TansTest,RoundTrip)
+{ void    *buf=NULL;
+  uint8_t *dec=NULL;
+  size_t   nbuf=0,ndec=0;
+  tans_encode_u8(&buf,&nbuf,msg_,countof(msg_),cdf_,5);
+  EXPECT_TRUE(tans_is_tans(buf,nbuf));
+  EXPECT_LT(nbuf,countof(msg_)/3);
+  tans_decode_u8(&dec,&ndec,buf,nbuf);
+  ASSERT_EQ(countof(msg_),ndec);
+  EXPECT_EQ(0,memcmp(msg_,dec,ndec));
+  free(buf);
+  free(dec);
+}
+
+TEST_F(TansTest,HistogramModel)
+{ void    *buf=NULL;
+  uint8_t *dec=NULL;
+  size_t   nbuf=0,ndec=0;
+  tans_encode_u8(&buf,&nbuf,msg_,countof(msg_),NULL,0);
+  tans_decode_u8(&dec,&ndec,buf,nbuf);
+  ASSERT_EQ(countof(msg_),ndec);
+  EXPECT_EQ(0,memcmp(msg_,dec,ndec));
+  free(buf);
+  free(dec);
+}
+
+TEST(Tans,ByteAlphabet)
+{ uint8_t  msg[50000],*dec=NULL;
+  void    *buf=NULL;
+  size_t   i,nbuf=0,ndec=0;
+  for(i=0;i<countof(msg);++i)
+    msg[i]=(uint8_t)((i*i*31+(i>>3))%256);
+  tans_encode_u8(&buf,&nbuf,msg,countof(msg),NULL,0);
+  tans_decode_u8(&dec,&ndec,buf,nbuf);
+  ASSERT_EQ(countof(msg),ndec);
+  EXPECT_EQ(0,memcmp(msg,dec,ndec));
+  free(buf);
+  free(dec);
+}
+
+TEST(Tans,SingleSymbol)
+{ uint8_t  msg[100],*dec=NULL;
+  void    *buf=NULL;
+  size_t   nbuf=0,ndec=0;
+  memset(msg,3,sizeof(msg));
+  tans_encode_u8(&buf,&nbuf,msg,countof(msg),NULL,0);
+  tans_decode_u8(&dec,&ndec,buf,nbuf);
+  ASSERT_EQ(countof(msg),ndec);
+  EXPECT_EQ(0,memcmp(msg,dec,ndec));
+  free(buf);
+  free(dec);
+}
+
+TEST(Tans,NotTans)
+{ uint8_t junk[] = {1,2,3,4,5,6,7,8};
+  EXPECT_FALSE(tans_is_tans(junk,sizeof(junk)));
+}
+
+///// Stream bit ops used by the coder
+
+TEST(StreamBits,PushPop)
+{ stream_t s={};
+  void *buf;
+  size_t n;
+  attach(&s,NULL,0);
+  push_bits(&s,0x5,3);
+  push_bits(&s,0x1234,13);
+  push_bits(&s,0,0);
+  push_bits(&s,0xabcdef01,32);
+  pad_bits(&s);
+  EXPECT_EQ(6,s.ibyte);
+  s.ibyte=0;
+  EXPECT_EQ(0x5u,pop_bits(&s,3));
+  EXPECT_EQ(0x1234u,pop_bits(&s,13));
+  EXPECT_EQ(0xabcdef01u,pop_bits(&s,32));
+  detach(&s,&buf,&n);
+  free(buf);
+}
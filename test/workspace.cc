@@ -0,0 +1,131 @@
+#include <gtest/gtest.h>
+#include <string.h>
+#include "ac.h"
+#include "helpers.h"
+
+///// PREP
+
+// Counts heap calls while armed by interposing the allocator.  glibc only:
+// the replacements forward to glibc's internal entry points.
+#if defined(__GLIBC__)
+#define HAVE_HEAP_COUNTER
+static volatile int g_armed=0,g_nheap=0;
+extern "C" {
+void *__libc_malloc(size_t);
+void *__libc_calloc(size_t,size_t);
+void *__libc_realloc(void*,size_t);
+void  __libc_free(void*);
+void *malloc(size_t n)            { if(g_armed) g_nheap++; return __libc_malloc(n); }
+void *calloc(size_t n,size_t m)   { if(g_armed) g_nheap++; return __libc_calloc(n,m); }
+void *realloc(void *p,size_t n)   { if(g_armed) g_nheap++; return __libc_realloc(p,n); }
+void  free(void *p)               { if(g_armed && p) g_nheap++; __libc_free(p); }
+}
+#define ARM    do{ g_nheap=0; g_armed=1; } while(0)
+#define DISARM do{ g_armed=0; } while(0)
+#endif
+
+class WorkspaceTest : public ::testing::Test
+{ protected:
+    virtual void SetUp()
+    { pattern_message(msg_,countof(msg_));
+      pattern_cdf(cdf_);
+    }
+  uint8_t msg_[20];
+  real    cdf_[5];
+};
+
+///// Tests
+
+TEST_F(WorkspaceTest,MatchesHeapEncoder)
+{ uint8_t  out[64],dec[countof(msg_)];
+  uint64_t ws[5];
+  void    *buf=NULL;
+  size_t   nbuf=0,nout=sizeof(out),ndec=countof(dec);
+  ASSERT_LE(ac_workspace_size(4),sizeof(ws));
+  EXPECT_EQ(0,encode_u8_u8_ws(out,&nout,msg_,countof(msg_),cdf_,4,ws));
+  encode_u8_u8(&buf,&nbuf,msg_,countof(msg_),cdf_,4);
+  ASSERT_EQ(nbuf,nout);
+  EXPECT_EQ(0,memcmp(buf,out,nout));
+  EXPECT_EQ(0,decode_u8_u8_ws(dec,&ndec,out,nout,cdf_,4,ws));
+  ASSERT_EQ(countof(msg_),ndec);  // exactly fills the output
+  EXPECT_EQ(0,memcmp(msg_,dec,ndec));
+  free(buf);
+}
+
+TEST_F(WorkspaceTest,Overflow)
+{ uint8_t out[64],dec[countof(msg_)];
+  size_t  nout=sizeof(out),n,ndec=countof(dec)-1;
+  ASSERT_EQ(0,encode_u1_u8_ws(out,&nout,msg_,countof(msg_),cdf_,4,NULL));
+  n=nout-1;
+  EXPECT_EQ(-1,encode_u1_u8_ws(out,&n,msg_,countof(msg_),cdf_,4,NULL));
+  n=nout;
+  EXPECT_EQ(0,encode_u1_u8_ws(out,&n,msg_,countof(msg_),cdf_,4,NULL));
+  EXPECT_EQ(-1,decode_u8_u1_ws(dec,&ndec,out,nout,cdf_,4,NULL));
+}
+
+#ifdef HAVE_HEAP_COUNTER
+TEST_F(WorkspaceTest,NeverTouchesHeap)
+{ uint8_t  out[64],dec[countof(msg_)];
+  uint16_t out16[32];
+  uint64_t ws[5];
+  size_t   nout=sizeof(out),ndec=countof(dec),n16=sizeof(out16);
+  int      r[4];
+  ARM;
+  r[0]=encode_u8_u8_ws(out,&nout,msg_,countof(msg_),cdf_,4,NULL); // model on the stack
+  r[1]=decode_u8_u8_ws(dec,&ndec,out,nout,cdf_,4,ws);            // model in the workspace
+  r[2]=encode_u16_u8_ws(out16,&n16,msg_,countof(msg_),cdf_,4,ws);
+  r[3]=encode_u4_u8_ws(out,&nout,msg_,countof(msg_),cdf_,4,ws);
+  DISARM;
+  EXPECT_EQ(0,g_nheap);
+  EXPECT_EQ(0,r[0]|r[1]|r[2]|r[3]);
+  EXPECT_EQ(0,memcmp(msg_,dec,sizeof(dec)));
+
+  ARM; // sanity: the heap path is counted
+  { void *buf=NULL; size_t nbuf=0;
+    encode_u8_u8(&buf,&nbuf,msg_,countof(msg_),cdf_,4);
+    free(buf);
+  }
+  DISARM;
+  EXPECT_GT(g_nheap,0);
+}
+#endif
+
+///// Scan
+
+struct scan_ctx_t { uint8_t seen[64]; size_t n; uint64_t stop; };
+
+static int scan_until(void *ctx, uint64_t sym)
+{ scan_ctx_t *c=(scan_ctx_t*)ctx;
+  if(c->n<countof(c->seen))
+    c->seen[c->n]=(uint8_t)sym;
+  c->n++;
+  return sym==c->stop;
+}
+
+TEST_F(WorkspaceTest,ScanMatchesDecode)
+{ uint8_t    out[64];
+  size_t     nout=sizeof(out);
+  scan_ctx_t c={{0},0,99};
+  ASSERT_EQ(0,encode_u8_u8_ws(out,&nout,msg_,countof(msg_),cdf_,4,NULL));
+  EXPECT_EQ(countof(msg_),decode_scan_u8(out,nout,cdf_,4,scan_until,&c,NULL));
+  EXPECT_EQ(countof(msg_),c.n);
+  EXPECT_EQ(0,memcmp(msg_,c.seen,countof(msg_)));
+}
+
+TEST_F(WorkspaceTest,ScanStopsEarly)
+{ uint8_t    out[64];
+  size_t     nout=sizeof(out),n;
+  scan_ctx_t c={{0},0,3};           // first 3 is msg_[12]
+  ASSERT_EQ(0,encode_u8_u8_ws(out,&nout,msg_,countof(msg_),cdf_,4,NULL));
+#ifdef HAVE_HEAP_COUNTER
+  ARM;
+#endif
+  n=decode_scan_u8(out,nout,cdf_,4,scan_until,&c,NULL);
+#ifdef HAVE_HEAP_COUNTER
+  DISARM;
+  EXPECT_EQ(0,g_nheap);
+#endif
+  EXPECT_EQ(13u,n);
+  EXPECT_EQ(13u,c.n);
+  EXPECT_EQ(0,memcmp(msg_,c.seen,13));
+}